@@ -0,0 +1,263 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_CONVERSION__H
+#define H__OGF_MMGIG_MMG_CONVERSION__H
+
+/* Internal header: conversion between GEO::Mesh and the mmg data structures,
+ * shared by the wrappers in algo/. Not part of the plugin API. */
+
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <geogram/basic/stopwatch.h>
+
+#include <functional>
+
+extern "C" {
+#include "mmg/libmmg.h"
+}
+
+namespace OGF {
+
+    /* Below this number of elements, the conversion loops are not worth
+     * being split across threads */
+    const index_t PARALLEL_CONVERSION_MIN_SIZE = 10000;
+
+    /* Calls func(from, to) on [0,n), split in slices over the cores if
+     * parallel is set */
+    void for_each_slice(index_t n, bool parallel,
+                        std::function<void(index_t, index_t)> func);
+
+    /* Reports phase to opt.monitor if any. Returns false if the job was
+     * cancelled, the caller then frees its data and returns false */
+    bool monitor_phase(const MmgOptions& opt, MmgPhase phase);
+
+    /* The mmg entry points, for MmgCallGuard */
+    enum MmgCall {
+        MMG_CALL_MMG3DLIB,
+        MMG_CALL_MMG3DLS,
+        MMG_CALL_MMG3DMOV,
+        MMG_CALL_MMGSLIB
+    };
+
+    /* Every mmg call starts by choosing its metric functions (MMG3D_setfunc,
+     * MMGS_setfunc) and storing them in library-global function pointers,
+     * so two calls may only run at the same time if they choose the same
+     * ones. The guard is held around each call: the calls of the same
+     * entry point and metric size (scalar or tensor) run concurrently, the
+     * other ones wait until those are done */
+    class MmgCallGuard {
+    public:
+        MmgCallGuard(MmgCall call, const MMG5_pSol met);
+        ~MmgCallGuard();
+    private:
+        MmgCallGuard(const MmgCallGuard&);
+        MmgCallGuard& operator=(const MmgCallGuard&);
+    };
+
+    /* Forgets the calls counted by the MmgCallGuard, in a process forked
+     * while other threads were inside run_mmg() (see run_in_worker()) */
+    void reset_mmg_call_guard();
+
+    /* Runs the mmg entry point call under an MmgCallGuard, disp is the
+     * displacement of MMG3D_mmg3dmov() */
+    int run_mmg(MmgCall call, MMG5_pMesh mesh, MMG5_pSol met, MMG5_pSol disp = NULL);
+
+    /* Fills opt.stats, if any, during a wrapper call. Each lap() adds the
+     * time since the previous lap to the given phase. The total time and the
+     * peak memory are recorded on destruction, so early returns are covered */
+    class StatsRecorder {
+    public:
+        StatsRecorder(const MmgOptions& opt, const Mesh& M);
+        ~StatsRecorder();
+
+        void lap(double MmgPhaseTimes::* field) {
+            double t = W_.elapsed_time();
+            if (stats_ != NULL) stats_->times.*field += t - last_;
+            last_ = t;
+        }
+
+        /* Return code and memory of the mmg call */
+        void mmg_done(int return_code, const MMG5_pMesh mesh);
+
+        /* Output counts, marks the call as successful */
+        void output(const Mesh& M_out);
+        /* Element counts summed over several outputs */
+        void output(const std::vector<Mesh*>& M_out);
+
+        /* Adds the phase times, mmg return code and memory of a call that
+         * recorded them in its own stats (inner), they cover the time since
+         * the last lap */
+        void nested(const MmgRemeshStats& inner);
+
+    private:
+        MmgRemeshStats* stats_;
+        Stopwatch W_;
+        double last_;
+    };
+
+    bool mmg_to_geo(const MMG5_pMesh mmg,
+                     Mesh& M,
+                     const std::string & edge_attribute_name = "no_attribute",
+                     const std::string & facet_attribute_name = "no_attribute",
+                     const std::string & cell_attribute_name = "no_attribute",
+                     bool parallel = true,
+                     bool connect = true /* facets and cells connect() */,
+                     bool bulk = true /* direct access to geogram's arrays */);
+
+    /* Fills the adjacency of M (cells if volume_mesh, triangles otherwise)
+     * from mmg->adja, which mmg keeps up to date with the packed elements:
+     * adja[4*(k-1)+1+i] = 4*k'+i' if tet k' is across the face of tet k
+     * opposite to its vertex i, 0 on the border (3*k'+i' for mmgs
+     * triangles). Local facet i of a geogram tet is also opposite to vertex
+     * i, local edge e of a triangle is opposite to its vertex e+2. Returns
+     * false if mmg has no adjacency or it does not match M */
+    bool copy_mmg_adjacency(const MMG5_pMesh mmg, Mesh& M, bool volume_mesh, bool parallel);
+
+    /* Adjacency of a mesh converted with mmg_to_geo(.., connect = false),
+     * as selected by opt.output_adjacency */
+    void connect_output(const MMG5_pMesh mmg, Mesh& M, bool volume_mesh, const MmgOptions& opt);
+
+    /* References given by MMG3D_mmg3dls() (MG_ISO, MG_MINUS and MG_PLUS
+     * in mmg's private headers) to the isosurface triangles and to the tets
+     * below and above the isovalue */
+    const int MMG_ISO_REF = 10;
+    const int MMG_MINUS_REF = 2;
+    const int MMG_PLUS_REF = 3;
+
+    /* True if opt selects cells for mmg3d_tet_remesh_local() */
+    inline bool has_local_selection(const MmgOptions& opt) {
+        return opt.local_cell_attribute != "no_attribute" || !opt.local_box.empty()
+            || opt.local_min_quality > 0.;
+    }
+
+    /* Sorts the vertices and elements of M along the space-filling curve
+     * order ("hilbert" or "morton", nothing for "none"), see
+     * MmgOptions::reorder. Returns false for an unknown order */
+    bool reorder_mesh(Mesh& M, const std::string& order);
+
+    /* M, or a copy of M sorted by opt.reorder */
+    const Mesh& reordered_input(const Mesh& M, Mesh& sorted, const MmgOptions& opt);
+
+    typedef bool (*MmgWrapper)(const Mesh& M, Mesh& M_out, const MmgOptions& opt);
+
+    /* Runs wrapper in a forked worker process, see MmgOptions::isolate.
+     * Returns false if the worker fails, crashes, is cancelled or exceeds
+     * opt.worker_timeout or opt.worker_memory_limit. The double, int,
+     * index_t, char and bool attributes of the result are transferred, the
+     * other types (vec3, ...) are dropped. The messages of the worker are
+     * logged by the caller once it exits, they are lost if it crashes */
+    bool run_in_worker(const Mesh& M, Mesh& M_out, const MmgOptions& opt,
+                       MmgWrapper wrapper, const char* name);
+
+    /* Runs preflight_check() if opt.preflight is set, returns true and logs
+     * the report if M cannot be given to mmg */
+    bool preflight_failed(const Mesh& M, bool volume_mesh, const MmgOptions& opt);
+
+    /* Copies M to M_out and returns true if opt.skip_min_quality is set and
+     * M already meets it, see mesh_meets_target() */
+    bool skip_if_good(const Mesh& M, Mesh& M_out, const MmgOptions& opt);
+
+    /* Conversion of the result of MMG3D_mmg3dls(), restricted to the
+     * elements selected by opt.iso_output, with the level set (ls->m) in
+     * opt.ls_attribute. Unused vertices are not converted, the adjacency is
+     * set as selected by opt.output_adjacency */
+    bool mmg_iso_to_geo(const MMG5_pMesh mmg, const MMG5_pSol ls, Mesh& M,
+                        const MmgOptions& opt);
+
+    bool geo_to_mmg(const Mesh& M, MMG5_pMesh& mmg,
+                    MMG5_pSol& sol,
+                    bool volume_mesh = true,
+                    bool enable_anisotropy = false,
+                    const std::string & edge_attribute_name = "no_attribute",
+                    const std::string & facet_attribute_name = "no_attribute",
+                    const std::string & cell_attribute_name = "no_attribute",
+                    bool parallel = true,
+                    bool bulk = true /* direct access to geogram's arrays when simplicial */,
+                    MMG5_pSol* disp = NULL /* volume only: also initialize a displacement, for MMG3D_mmg3dmov */);
+
+    /* Copy of a mesh and its solution as given by geo_to_mmg(), before
+     * any mmg call (mmg only fills its other arrays during the analysis) */
+    bool mmg3d_clone(const MMG5_pMesh mmg, const MMG5_pSol sol,
+                     MMG5_pMesh& mmg_copy, MMG5_pSol& sol_copy);
+
+    /* mmg3d_clone() for a surface given by geo_to_mmg(.., false, ..) */
+    bool mmgs_clone(const MMG5_pMesh mmg, const MMG5_pSol sol,
+                    MMG5_pMesh& mmg_copy, MMG5_pSol& sol_copy);
+
+    void mmg3d_free(MMG5_pMesh mmg, MMG5_pSol sol);
+
+    void mmgs_free(MMG5_pMesh mmg, MMG5_pSol sol);
+
+    /* Remeshing parameters of opt. If has_metric is false and opt.hsiz is
+     * set, the constant size hsiz is used instead of hmin/hmax */
+    void mmgs_set_parameters(MMG5_pMesh mesh, MMG5_pSol met,
+                             const MmgOptions& opt, bool has_metric);
+
+    void mmg3d_set_parameters(MMG5_pMesh mesh, MMG5_pSol met,
+                              const MmgOptions& opt, bool has_metric);
+
+    /* Level set discretization parameters of opt (MMG3D_mmg3dls) */
+    bool mmg3d_set_ls_parameters(MMG5_pMesh mesh, MMG5_pSol met,
+                                 const MmgOptions& opt);
+
+    /* Copy nb_vertices sizes (dimension 1) or upper triangular metric
+     * tensors (dimension 6) into met, resizing it if needed */
+    bool set_metric_values(MMG5_pMesh mesh, MMG5_pSol met, bool volume_mesh,
+                           const double* values, index_t nb_vertices,
+                           index_t dimension, bool parallel);
+
+    /* True if opt gives a metric: metric_attribute, or the curvature size map */
+    bool has_input_metric(const MmgOptions& opt);
+
+    /* Sets the metric given by opt, the metric_attribute of M if any, the
+     * curvature size map of M otherwise */
+    bool set_input_metric(const Mesh& M, MMG5_pMesh mesh, MMG5_pSol met,
+                          bool volume_mesh, const MmgOptions& opt);
+
+    /* Copy the vertex attribute opt.metric_attribute of M into met */
+    bool set_metric_from_attribute(const Mesh& M, MMG5_pMesh mesh,
+                                   MMG5_pSol met, bool volume_mesh,
+                                   const MmgOptions& opt);
+}
+
+#endif
+
@@ -0,0 +1,433 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_implicit.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+#include <OGF/mmgig/algo/mmg_session.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+#include <geogram/mesh/mesh_AABB.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace OGF {
+
+    namespace {
+
+        /* Recursive descent parser, each node becomes a closure:
+         *   expr    := term (('+' | '-') term)*
+         *   term    := unary (('*' | '/') unary)*
+         *   unary   := '-' unary | power
+         *   power   := primary ('^' unary)?
+         *   primary := number | x | y | z | pi | name '(' expr (',' expr)* ')' | '(' expr ')'
+         */
+        class ExpressionParser {
+        public:
+            ExpressionParser(const std::string& text) : text_(text), pos_(0), error_(false) {
+            }
+
+            bool parse(ImplicitFunction& f) {
+                f = expr();
+                skip_spaces();
+                if (!error_ && pos_ != text_.size()) fail("unexpected character");
+                return !error_;
+            }
+
+        private:
+            void fail(const std::string& message) {
+                if (!error_) {
+                    mmg_log_err("mmg_implicit") << message << " at position " << pos_
+                        << " in \"" << text_ << "\"" << std::endl;
+                }
+                error_ = true;
+            }
+
+            void skip_spaces() {
+                while (pos_ < text_.size() && std::isspace((unsigned char) text_[pos_])) ++pos_;
+            }
+
+            bool accept(char c) {
+                skip_spaces();
+                if (pos_ < text_.size() && text_[pos_] == c) {
+                    ++pos_;
+                    return true;
+                }
+                return false;
+            }
+
+            ImplicitFunction constant(double value) {
+                return [value](const vec3&) { return value; };
+            }
+
+            ImplicitFunction expr() {
+                ImplicitFunction left = term();
+                while (!error_) {
+                    if (accept('+')) {
+                        ImplicitFunction right = term();
+                        left = [left, right](const vec3& p) { return left(p) + right(p); };
+                    } else if (accept('-')) {
+                        ImplicitFunction right = term();
+                        left = [left, right](const vec3& p) { return left(p) - right(p); };
+                    } else {
+                        break;
+                    }
+                }
+                return left;
+            }
+
+            ImplicitFunction term() {
+                ImplicitFunction left = unary();
+                while (!error_) {
+                    if (accept('*')) {
+                        ImplicitFunction right = unary();
+                        left = [left, right](const vec3& p) { return left(p) * right(p); };
+                    } else if (accept('/')) {
+                        ImplicitFunction right = unary();
+                        left = [left, right](const vec3& p) { return left(p) / right(p); };
+                    } else {
+                        break;
+                    }
+                }
+                return left;
+            }
+
+            ImplicitFunction unary() {
+                if (accept('-')) {
+                    ImplicitFunction operand = unary();
+                    return [operand](const vec3& p) { return -operand(p); };
+                }
+                return power();
+            }
+
+            ImplicitFunction power() {
+                ImplicitFunction base = primary();
+                if (!error_ && accept('^')) {
+                    ImplicitFunction exponent = unary();
+                    return [base, exponent](const vec3& p) { return std::pow(base(p), exponent(p)); };
+                }
+                return base;
+            }
+
+            ImplicitFunction primary() {
+                skip_spaces();
+                if (pos_ >= text_.size()) {
+                    fail("unexpected end");
+                    return constant(0.);
+                }
+                if (accept('(')) {
+                    ImplicitFunction inner = expr();
+                    if (!accept(')')) fail("missing )");
+                    return inner;
+                }
+                char c = text_[pos_];
+                if (std::isdigit((unsigned char) c) || c == '.') {
+                    const char* begin = text_.c_str() + pos_;
+                    char* end = NULL;
+                    double value = std::strtod(begin, &end);
+                    pos_ += index_t(end - begin);
+                    return constant(value);
+                }
+                if (!std::isalpha((unsigned char) c)) {
+                    fail("unexpected character");
+                    return constant(0.);
+                }
+                std::string name;
+                while (pos_ < text_.size() && std::isalnum((unsigned char) text_[pos_])) {
+                    name += text_[pos_++];
+                }
+                if (name == "x") return [](const vec3& p) { return p.x; };
+                if (name == "y") return [](const vec3& p) { return p.y; };
+                if (name == "z") return [](const vec3& p) { return p.z; };
+                if (name == "pi") return constant(M_PI);
+                if (!accept('(')) {
+                    fail("unknown variable " + name);
+                    return constant(0.);
+                }
+                std::vector<ImplicitFunction> args(1, expr());
+                while (!error_ && accept(',')) {
+                    args.push_back(expr());
+                }
+                if (!accept(')')) fail("missing )");
+                return function(name, args);
+            }
+
+            ImplicitFunction function(const std::string& name, const std::vector<ImplicitFunction>& args) {
+                double (*f1)(double) = NULL;
+                if (name == "sqrt") f1 = std::sqrt;
+                else if (name == "abs") f1 = std::fabs;
+                else if (name == "sin") f1 = std::sin;
+                else if (name == "cos") f1 = std::cos;
+                else if (name == "tan") f1 = std::tan;
+                else if (name == "exp") f1 = std::exp;
+                else if (name == "log") f1 = std::log;
+                if (f1 != NULL && args.size() == 1) {
+                    ImplicitFunction a = args[0];
+                    return [f1, a](const vec3& p) { return f1(a(p)); };
+                }
+                if (args.size() == 2 && (name == "min" || name == "max" || name == "pow")) {
+                    ImplicitFunction a = args[0];
+                    ImplicitFunction b = args[1];
+                    if (name == "min") return [a, b](const vec3& p) { return std::min(a(p), b(p)); };
+                    if (name == "max") return [a, b](const vec3& p) { return std::max(a(p), b(p)); };
+                    return [a, b](const vec3& p) { return std::pow(a(p), b(p)); };
+                }
+                fail("unknown function " + name + " with " + std::to_string(args.size()) + " argument(s)");
+                return constant(0.);
+            }
+
+            std::string text_;
+            index_t pos_;
+            bool error_;
+        };
+
+        /* The surface and its tree, shared by the copies of the function */
+        struct SignedDistance {
+            Mesh surface;
+            std::unique_ptr<MeshFacetsAABB> aabb;
+            std::vector<vec3> facet_normal;  /* unit, by facet */
+            std::vector<vec3> edge_normal;   /* by corner c, edge from c to the next corner */
+            std::vector<vec3> vertex_normal; /* angle weighted, by vertex */
+        };
+
+        vec3 unit(const vec3& v) {
+            double l = length(v);
+            return (l > 0.) ? v / l : v;
+        }
+
+        /*
+         * Angle-weighted pseudo-normals (Baerentzen and Aanaes): the sign of
+         * dot(p - q, n) is exact for a closed oriented surface when n is the
+         * pseudo-normal of the face, edge or vertex that contains the
+         * nearest point q, where the normal of a single facet is not.
+         */
+        void compute_pseudo_normals(SignedDistance& sd) {
+            const Mesh& S = sd.surface;
+            index_t nb_f = S.facets.nb();
+            sd.facet_normal.assign(nb_f, vec3(0., 0., 0.));
+            sd.edge_normal.assign(3 * nb_f, vec3(0., 0., 0.));
+            sd.vertex_normal.assign(S.vertices.nb(), vec3(0., 0., 0.));
+
+            struct Edge {
+                index_t v0, v1, corner;
+                bool operator<(const Edge& rhs) const {
+                    return (v0 != rhs.v0) ? (v0 < rhs.v0) : (v1 < rhs.v1);
+                }
+            };
+            std::vector<Edge> edges(3 * nb_f);
+            for (index_t f = 0; f < nb_f; ++f) {
+                vec3 p[3];
+                for (index_t lv = 0; lv < 3; ++lv) {
+                    p[lv] = vec3(S.vertices.point_ptr(S.facets.vertex(f, lv)));
+                }
+                vec3 n = unit(cross(p[1] - p[0], p[2] - p[0]));
+                sd.facet_normal[f] = n;
+                for (index_t lv = 0; lv < 3; ++lv) {
+                    vec3 a = p[(lv + 1) % 3] - p[lv];
+                    vec3 b = p[(lv + 2) % 3] - p[lv];
+                    double angle = std::atan2(length(cross(a, b)), dot(a, b));
+                    sd.vertex_normal[S.facets.vertex(f, lv)] += n * angle;
+                    index_t v0 = S.facets.vertex(f, lv);
+                    index_t v1 = S.facets.vertex(f, (lv + 1) % 3);
+                    Edge e = { std::min(v0, v1), std::max(v0, v1), 3 * f + lv };
+                    edges[3 * f + lv] = e;
+                }
+            }
+
+            /* The facets that share an edge sum their normals, also on non-manifold edges */
+            std::sort(edges.begin(), edges.end());
+            for (index_t begin = 0; begin < edges.size();) {
+                index_t end = begin + 1;
+                while (end < edges.size() && !(edges[begin] < edges[end])) ++end;
+                vec3 n(0., 0., 0.);
+                for (index_t i = begin; i < end; ++i) n += sd.facet_normal[edges[i].corner / 3];
+                for (index_t i = begin; i < end; ++i) sd.edge_normal[edges[i].corner] = n;
+                begin = end;
+            }
+        }
+
+        /* Pseudo-normal of the feature of facet f that contains q */
+        vec3 pseudo_normal(const SignedDistance& sd, index_t f, const vec3& q) {
+            const Mesh& S = sd.surface;
+            vec3 p0(S.vertices.point_ptr(S.facets.vertex(f, 0)));
+            vec3 p1(S.vertices.point_ptr(S.facets.vertex(f, 1)));
+            vec3 p2(S.vertices.point_ptr(S.facets.vertex(f, 2)));
+            vec3 e1 = p1 - p0;
+            vec3 e2 = p2 - p0;
+            vec3 d = q - p0;
+            double d11 = dot(e1, e1), d12 = dot(e1, e2), d22 = dot(e2, e2);
+            double det = d11 * d22 - d12 * d12;
+            if (!(det > 0.)) {
+                /* Degenerate facet, q is on one of its edges */
+                return sd.edge_normal[3 * f];
+            }
+            double b[3];
+            b[1] = (d22 * dot(d, e1) - d12 * dot(d, e2)) / det;
+            b[2] = (d11 * dot(d, e2) - d12 * dot(d, e1)) / det;
+            b[0] = 1. - b[1] - b[2];
+            const double eps = 1e-6;
+            index_t nb_zero = 0;
+            index_t zero = 0;
+            index_t inside = 0;
+            for (index_t lv = 0; lv < 3; ++lv) {
+                if (b[lv] < eps) {
+                    ++nb_zero;
+                    zero = lv;
+                } else {
+                    inside = lv;
+                }
+            }
+            if (nb_zero == 0) return sd.facet_normal[f];
+            /* On the edge opposite to corner zero, from corner zero+1 to zero+2 */
+            if (nb_zero == 1) return sd.edge_normal[3 * f + (zero + 1) % 3];
+            return sd.vertex_normal[S.facets.vertex(f, inside)];
+        }
+
+        void evaluate_at(index_t nb, std::function<vec3(index_t)> point,
+                         const ImplicitFunction& f, std::vector<double>& values, bool parallel) {
+            values.resize(nb);
+            for_each_slice(nb, parallel, [&](index_t from, index_t to) {
+                for (index_t v = from; v < to; ++v) {
+                    values[v] = f(point(v));
+                }
+            });
+        }
+    }
+
+    bool parse_implicit_expression(const std::string& expression, ImplicitFunction& f) {
+        ExpressionParser parser(expression);
+        return parser.parse(f);
+    }
+
+    ImplicitFunction signed_distance_function(const Mesh& surface) {
+        if (surface.facets.nb() == 0 || !surface.facets.are_simplices()) {
+            mmg_log_err("mmg_implicit") << "reference surface should be a triangulated surface" << std::endl;
+            return ImplicitFunction();
+        }
+        std::shared_ptr<SignedDistance> sd(new SignedDistance);
+        sd->surface.copy(surface);
+        sd->surface.cells.clear();
+        sd->aabb.reset(new MeshFacetsAABB(sd->surface));
+        compute_pseudo_normals(*sd);
+        return [sd](const vec3& p) {
+            vec3 q;
+            double sq_dist;
+            index_t f = sd->aabb->nearest_facet(p, q, sq_dist);
+            double side = dot(p - q, pseudo_normal(*sd, f, q));
+            return (side < 0.) ? -std::sqrt(sq_dist) : std::sqrt(sq_dist);
+        };
+    }
+
+    void evaluate_implicit(Mesh& M, const ImplicitFunction& f,
+                           const std::string& attribute_name, bool parallel) {
+        std::vector<double> values;
+        evaluate_at(M.vertices.nb(), [&](index_t v) { return vec3(M.vertices.point_ptr(v)); },
+                    f, values, parallel);
+        Attribute<double> attr(M.vertices.attributes(), attribute_name);
+        for (index_t v = 0; v < M.vertices.nb(); ++v) {
+            attr[v] = values[v];
+        }
+    }
+
+    bool mmg3d_implicit_iso(const Mesh& background, const ImplicitFunction& f,
+                            Mesh& M_out, const MmgOptions& opt,
+                            index_t nb_band_passes, double band_width) {
+        if (background.cells.nb() == 0 || !background.cells.are_simplices()) {
+            mmg_log_err("mmg_implicit") << "background mesh should be a tetrahedral mesh" << std::endl;
+            return false;
+        }
+        Stopwatch W("mmg_implicit", false);
+        double band = (band_width > 0.) ? band_width : 2. * opt.hmin;
+
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION)) return false;
+        MmgOptions session_opt = opt;
+        session_opt.metric_attribute = "no_metric";
+        MmgSession S;
+        if (!S.set_mesh(background, true, session_opt)) return false;
+
+        auto vertex = [&S](index_t v) { return vec3(S.vertex(v)); };
+        std::vector<double> values;
+        for (index_t pass = 0; pass < nb_band_passes; ++pass) {
+            if (!monitor_phase(opt, MMG_PHASE_REMESHING)) return false;
+            evaluate_at(S.nb_vertices(), vertex, f, values, opt.parallel_conversion);
+
+            /* Fine near the isovalue, including the vertices of the tets it
+             * crosses, which may all be far from it while the mesh is coarse */
+            std::vector<double> sizes(S.nb_vertices(), opt.hmax);
+            for (index_t v = 0; v < S.nb_vertices(); ++v) {
+                if (std::fabs(values[v] - opt.ls_value) <= band) sizes[v] = opt.hmin;
+            }
+            for (index_t t = 0; t < S.nb_tets(); ++t) {
+                bool below = false;
+                bool above = false;
+                for (index_t lv = 0; lv < 4; ++lv) {
+                    double value = values[S.tet_vertex(t, lv)];
+                    below = below || value <= opt.ls_value;
+                    above = above || value >= opt.ls_value;
+                }
+                if (!(below && above)) continue;
+                for (index_t lv = 0; lv < 4; ++lv) {
+                    sizes[S.tet_vertex(t, lv)] = opt.hmin;
+                }
+            }
+            if (!S.set_metric(sizes, 1) || !S.remesh(session_opt)) return false;
+        }
+
+        if (!monitor_phase(opt, MMG_PHASE_ANALYSIS)) return false;
+        evaluate_at(S.nb_vertices(), vertex, f, values, opt.parallel_conversion);
+        if (!S.set_level_set(values)) return false;
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING) || !S.extract_iso(session_opt)) return false;
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION_BACK)) return false;
+        bool ok = S.get_mesh(M_out, session_opt);
+        mmg_log_out("mmg_implicit") << nb_band_passes << " band pass(es) from " << background.cells.nb()
+            << " to " << S.nb_tets() << " tets, output: " << M_out.facets.nb() << " triangles, "
+            << M_out.cells.nb() << " tets, " << W.elapsed_time() << " s" << std::endl;
+        monitor_phase(opt, MMG_PHASE_DONE);
+        return ok;
+    }
+}
@@ -0,0 +1,104 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_IMPLICIT__H
+#define H__OGF_MMGIG_MMG_IMPLICIT__H
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <geogram/basic/geometry.h>
+
+#include <functional>
+#include <string>
+
+namespace GEO {
+    class Mesh;
+}
+
+namespace OGF {
+
+    /* Implicit function of the point, called concurrently by several threads */
+    typedef std::function<double(const vec3&)> ImplicitFunction;
+
+    /**
+     * \brief Compiles an expression of x, y and z.
+     * \details Supports numbers, pi, + - * / ^, parentheses and the functions
+     *   sqrt, abs, sin, cos, tan, exp, log, min, max and pow, e.g.
+     *   "sqrt(x^2 + y^2 + z^2) - 0.5". Returns false and logs on a syntax
+     *   error.
+     */
+    bool mmgig_API parse_implicit_expression(const std::string& expression, ImplicitFunction& f);
+
+    /**
+     * \brief Signed distance to the triangles of surface, negative inside.
+     * \details The surface should be closed and oriented outwards, the sign
+     *   is given by the angle-weighted pseudo-normal of the face, edge or
+     *   vertex nearest to the point. The returned function keeps an AABB
+     *   tree of a copy of the surface. Returns an empty function and logs
+     *   if surface is not triangulated.
+     */
+    ImplicitFunction mmgig_API signed_distance_function(const Mesh& surface);
+
+    /* f at the vertices of M, in the double vertex attribute attribute_name */
+    void mmgig_API evaluate_implicit(Mesh& M, const ImplicitFunction& f,
+                                     const std::string& attribute_name, bool parallel = true);
+
+    /**
+     * \brief Isosurface opt.ls_value of f, discretized in a band-refined
+     *   background tet mesh.
+     * \details The background is converted once into an MmgSession. Each of
+     *   the nb_band_passes remeshing passes evaluates f at the current
+     *   vertices and asks for opt.hmin on the vertices within band_width of
+     *   the isovalue (and on the tets it crosses), opt.hmax elsewhere, graded
+     *   by opt.hgrad. f is then evaluated a last time and the level set is
+     *   discretized by MMG3D_mmg3dls, with opt.iso_output selecting the
+     *   output. The number of tets follows the area of the isosurface rather
+     *   than the volume of the background.
+     * \param[in] band_width in the units of f, 0 for 2 opt.hmin (for
+     *   a distance function)
+     */
+    bool mmgig_API mmg3d_implicit_iso(const Mesh& background, const ImplicitFunction& f,
+                                      Mesh& M_out, const MmgOptions& opt,
+                                      index_t nb_band_passes = 3, double band_width = 0.);
+}
+
+#endif
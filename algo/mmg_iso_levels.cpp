@@ -0,0 +1,201 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+namespace OGF {
+    using namespace GEO;
+
+    bool mmg3d_extract_iso_levels(const Mesh& M, const std::vector<double>& ls_values,
+                                  const std::vector<Mesh*>& M_out, const MmgOptions& opt) {
+        geo_assert(M_out.size() == ls_values.size());
+        if (!opt.level_set || opt.ls_attribute == "no_ls" || !M.vertices.attributes().is_defined(opt.ls_attribute)) {
+            mmg_log_err("mmg3D_iso") << opt.ls_attribute << " is not a vertex attribute, cancel" << std::endl;
+            return false;
+        }
+        if (ls_values.empty()) return true;
+
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION)) return false;
+        StatsRecorder clock(opt, M);
+        MMG5_pMesh mesh = NULL;
+        MMG5_pSol met = NULL;
+        bool ok = geo_to_mmg(M, mesh, met, true, opt.enable_anisotropy, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute, opt.parallel_conversion, opt.bulk_conversion);
+        if (!ok) {
+            mmg_log_err("mmg3d_iso") << "failed to convert mesh to MMG5_pMesh" << std::endl;
+            mmg3d_free(mesh, met);
+            return false;
+        }
+        GEO::Attribute<double> ls(M.vertices.attributes(), opt.ls_attribute);
+        for_each_slice(M.vertices.nb(), opt.parallel_conversion, [&](index_t from, index_t to) {
+            for (index_t v = from; v < to; ++v) {
+                met->m[v+1] = ls[v];
+            }
+        });
+        clock.lap(&MmgPhaseTimes::geo_to_mmg);
+
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING)) {
+            mmg3d_free(mesh, met);
+            return false;
+        }
+
+        /* Each level copies the converted mesh in its own MMG5_pMesh, so
+         * that mmg can modify it. parallel_for gives a contiguous range of
+         * levels to each thread, at most one copy per core is alive. */
+        index_t nb_levels = index_t(ls_values.size());
+        std::vector<int> status(nb_levels, MMG5_STRONGFAILURE);
+        MmgLogBuffer* log = MmgLogScope::current();
+        parallel_for(0, nb_levels, [&](index_t i) {
+            MmgLogScope log_scope(log);
+            if (opt.monitor != NULL && opt.monitor->cancel_requested) return;
+            MMG5_pMesh level_mesh = NULL;
+            MMG5_pSol level_met = NULL;
+            MmgOptions level_opt = opt;
+            level_opt.ls_value = ls_values[i];
+            level_opt.parallel_conversion = false;
+            level_opt.monitor = NULL;
+            level_opt.stats = NULL;
+            if (mmg3d_clone(mesh, met, level_mesh, level_met)
+                && mmg3d_set_ls_parameters(level_mesh, level_met, level_opt)) {
+                MMG3D_Set_iparameter(level_mesh, level_met, MMG3D_IPARAM_verbose, -1);
+                status[i] = run_mmg(MMG_CALL_MMG3DLS, level_mesh, level_met);
+                if (status[i] == MMG5_SUCCESS && !mmg_iso_to_geo(level_mesh, level_met, *M_out[i], level_opt)) {
+                    status[i] = MMG5_STRONGFAILURE;
+                }
+            }
+            mmg3d_free(level_mesh, level_met);
+        });
+        clock.lap(&MmgPhaseTimes::mmg);
+        mmg3d_free(mesh, met);
+
+        int worst = MMG5_SUCCESS;
+        for (index_t i = 0; i < nb_levels; ++i) {
+            if (status[i] != MMG5_SUCCESS) {
+                mmg_log_err("mmg3d_iso") << "failed to extract isovalue " << ls_values[i] << std::endl;
+                worst = status[i];
+            }
+        }
+        clock.mmg_done(worst, NULL);
+        ok = (worst == MMG5_SUCCESS) && monitor_phase(opt, MMG_PHASE_CONVERSION_BACK);
+        if (ok) clock.output(M_out);
+        monitor_phase(opt, MMG_PHASE_DONE);
+        return ok;
+    }
+
+    void merge_iso_levels(const std::vector<Mesh*>& levels, Mesh& M_out,
+                          const std::string& level_attribute) {
+        M_out.clear();
+        if (levels.empty()) return;
+
+        /* Scalar double vertex attributes shared by all levels (e.g. the
+         * level set) are kept */
+        GEO::vector<std::string> names;
+        levels[0]->vertices.attributes().list_attribute_names(names);
+        std::vector<std::string> shared;
+        for (const std::string& name : names) {
+            if (name == "point") continue;
+            bool everywhere = true;
+            for (const Mesh* M : levels) {
+                everywhere = everywhere && Attribute<double>::is_defined(
+                    const_cast<Mesh*>(M)->vertices.attributes(), name, 1);
+            }
+            if (everywhere) shared.push_back(name);
+        }
+
+        Attribute<int> facet_level(M_out.facets.attributes(), level_attribute);
+        Attribute<int> cell_level(M_out.cells.attributes(), level_attribute);
+        for (index_t l = 0; l < levels.size(); ++l) {
+            const Mesh& M = *levels[l];
+            index_t v0 = M_out.vertices.create_vertices(M.vertices.nb());
+            for (index_t v = 0; v < M.vertices.nb(); ++v) {
+                const double* p = M.vertices.point_ptr(v);
+                double* q = M_out.vertices.point_ptr(v0 + v);
+                q[0] = p[0];
+                q[1] = p[1];
+                q[2] = p[2];
+            }
+            for (const std::string& name : shared) {
+                Attribute<double> in(const_cast<Mesh&>(M).vertices.attributes(), name);
+                Attribute<double> out(M_out.vertices.attributes(), name);
+                for (index_t v = 0; v < M.vertices.nb(); ++v) {
+                    out[v0 + v] = in[v];
+                }
+            }
+            if (M.edges.nb() > 0) {
+                index_t e0 = M_out.edges.create_edges(M.edges.nb());
+                for (index_t e = 0; e < M.edges.nb(); ++e) {
+                    M_out.edges.set_vertex(e0 + e, 0, v0 + M.edges.vertex(e, 0));
+                    M_out.edges.set_vertex(e0 + e, 1, v0 + M.edges.vertex(e, 1));
+                }
+            }
+            if (M.facets.nb() > 0) {
+                index_t f0 = M_out.facets.create_triangles(M.facets.nb());
+                for (index_t f = 0; f < M.facets.nb(); ++f) {
+                    for (index_t lv = 0; lv < 3; ++lv) {
+                        M_out.facets.set_vertex(f0 + f, lv, v0 + M.facets.vertex(f, lv));
+                    }
+                    facet_level[f0 + f] = int(l);
+                }
+            }
+            if (M.cells.nb() > 0) {
+                index_t c0 = M_out.cells.create_tets(M.cells.nb());
+                for (index_t c = 0; c < M.cells.nb(); ++c) {
+                    for (index_t lv = 0; lv < 4; ++lv) {
+                        M_out.cells.set_vertex(c0 + c, lv, v0 + M.cells.vertex(c, lv));
+                    }
+                    cell_level[c0 + c] = int(l);
+                }
+            }
+        }
+        if (M_out.cells.nb() == 0) {
+            cell_level.unbind();
+            M_out.cells.attributes().delete_attribute_store(level_attribute);
+        }
+        M_out.facets.connect();
+        M_out.cells.connect();
+    }
+}
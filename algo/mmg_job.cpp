@@ -0,0 +1,132 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_job.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/stopwatch.h>
+
+namespace OGF {
+
+    MmgJob::MmgJob(Kind kind, const Mesh& M, const MmgOptions& opt,
+            const std::string& output_name) :
+        kind_(kind),
+        opt_(opt),
+        output_name_(output_name),
+        finished_(false),
+        succeeded_(false) {
+        input_.copy(M, true);
+        opt_.monitor = &monitor_;
+        opt_.stats = &stats_;
+    }
+
+    MmgJob::~MmgJob() {
+        wait();
+    }
+
+    void MmgJob::start() {
+        geo_assert(!thread_.joinable());
+        thread_ = std::thread(&MmgJob::run, this);
+    }
+
+    void MmgJob::cancel() {
+        monitor_.cancel_requested = true;
+    }
+
+    void MmgJob::wait() {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    index_t MmgJob::progress() const {
+        switch (phase()) {
+            case MMG_PHASE_IDLE: return 0;
+            case MMG_PHASE_CONVERSION: return 5;
+            case MMG_PHASE_ANALYSIS: return 10;
+            case MMG_PHASE_REMESHING: return 20;
+            case MMG_PHASE_CONVERSION_BACK: return 90;
+            case MMG_PHASE_DONE: return 100;
+        }
+        return 0;
+    }
+
+    const char* MmgJob::kind_name(Kind kind) {
+        switch (kind) {
+            case MMGS_REMESH: return "mmgs_remesh";
+            case MMG3D_REMESH: return "mmg3d_remesh";
+            case MMG3D_ISO: return "mmg3d_iso_extraction";
+            case MMG3D_MOVE: return "mmg3d_move";
+        }
+        return "unknown";
+    }
+
+    void MmgJob::run() {
+        MmgLogScope log_scope(&log_);
+        Stopwatch W("mmg_job", false);
+        bool ok = false;
+        try {
+            if (kind_ == MMGS_REMESH) {
+                ok = mmgs_tri_remesh(input_, result_, opt_);
+            } else if (kind_ == MMG3D_REMESH) {
+                ok = mmg3d_tet_remesh(input_, result_, opt_);
+            } else if (kind_ == MMG3D_ISO) {
+                ok = mmg3d_extract_iso(input_, result_, opt_);
+            } else if (kind_ == MMG3D_MOVE) {
+                ok = mmg3d_move(input_, result_, opt_);
+            }
+        } catch (const std::exception& e) {
+            mmg_log_err("mmg_job") << kind_name(kind_) << ": " << e.what() << std::endl;
+            ok = false;
+        }
+        /* The copy of the input is not needed anymore */
+        input_.clear();
+        succeeded_ = ok && !monitor_.cancel_requested;
+        if (!succeeded_) {
+            result_.clear();
+        }
+        mmg_log_out("mmg_job") << kind_name(kind_) << " -> " << output_name_
+            << (succeeded_ ? " done" : (monitor_.cancel_requested ? " cancelled" : " failed"))
+            << " in " << W.elapsed_time() << " s" << std::endl;
+        mmg_log_out("mmg_job") << stats_.to_json() << std::endl;
+        finished_ = true;
+    }
+}
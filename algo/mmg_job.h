@@ -0,0 +1,152 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_JOB__H
+#define H__OGF_MMGIG_MMG_JOB__H
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <geogram/mesh/mesh.h>
+
+#include <thread>
+
+namespace OGF {
+
+    /**
+     * \brief A remeshing call running on a worker thread.
+     * \details The input mesh is copied by the constructor, so the caller
+     *   can keep using (or modify) the original while the job runs. The
+     *   result stays inside the job until the owner publishes it, typically
+     *   on the GUI thread once is_finished() returns true. The messages of
+     *   the worker are kept in the job until flush_log() writes them to the
+     *   Logger. The destructor waits for the worker.
+     */
+    class mmgig_API MmgJob {
+    public:
+        enum Kind {
+            MMGS_REMESH,
+            MMG3D_REMESH,
+            MMG3D_ISO,
+            MMG3D_MOVE
+        };
+
+        MmgJob(Kind kind, const Mesh& M, const MmgOptions& opt,
+                const std::string& output_name);
+        ~MmgJob();
+
+        /* Launch the worker thread */
+        void start();
+
+        /* Ask the worker to stop at the next phase change. The mmg call
+         * itself cannot be interrupted and runs to completion */
+        void cancel();
+
+        /* Block until the worker is done */
+        void wait();
+
+        /* Write the messages of the worker to the Logger, from the thread
+         * that owns it */
+        void flush_log() {
+            log_.flush();
+        }
+
+        bool is_finished() const {
+            return finished_;
+        }
+
+        bool is_cancel_requested() const {
+            return monitor_.cancel_requested;
+        }
+
+        MmgPhase phase() const {
+            return MmgPhase(int(monitor_.phase));
+        }
+
+        /* Rough completion estimate (0 to 100) derived from the phase,
+         * mmg does not report its own progress */
+        index_t progress() const;
+
+        /* Meaningful once is_finished() */
+        bool succeeded() const {
+            return succeeded_;
+        }
+
+        Mesh& result() {
+            return result_;
+        }
+
+        /* Meaningful once is_finished() */
+        const MmgRemeshStats& stats() const {
+            return stats_;
+        }
+
+        const std::string& output_name() const {
+            return output_name_;
+        }
+
+        Kind kind() const {
+            return kind_;
+        }
+
+        static const char* kind_name(Kind kind);
+
+    private:
+        MmgJob(const MmgJob&);
+        MmgJob& operator=(const MmgJob&);
+
+        void run();
+
+        Kind kind_;
+        Mesh input_;
+        Mesh result_;
+        MmgOptions opt_;
+        MmgMonitor monitor_;
+        MmgRemeshStats stats_;
+        MmgLogBuffer log_;
+        std::string output_name_;
+        std::thread thread_;
+        std::atomic<bool> finished_;
+        bool succeeded_;
+    };
+}
+
+#endif
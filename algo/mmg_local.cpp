@@ -0,0 +1,230 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+#include <OGF/mmgig/algo/mmg_submesh.h>
+#include <OGF/mmgig/algo/mmg_quality.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace OGF {
+    using namespace GEO;
+
+    namespace {
+
+        /* selected[c] = 1 for the cells matching one of the criteria of opt */
+        bool select_cells(const Mesh& M, const MmgOptions& opt, std::vector<char>& selected) {
+            index_t nc = M.cells.nb();
+            selected.assign(nc, 0);
+            if (opt.local_cell_attribute != "no_attribute") {
+                if (!Attribute<int>::is_defined(const_cast<Mesh&>(M).cells.attributes(), opt.local_cell_attribute)) {
+                    mmg_log_err("mmg3d_local") << opt.local_cell_attribute << " is not an int cell attribute" << std::endl;
+                    return false;
+                }
+                Attribute<int> attr(const_cast<Mesh&>(M).cells.attributes(), opt.local_cell_attribute);
+                parallel_for_slice(0, nc, [&](index_t from, index_t to) {
+                    for (index_t c = from; c < to; ++c) {
+                        if (attr[c] != 0) selected[c] = 1;
+                    }
+                });
+            }
+            if (!opt.local_box.empty()) {
+                double box[6];
+                std::istringstream in(opt.local_box);
+                for (index_t i = 0; i < 6; ++i) {
+                    if (!(in >> box[i])) {
+                        mmg_log_err("mmg3d_local") << "local_box should be \"xmin ymin zmin xmax ymax zmax\", got "
+                            << opt.local_box << std::endl;
+                        return false;
+                    }
+                }
+                parallel_for_slice(0, nc, [&](index_t from, index_t to) {
+                    for (index_t c = from; c < to; ++c) {
+                        for (index_t lv = 0; lv < 4; ++lv) {
+                            const double* p = M.vertices.point_ptr(M.cells.vertex(c, lv));
+                            if (p[0] >= box[0] && p[1] >= box[1] && p[2] >= box[2]
+                                && p[0] <= box[3] && p[1] <= box[4] && p[2] <= box[5]) {
+                                selected[c] = 1;
+                                break;
+                            }
+                        }
+                    }
+                });
+            }
+            if (opt.local_min_quality > 0.) {
+                std::vector<double> quality;
+                compute_element_qualities(M, quality);
+                parallel_for_slice(0, nc, [&](index_t from, index_t to) {
+                    for (index_t c = from; c < to; ++c) {
+                        if (quality[c] < opt.local_min_quality) selected[c] = 1;
+                    }
+                });
+            }
+            return true;
+        }
+
+        /* Adds nb_layers layers of adjacent cells to the selection */
+        void grow_selection(const Mesh& M, index_t nb_layers, std::vector<char>& selected) {
+            for (index_t layer = 0; layer < nb_layers; ++layer) {
+                std::vector<char> grown = selected;
+                parallel_for_slice(0, M.cells.nb(), [&](index_t from, index_t to) {
+                    for (index_t c = from; c < to; ++c) {
+                        if (selected[c]) continue;
+                        for (index_t lf = 0; lf < 4; ++lf) {
+                            index_t adj = M.cells.adjacent(c, lf);
+                            if (adj != NO_CELL && selected[adj]) {
+                                grown[c] = 1;
+                                break;
+                            }
+                        }
+                    }
+                });
+                selected.swap(grown);
+            }
+        }
+
+        /* Connected components of the selection, grouped in at most
+         * max_parts parts of balanced sizes. Returns the number of parts */
+        index_t selection_parts(const Mesh& M, const std::vector<char>& selected,
+                                index_t max_parts, std::vector<index_t>& cell_part) {
+            index_t nc = M.cells.nb();
+            cell_part.assign(nc, FROZEN_PART);
+            std::vector<index_t> component(nc, NO_CELL);
+            std::vector<index_t> component_size;
+            std::vector<index_t> stack;
+            for (index_t seed = 0; seed < nc; ++seed) {
+                if (!selected[seed] || component[seed] != NO_CELL) continue;
+                index_t id = index_t(component_size.size());
+                component_size.push_back(0);
+                component[seed] = id;
+                stack.push_back(seed);
+                while (!stack.empty()) {
+                    index_t c = stack.back();
+                    stack.pop_back();
+                    ++component_size[id];
+                    for (index_t lf = 0; lf < 4; ++lf) {
+                        index_t adj = M.cells.adjacent(c, lf);
+                        if (adj == NO_CELL || !selected[adj] || component[adj] != NO_CELL) continue;
+                        component[adj] = id;
+                        stack.push_back(adj);
+                    }
+                }
+            }
+            index_t nb_components = index_t(component_size.size());
+            index_t nb_parts = std::min(nb_components, std::max(max_parts, index_t(1)));
+            if (nb_parts == 0) return 0;
+
+            /* largest components first, each to the least loaded part */
+            std::vector<index_t> order(nb_components);
+            for (index_t i = 0; i < nb_components; ++i) order[i] = i;
+            std::sort(order.begin(), order.end(), [&](index_t a, index_t b) {
+                return component_size[a] > component_size[b];
+            });
+            std::vector<index_t> part_of(nb_components);
+            std::vector<index_t> load(nb_parts, 0);
+            for (index_t i : order) {
+                index_t p = index_t(std::min_element(load.begin(), load.end()) - load.begin());
+                part_of[i] = p;
+                load[p] += component_size[i];
+            }
+            for (index_t c = 0; c < nc; ++c) {
+                if (component[c] != NO_CELL) cell_part[c] = part_of[component[c]];
+            }
+            return nb_parts;
+        }
+    }
+
+    bool mmg3d_tet_remesh_local(const Mesh& M_user, Mesh& M_out, const MmgOptions& opt) {
+        if (M_user.cells.nb() == 0 || !M_user.cells.are_simplices()) {
+            mmg_log_err("mmg3d_local") << "input mesh should be a tetrahedral mesh, cancel" << std::endl;
+            return false;
+        }
+        if (!M_user.facets.are_simplices()) {
+            mmg_log_err("mmg3d_local") << "input facets should be triangles, cancel" << std::endl;
+            return false;
+        }
+        Stopwatch W("mmg3d_local", false);
+        StatsRecorder clock(opt, M_user);
+
+        if (!monitor_phase(opt, MMG_PHASE_ANALYSIS)) return false;
+        /* The buffer layers, the parts and the splicing walk the cell
+         * adjacency */
+        Mesh M_connected;
+        const Mesh& M = cell_connected_input(M_user, M_connected);
+        std::vector<char> selected;
+        if (!select_cells(M, opt, selected)) return false;
+        index_t nb_selected = index_t(std::count(selected.begin(), selected.end(), 1));
+        grow_selection(M, opt.local_buffer_layers, selected);
+        index_t nb_region = index_t(std::count(selected.begin(), selected.end(), 1));
+        if (nb_region == 0) {
+            mmg_log_out("mmg3d_local") << "no cell selected, output is a copy of the input" << std::endl;
+            M_out.copy(M);
+            clock.output(M_out);
+            monitor_phase(opt, MMG_PHASE_DONE);
+            return true;
+        }
+        std::vector<index_t> cell_part;
+        index_t max_parts = (opt.nb_subdomains > 1) ? opt.nb_subdomains : Process::maximum_concurrent_threads();
+        index_t nb_parts = selection_parts(M, selected, max_parts, cell_part);
+        clock.lap(&MmgPhaseTimes::setup);
+        mmg_log_out("mmg3d_local") << nb_selected << " cells selected, " << nb_region
+            << " with the buffer (" << 100. * double(nb_region) / double(M.cells.nb())
+            << "%), in " << nb_parts << " part(s)" << std::endl;
+
+        /* conversions and mmg calls overlap across parts, all counted as mmg */
+        if (!remesh_selection(M, cell_part, nb_parts, opt, M_out)) {
+            clock.mmg_done(MMG5_STRONGFAILURE, NULL);
+            return false;
+        }
+        clock.lap(&MmgPhaseTimes::mmg);
+        clock.mmg_done(MMG5_SUCCESS, NULL);
+        clock.output(M_out);
+        monitor_phase(opt, MMG_PHASE_DONE);
+        mmg_log_out("mmg3d_local") << "remeshed in " << W.elapsed_time() << " s" << std::endl;
+        return true;
+    }
+}
@@ -0,0 +1,191 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_lod.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+#include <geogram/points/nn_search.h>
+
+#include <algorithm>
+
+namespace OGF {
+
+    namespace {
+
+        /* Levels per lane when nb_lanes is 0 */
+        const index_t LOD_LEVELS_PER_LANE = 2;
+
+        bool remesh_level(const Mesh& source, MmgLodLevel& level, const MmgOptions& level_opt) {
+            Stopwatch W("mmg_lod", false);
+            level.mesh = std::make_shared<Mesh>();
+            if (source.cells.nb() > 0) {
+                level.ok = mmg3d_tet_remesh(source, *level.mesh, level_opt);
+            } else {
+                level.ok = mmgs_tri_remesh(source, *level.mesh, level_opt);
+            }
+            level.time = W.elapsed_time();
+            if (!level.ok) level.mesh.reset();
+            return level.ok;
+        }
+
+        /* NO_VERTEX everywhere if coarse has no vertex */
+        void store_correspondence(Mesh& fine, const Mesh& coarse, const std::string& attribute_name) {
+            Attribute<index_t> nearest(fine.vertices.attributes(), attribute_name);
+            if (coarse.vertices.nb() == 0) {
+                nearest.fill(NO_VERTEX);
+                return;
+            }
+            NearestNeighborSearch_var nn = NearestNeighborSearch::create(3);
+            nn->set_points(coarse.vertices.nb(), coarse.vertices.point_ptr(0));
+            for_each_slice(fine.vertices.nb(), true, [&](index_t from, index_t to) {
+                for (index_t v = from; v < to; ++v) {
+                    nearest[v] = nn->get_nearest_neighbor(fine.vertices.point_ptr(v));
+                }
+            });
+        }
+    }
+
+    bool mmg_lod(const Mesh& M, const std::vector<double>& sizes,
+                 const MmgOptions& opt,
+                 std::vector<MmgLodLevel>& levels,
+                 index_t nb_lanes,
+                 const std::string& correspondence_attribute) {
+        levels.clear();
+        if (sizes.empty()) return true;
+        std::vector<double> hsiz = sizes;
+        std::sort(hsiz.begin(), hsiz.end());
+        if (hsiz.front() <= 0.) {
+            mmg_log_err("mmg_lod") << "the sizes should be positive" << std::endl;
+            return false;
+        }
+        bool volume = (M.cells.nb() > 0);
+        if (preflight_failed(M, volume, opt)) return false;
+        StatsRecorder clock(opt, M);
+
+        /* The levels inherit opt, the coarser ones with a proportional
+         * hausd. The wrappers run without monitor and stats, concurrently
+         * for the lanes, and do not check their input again */
+        index_t nb_levels = index_t(hsiz.size());
+        levels.resize(nb_levels);
+        std::vector<MmgOptions> level_opts(nb_levels, opt);
+        for (index_t i = 0; i < nb_levels; ++i) {
+            MmgOptions& level_opt = level_opts[i];
+            level_opt.hsiz = hsiz[i];
+            level_opt.hausd = opt.hausd * hsiz[i] / hsiz[0];
+            level_opt.metric_attribute = "no_metric";
+            level_opt.curvature_size_map = false;
+            level_opt.skip_min_quality = 0.;
+            level_opt.isolate = false;
+            level_opt.preflight = false;
+            level_opt.monitor = NULL;
+            level_opt.stats = NULL;
+            levels[i].hsiz = level_opt.hsiz;
+            levels[i].hausd = level_opt.hausd;
+        }
+
+        /* The finest level is the only one remeshed from M, with all the
+         * cores for the conversions */
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING)) return false;
+        if (!remesh_level(M, levels[0], level_opts[0])) {
+            mmg_log_err("mmg_lod") << "failed to remesh level 0 (hsiz " << hsiz[0] << ")" << std::endl;
+            clock.mmg_done(MMG5_STRONGFAILURE, NULL);
+            monitor_phase(opt, MMG_PHASE_DONE);
+            return false;
+        }
+
+        /* The other levels, in lanes of consecutive levels. Each lane starts
+         * again from level 0, not from the last level of the previous lane,
+         * so that the lanes do not wait for each other */
+        index_t nb_rest = nb_levels - 1;
+        if (nb_lanes == 0) {
+            nb_lanes = (nb_rest + LOD_LEVELS_PER_LANE - 1) / LOD_LEVELS_PER_LANE;
+            nb_lanes = std::min(nb_lanes, index_t(Process::maximum_concurrent_threads()));
+        }
+        nb_lanes = std::max(index_t(1), std::min(nb_lanes, nb_rest));
+        MmgLogBuffer* log = MmgLogScope::current();
+        parallel_for(0, nb_lanes, [&](index_t lane) {
+            MmgLogScope log_scope(log);
+            index_t begin = 1 + lane * nb_rest / nb_lanes;
+            index_t end = 1 + (lane + 1) * nb_rest / nb_lanes;
+            index_t source = 0;
+            for (index_t i = begin; i < end; ++i) {
+                if (opt.monitor != NULL && opt.monitor->cancel_requested) return;
+                level_opts[i].parallel_conversion = opt.parallel_conversion && nb_lanes == 1;
+                levels[i].source = source;
+                if (!remesh_level(*levels[source].mesh, levels[i], level_opts[i])) return;
+                source = i;
+            }
+        });
+        clock.lap(&MmgPhaseTimes::mmg);
+
+        int worst = MMG5_SUCCESS;
+        std::vector<Mesh*> kept;
+        for (index_t i = 0; i < nb_levels; ++i) {
+            const MmgLodLevel& level = levels[i];
+            if (!level.ok) {
+                mmg_log_err("mmg_lod") << "no level " << i << " (hsiz " << level.hsiz << ")" << std::endl;
+                worst = MMG5_STRONGFAILURE;
+                continue;
+            }
+            kept.push_back(level.mesh.get());
+            mmg_log_out("mmg_lod") << "level " << i << ": hsiz " << level.hsiz
+                << ", " << level.mesh->vertices.nb() << " vertices, from "
+                << (level.source == LOD_FROM_INPUT ? std::string("input") : "level " + std::to_string(level.source))
+                << ", " << level.time << " s" << std::endl;
+        }
+        clock.mmg_done(worst, NULL);
+
+        if (worst == MMG5_SUCCESS && correspondence_attribute != "no_attribute") {
+            if (!monitor_phase(opt, MMG_PHASE_CONVERSION_BACK)) return false;
+            for (index_t i = 0; i + 1 < nb_levels; ++i) {
+                store_correspondence(*levels[i].mesh, *levels[i + 1].mesh, correspondence_attribute);
+            }
+            clock.lap(&MmgPhaseTimes::transfer);
+        }
+        if (worst == MMG5_SUCCESS) clock.output(kept);
+        monitor_phase(opt, MMG_PHASE_DONE);
+        return worst == MMG5_SUCCESS;
+    }
+}
@@ -0,0 +1,99 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_LOD__H
+#define H__OGF_MMGIG_MMG_LOD__H
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace GEO {
+    class Mesh;
+}
+
+namespace OGF {
+
+    /* MmgLodLevel::source of the levels remeshed from the input */
+    const index_t LOD_FROM_INPUT = index_t(-1);
+
+    /* One level of detail produced by mmg_lod() */
+    struct MmgLodLevel {
+        double hsiz = 0.;
+        double hausd = 0.;
+        index_t source = LOD_FROM_INPUT; /* the level this one was remeshed from */
+        bool ok = false;
+        double time = 0.; /* remeshing of this level only (s) */
+        std::shared_ptr<Mesh> mesh;
+    };
+
+    /**
+     * \brief Builds levels of detail of M, one per size, from the finest to
+     *   the coarsest, each one remeshed from a finer level instead of M.
+     * \details The finest level is remeshed from M. The other ones are
+     *   split into nb_lanes chains of consecutive levels that run on
+     *   separate threads: the first level of every chain is remeshed from
+     *   the finest level (level 0), not from the last level of the previous
+     *   chain, the next ones from the previous level of their chain. More
+     *   lanes run more concurrently but start from a finer mesh; one lane
+     *   is a plain fine-to-coarse chain. hausd grows with hsiz,
+     *   opt.hausd being the one of the finest level. M is remeshed with
+     *   mmg3d if it has cells, mmgs otherwise; the metric and the
+     *   curvature size map of opt are ignored, the levels use hsiz.
+     * \param[in] sizes the hsiz of each level, in any order
+     * \param[in] nb_lanes 0 to use two levels per lane, up to the number of
+     *   cores
+     * \param[in] correspondence_attribute if not "no_attribute", an
+     *   index_t vertex attribute of each level but the coarsest, the
+     *   nearest vertex of the next coarser level
+     * \param[out] levels sorted by increasing hsiz
+     */
+    bool mmgig_API mmg_lod(const Mesh& M, const std::vector<double>& sizes,
+                           const MmgOptions& opt,
+                           std::vector<MmgLodLevel>& levels,
+                           index_t nb_lanes = 0,
+                           const std::string& correspondence_attribute = "no_attribute");
+}
+
+#endif
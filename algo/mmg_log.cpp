@@ -0,0 +1,163 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <geogram/basic/logger.h>
+
+#include <sstream>
+
+namespace OGF {
+
+    namespace {
+
+        thread_local MmgLogBuffer* current_log_buffer = NULL;
+
+        /* Adds each line to the buffer of its thread when flushed by std::endl */
+        class BufferedLine : public std::stringbuf {
+        public:
+            explicit BufferedLine(MmgLogMessage::Level level) : level_(level), buffer_(NULL) {
+            }
+
+            /* Starts a message, keeps the text of an unfinished one */
+            void begin(MmgLogBuffer* buffer, const std::string& tag) {
+                if (buffer != buffer_ || tag != tag_) sync();
+                buffer_ = buffer;
+                tag_ = tag;
+            }
+
+        protected:
+            int sync() override {
+                std::string text = str();
+                while (!text.empty() && text.back() == '\n') text.pop_back();
+                if (buffer_ != NULL && !text.empty()) {
+                    buffer_->add(level_, tag_, text);
+                }
+                str("");
+                return 0;
+            }
+
+        private:
+            MmgLogMessage::Level level_;
+            MmgLogBuffer* buffer_;
+            std::string tag_;
+        };
+
+        struct BufferedStream {
+            BufferedLine line;
+            std::ostream stream;
+            explicit BufferedStream(MmgLogMessage::Level level) : line(level), stream(&line) {
+            }
+        };
+
+        BufferedStream& thread_stream(MmgLogMessage::Level level) {
+            thread_local BufferedStream out(MmgLogMessage::OUT);
+            thread_local BufferedStream warn(MmgLogMessage::WARN);
+            thread_local BufferedStream err(MmgLogMessage::ERR);
+            return (level == MmgLogMessage::OUT) ? out : (level == MmgLogMessage::WARN) ? warn : err;
+        }
+
+        std::ostream& buffered_stream(MmgLogMessage::Level level, const std::string& tag) {
+            BufferedStream& s = thread_stream(level);
+            s.line.begin(current_log_buffer, tag);
+            return s.stream;
+        }
+    }
+
+    void MmgLogBuffer::add(MmgLogMessage::Level level, const std::string& tag, const std::string& text) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        MmgLogMessage message = { level, tag, text };
+        messages_.push_back(message);
+    }
+
+    void MmgLogBuffer::take(std::vector<MmgLogMessage>& messages) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        messages.clear();
+        messages.swap(messages_);
+    }
+
+    void MmgLogBuffer::flush() {
+        std::vector<MmgLogMessage> messages;
+        take(messages);
+        for (const MmgLogMessage& message : messages) {
+            if (message.level == MmgLogMessage::OUT) {
+                Logger::out(message.tag) << message.text << std::endl;
+            } else if (message.level == MmgLogMessage::WARN) {
+                Logger::warn(message.tag) << message.text << std::endl;
+            } else {
+                Logger::err(message.tag) << message.text << std::endl;
+            }
+        }
+    }
+
+    MmgLogScope::MmgLogScope(MmgLogBuffer* buffer) : previous_(current_log_buffer) {
+        current_log_buffer = buffer;
+    }
+
+    MmgLogScope::~MmgLogScope() {
+        /* A message without std::endl goes to the buffer while it exists */
+        if (current_log_buffer != NULL) {
+            thread_stream(MmgLogMessage::OUT).stream.flush();
+            thread_stream(MmgLogMessage::WARN).stream.flush();
+            thread_stream(MmgLogMessage::ERR).stream.flush();
+        }
+        current_log_buffer = previous_;
+    }
+
+    MmgLogBuffer* MmgLogScope::current() {
+        return current_log_buffer;
+    }
+
+    std::ostream& mmg_log_out(const std::string& tag) {
+        if (current_log_buffer == NULL) return Logger::out(tag);
+        return buffered_stream(MmgLogMessage::OUT, tag);
+    }
+
+    std::ostream& mmg_log_warn(const std::string& tag) {
+        if (current_log_buffer == NULL) return Logger::warn(tag);
+        return buffered_stream(MmgLogMessage::WARN, tag);
+    }
+
+    std::ostream& mmg_log_err(const std::string& tag) {
+        if (current_log_buffer == NULL) return Logger::err(tag);
+        return buffered_stream(MmgLogMessage::ERR, tag);
+    }
+}
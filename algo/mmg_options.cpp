@@ -0,0 +1,191 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <geogram/basic/logger.h>
+
+#include <cstdlib>
+#include <fstream>
+
+namespace OGF {
+
+    namespace {
+        bool parse_value(const std::string& value, double& result) {
+            if (value.empty()) return false;
+            char* end = NULL;
+            double x = strtod(value.c_str(), &end);
+            if (*end != '\0') return false;
+            result = x;
+            return true;
+        }
+
+        bool parse_value(const std::string& value, index_t& result) {
+            if (value.empty() || value[0] == '-') return false;
+            char* end = NULL;
+            unsigned long x = strtoul(value.c_str(), &end, 10);
+            if (*end != '\0') return false;
+            result = index_t(x);
+            return true;
+        }
+
+        bool parse_value(const std::string& value, bool& result) {
+            if (value == "1" || value == "true" || value == "yes" || value == "on") {
+                result = true;
+                return true;
+            }
+            if (value == "0" || value == "false" || value == "no" || value == "off") {
+                result = false;
+                return true;
+            }
+            return false;
+        }
+
+        bool parse_value(const std::string& value, std::string& result) {
+            result = value;
+            return true;
+        }
+
+        std::string trim(const std::string& s) {
+            const char* blanks = " \t\r\n";
+            std::size_t b = s.find_first_not_of(blanks);
+            if (b == std::string::npos) return std::string();
+            std::size_t e = s.find_last_not_of(blanks);
+            return s.substr(b, e - b + 1);
+        }
+    }
+
+    bool mmg_options_set(MmgOptions& opt, const std::string& key, const std::string& value) {
+        bool found = true;
+        bool ok = false;
+#define MMGIG_OPTION(name) else if (key == #name) ok = parse_value(value, opt.name)
+        if (false) {}
+        MMGIG_OPTION(angle_detection);
+        MMGIG_OPTION(angle_value);
+        MMGIG_OPTION(hausd);
+        MMGIG_OPTION(hsiz);
+        MMGIG_OPTION(hmin);
+        MMGIG_OPTION(hmax);
+        MMGIG_OPTION(hgrad);
+        MMGIG_OPTION(enable_anisotropy);
+        MMGIG_OPTION(optim);
+        MMGIG_OPTION(optimLES);
+        MMGIG_OPTION(opnbdy);
+        MMGIG_OPTION(noinsert);
+        MMGIG_OPTION(noswap);
+        MMGIG_OPTION(nomove);
+        MMGIG_OPTION(nosurf);
+        MMGIG_OPTION(metric_attribute);
+        MMGIG_OPTION(curvature_size_map);
+        MMGIG_OPTION(metric_scale);
+        MMGIG_OPTION(target_elements);
+        MMGIG_OPTION(memory_budget);
+        MMGIG_OPTION(level_set);
+        MMGIG_OPTION(ls_attribute);
+        MMGIG_OPTION(ls_value);
+        MMGIG_OPTION(iso_output);
+        MMGIG_OPTION(displacement_attribute);
+        MMGIG_OPTION(lagrangian_mode);
+        MMGIG_OPTION(edge_attribute);
+        MMGIG_OPTION(facet_attribute);
+        MMGIG_OPTION(cell_attribute);
+        MMGIG_OPTION(parallel_conversion);
+        MMGIG_OPTION(bulk_conversion);
+        MMGIG_OPTION(preflight);
+        MMGIG_OPTION(reorder);
+        MMGIG_OPTION(isolate);
+        MMGIG_OPTION(worker_timeout);
+        MMGIG_OPTION(worker_memory_limit);
+        MMGIG_OPTION(output_adjacency);
+        MMGIG_OPTION(transfer_attributes);
+        MMGIG_OPTION(skip_min_quality);
+        MMGIG_OPTION(nb_subdomains);
+        MMGIG_OPTION(nb_interface_passes);
+        MMGIG_OPTION(interface_layers);
+        MMGIG_OPTION(local_cell_attribute);
+        MMGIG_OPTION(local_box);
+        MMGIG_OPTION(local_min_quality);
+        MMGIG_OPTION(local_buffer_layers);
+        MMGIG_OPTION(parmmg_nb_procs);
+        MMGIG_OPTION(parmmg_executable);
+        MMGIG_OPTION(mpiexec_executable);
+        else found = false;
+#undef MMGIG_OPTION
+        if (!found) {
+            mmg_log_err("mmg_options") << "unknown option " << key << std::endl;
+            return false;
+        }
+        if (!ok) {
+            mmg_log_err("mmg_options") << "invalid value '" << value << "' for " << key << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool mmg_options_load(MmgOptions& opt, const std::string& filename) {
+        std::ifstream in(filename.c_str());
+        if (!in) {
+            mmg_log_err("mmg_options") << "cannot open " << filename << std::endl;
+            return false;
+        }
+        std::string line;
+        index_t line_nb = 0;
+        while (std::getline(in, line)) {
+            ++line_nb;
+            std::size_t comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.erase(comment);
+            }
+            line = trim(line);
+            if (line.empty()) continue;
+            std::size_t eq = line.find('=');
+            if (eq == std::string::npos) {
+                mmg_log_err("mmg_options") << filename << ":" << line_nb << ": expected key = value" << std::endl;
+                return false;
+            }
+            if (!mmg_options_set(opt, trim(line.substr(0, eq)), trim(line.substr(eq + 1)))) {
+                mmg_log_err("mmg_options") << "in " << filename << ":" << line_nb << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,224 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+#include <OGF/mmgig/algo/mmg_submesh.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+#include <algorithm>
+
+namespace OGF {
+    using namespace GEO;
+
+    namespace {
+
+        /* Recursive coordinate bisection of the cells [begin,end) along the
+         * longest axis of their centers */
+        void bisect(const std::vector<double>& centers,
+                    std::vector<index_t>::iterator begin,
+                    std::vector<index_t>::iterator end,
+                    index_t first_part, index_t nb_parts,
+                    std::vector<index_t>& cell_part) {
+            if (nb_parts <= 1 || end - begin <= 1) {
+                for (auto it = begin; it != end; ++it) {
+                    cell_part[*it] = first_part;
+                }
+                return;
+            }
+            double xyzmin[3] = { DBL_MAX,  DBL_MAX,  DBL_MAX};
+            double xyzmax[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+            for (auto it = begin; it != end; ++it) {
+                for (index_t d = 0; d < 3; ++d) {
+                    xyzmin[d] = geo_min(xyzmin[d], centers[3*(*it)+d]);
+                    xyzmax[d] = geo_max(xyzmax[d], centers[3*(*it)+d]);
+                }
+            }
+            index_t axis = 0;
+            for (index_t d = 1; d < 3; ++d) {
+                if (xyzmax[d] - xyzmin[d] > xyzmax[axis] - xyzmin[axis]) axis = d;
+            }
+            index_t nb_left = nb_parts / 2;
+            auto mid = begin + (end - begin) * (std::ptrdiff_t) nb_left / (std::ptrdiff_t) nb_parts;
+            std::nth_element(begin, mid, end, [&](index_t a, index_t b) {
+                return centers[3*a+axis] < centers[3*b+axis];
+            });
+            bisect(centers, begin, mid, first_part, nb_left, cell_part);
+            bisect(centers, mid, end, first_part + nb_left, nb_parts - nb_left, cell_part);
+        }
+
+        void partition_cells(const Mesh& M, index_t nb_parts, std::vector<index_t>& cell_part) {
+            std::vector<double> centers(3 * M.cells.nb());
+            parallel_for_slice(0, M.cells.nb(), [&](index_t from, index_t to) {
+                for (index_t c = from; c < to; ++c) {
+                    for (index_t d = 0; d < 3; ++d) {
+                        double s = 0.;
+                        for (index_t lv = 0; lv < 4; ++lv) {
+                            s += M.vertices.point_ptr(M.cells.vertex(c,lv))[d];
+                        }
+                        centers[3*c+d] = 0.25 * s;
+                    }
+                }
+            });
+            std::vector<index_t> cells(M.cells.nb());
+            for (index_t c = 0; c < M.cells.nb(); ++c) cells[c] = c;
+            cell_part.assign(M.cells.nb(), 0);
+            bisect(centers, cells.begin(), cells.end(), 0, nb_parts, cell_part);
+        }
+
+        /* Cells at most nb_layers cells away from a face between two parts */
+        void interface_region(const Mesh& M, const std::vector<index_t>& cell_part,
+                              index_t nb_layers, std::vector<bool>& in_region) {
+            in_region.assign(M.cells.nb(), false);
+            for (index_t c = 0; c < M.cells.nb(); ++c) {
+                for (index_t lf = 0; lf < 4; ++lf) {
+                    index_t adj = M.cells.adjacent(c,lf);
+                    if (adj != NO_CELL && cell_part[adj] != cell_part[c]) {
+                        in_region[c] = true;
+                    }
+                }
+            }
+            for (index_t layer = 1; layer < nb_layers; ++layer) {
+                std::vector<bool> grown = in_region;
+                for (index_t c = 0; c < M.cells.nb(); ++c) {
+                    if (in_region[c]) continue;
+                    for (index_t lf = 0; lf < 4; ++lf) {
+                        index_t adj = M.cells.adjacent(c,lf);
+                        if (adj != NO_CELL && in_region[adj]) grown[c] = true;
+                    }
+                }
+                in_region.swap(grown);
+            }
+        }
+
+        /* Moves the faces between parts by nb_layers cells: the cells next to
+         * a part of lower index join it */
+        void move_interfaces(const Mesh& M, index_t nb_layers, std::vector<index_t>& cell_part) {
+            for (index_t layer = 0; layer < nb_layers; ++layer) {
+                std::vector<index_t> moved = cell_part;
+                parallel_for_slice(0, M.cells.nb(), [&](index_t from, index_t to) {
+                    for (index_t c = from; c < to; ++c) {
+                        for (index_t lf = 0; lf < 4; ++lf) {
+                            index_t adj = M.cells.adjacent(c,lf);
+                            if (adj != NO_CELL && cell_part[adj] < moved[c]) {
+                                moved[c] = cell_part[adj];
+                            }
+                        }
+                    }
+                });
+                cell_part.swap(moved);
+            }
+        }
+    }
+
+    bool mmg3d_tet_remesh_parallel(const Mesh& M, Mesh& M_out, const MmgOptions& opt) {
+        if (M.cells.nb() == 0 || !M.cells.are_simplices()) {
+            mmg_log_err("mmg3d_parallel") << "input mesh should be a tetrahedral mesh, cancel" << std::endl;
+            return false;
+        }
+        if (!M.facets.are_simplices()) {
+            mmg_log_err("mmg3d_parallel") << "input facets should be triangles, cancel" << std::endl;
+            return false;
+        }
+        index_t nb_parts = geo_max(opt.nb_subdomains, index_t(1));
+        Stopwatch W("mmg3d_parallel", false);
+        /* conversions and mmg calls overlap across parts, all counted as mmg */
+        StatsRecorder clock(opt, M);
+
+        if (!monitor_phase(opt, MMG_PHASE_ANALYSIS)) return false;
+        Mesh M_connected;
+        const Mesh& M_in = cell_connected_input(M, M_connected);
+        std::vector<index_t> cell_part;
+        partition_cells(M_in, nb_parts, cell_part);
+
+        /* First pass: every part, with the faces between parts frozen */
+        Mesh passes[2];
+        Mesh* current = (opt.nb_interface_passes == 0) ? &M_out : &passes[0];
+        if (!remesh_parts(M_in, cell_part, nb_parts, opt, *current, &cell_part)) {
+            clock.mmg_done(MMG5_STRONGFAILURE, NULL);
+            return false;
+        }
+
+        /* Next passes: the interfaces are moved inside the parts of lower
+         * index, and the cells around the previous interfaces are remeshed
+         * again, the rest is frozen */
+        for (index_t pass = 1; pass <= opt.nb_interface_passes; ++pass) {
+            std::vector<bool> in_region;
+            interface_region(*current, cell_part, 2 * opt.interface_layers, in_region);
+            move_interfaces(*current, opt.interface_layers, cell_part);
+            std::vector<index_t> frozen_part;
+            index_t nb_in_region = 0;
+            for (index_t c = 0; c < current->cells.nb(); ++c) {
+                if (in_region[c]) {
+                    ++nb_in_region;
+                } else {
+                    frozen_part.push_back(cell_part[c]);
+                    cell_part[c] = FROZEN_PART;
+                }
+            }
+            mmg_log_out("mmg3d_parallel") << "pass " << pass + 1 << ": " << nb_in_region
+                << " cells around the interfaces" << std::endl;
+            Mesh* next = (pass == opt.nb_interface_passes) ? &M_out : &passes[pass % 2];
+            if (!remesh_parts(*current, cell_part, nb_parts, opt, *next, &cell_part)) {
+                clock.mmg_done(MMG5_STRONGFAILURE, NULL);
+                return false;
+            }
+            /* the frozen cells come first in the output, in the same order */
+            for (index_t c = 0; c < frozen_part.size(); ++c) {
+                cell_part[c] = frozen_part[c];
+            }
+            current = next;
+        }
+
+        clock.lap(&MmgPhaseTimes::mmg);
+        clock.mmg_done(MMG5_SUCCESS, NULL);
+        clock.output(M_out);
+        monitor_phase(opt, MMG_PHASE_DONE);
+        mmg_log_out("mmg3d_parallel") << "remeshed in " << W.elapsed_time() << " s with "
+            << nb_parts << " subdomains and " << opt.nb_interface_passes
+            << " interface passes" << std::endl;
+        return true;
+    }
+}
+
@@ -0,0 +1,194 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+#include <cstdlib>
+#include <sstream>
+
+#ifdef GEO_OS_UNIX
+#include <unistd.h>
+#endif
+
+/* Default executables, set by CMake when they are found */
+#ifndef MMGIG_PARMMG_EXECUTABLE
+#define MMGIG_PARMMG_EXECUTABLE "parmmg_O3"
+#endif
+#ifndef MMGIG_MPIEXEC_EXECUTABLE
+#define MMGIG_MPIEXEC_EXECUTABLE "mpirun"
+#endif
+
+namespace OGF {
+    using namespace GEO;
+
+    namespace {
+        /* ParMmg command line, the options follow the mmg3d ones */
+        std::string parmmg_command(const MmgOptions& opt,
+                                   const std::string& mesh_in,
+                                   const std::string& sol_in,
+                                   const std::string& mesh_out) {
+            std::ostringstream cmd;
+            cmd.precision(17);
+            cmd << "\"" << (opt.mpiexec_executable.empty() ? MMGIG_MPIEXEC_EXECUTABLE : opt.mpiexec_executable.c_str()) << "\""
+                << " -np " << opt.parmmg_nb_procs
+                << " \"" << (opt.parmmg_executable.empty() ? MMGIG_PARMMG_EXECUTABLE : opt.parmmg_executable.c_str()) << "\""
+                << " -in \"" << mesh_in << "\"";
+            if (!sol_in.empty()) {
+                cmd << " -sol \"" << sol_in << "\"";
+            }
+            cmd << " -out \"" << mesh_out << "\"";
+            if (opt.hsiz == 0. || !sol_in.empty()) {
+                cmd << " -hmin " << opt.hmin << " -hmax " << opt.hmax;
+            } else {
+                cmd << " -hsiz " << opt.hsiz;
+            }
+            cmd << " -hausd " << opt.hausd << " -hgrad " << opt.hgrad;
+            if (opt.angle_detection) {
+                cmd << " -ar " << opt.angle_value;
+            } else {
+                cmd << " -nr";
+            }
+            if (opt.optim) cmd << " -optim";
+            if (opt.noinsert) cmd << " -noinsert";
+            if (opt.noswap) cmd << " -noswap";
+            if (opt.nomove) cmd << " -nomove";
+            if (opt.nosurf) cmd << " -nosurf";
+            return cmd.str();
+        }
+    }
+
+    bool parmmg_tet_remesh(const Mesh& M, Mesh& M_out, const MmgOptions& opt) {
+#ifndef GEO_OS_UNIX
+        geo_argused(M);
+        geo_argused(M_out);
+        geo_argused(opt);
+        mmg_log_err("parmmg_remesh") << "ParMmg backend is only available on Unix" << std::endl;
+        return false;
+#else
+        Stopwatch W("parmmg_remesh", false);
+        StatsRecorder clock(opt, M);
+        char dir_template[] = "/tmp/mmgig_parmmg_XXXXXX";
+        if (mkdtemp(dir_template) == NULL) {
+            mmg_log_err("parmmg_remesh") << "failed to create a temporary directory" << std::endl;
+            return false;
+        }
+        std::string dir = dir_template;
+        std::string mesh_in = dir + "/in.mesh";
+        std::string sol_in = dir + "/in.sol";
+        std::string mesh_out = dir + "/out.mesh";
+        std::string sol_out = dir + "/out.sol";
+
+        /* Write the input with mmg, so that the refs are in the file */
+        MMG5_pMesh mesh = NULL;
+        MMG5_pSol met = NULL;
+        bool has_metric = has_input_metric(opt);
+        bool ok = monitor_phase(opt, MMG_PHASE_CONVERSION)
+            && geo_to_mmg(M, mesh, met, true, opt.enable_anisotropy, opt.edge_attribute,
+                             opt.facet_attribute, opt.cell_attribute, opt.parallel_conversion, opt.bulk_conversion);
+        if (ok && has_metric) {
+            ok = set_input_metric(M, mesh, met, true, opt);
+        }
+        if (ok) {
+            ok = (MMG3D_saveMesh(mesh, mesh_in.c_str()) == 1)
+                && (!has_metric || MMG3D_saveSol(mesh, met, sol_in.c_str()) == 1);
+            if (!ok) {
+                mmg_log_err("parmmg_remesh") << "failed to write " << mesh_in << std::endl;
+            }
+        }
+        mmg3d_free(mesh, met);
+        mesh = NULL;
+        met = NULL;
+        double t_write = W.elapsed_time();
+        clock.lap(&MmgPhaseTimes::geo_to_mmg);
+
+        ok = ok && monitor_phase(opt, MMG_PHASE_REMESHING);
+        if (ok) {
+            std::string cmd = parmmg_command(opt, mesh_in, has_metric ? sol_in : std::string(), mesh_out);
+            mmg_log_out("parmmg_remesh") << cmd << std::endl;
+            int status = std::system(cmd.c_str());
+            if (status != 0) {
+                mmg_log_err("parmmg_remesh") << "ParMmg failed (exit status " << status << ")" << std::endl;
+                ok = false;
+            }
+        }
+        double t_run = W.elapsed_time() - t_write;
+        clock.lap(&MmgPhaseTimes::mmg);
+        clock.mmg_done(ok ? MMG5_SUCCESS : MMG5_STRONGFAILURE, NULL);
+
+        ok = ok && monitor_phase(opt, MMG_PHASE_CONVERSION_BACK);
+        if (ok) {
+            MMG3D_Init_mesh(MMG5_ARG_start, MMG5_ARG_ppMesh,&mesh,MMG5_ARG_ppMet,&met, MMG5_ARG_end);
+            ok = (MMG3D_loadMesh(mesh, mesh_out.c_str()) == 1);
+            if (ok) {
+                /* no adjacency in the file, connect() unless disabled */
+                ok = mmg_to_geo(mesh, M_out, opt.edge_attribute, opt.facet_attribute,
+                                opt.cell_attribute, opt.parallel_conversion,
+                                opt.output_adjacency != "none", opt.bulk_conversion);
+            } else {
+                mmg_log_err("parmmg_remesh") << "failed to read " << mesh_out << std::endl;
+            }
+            mmg3d_free(mesh, met);
+            clock.lap(&MmgPhaseTimes::mmg_to_geo);
+            if (ok) clock.output(M_out);
+        }
+
+        const std::string files[] = { mesh_in, sol_in, mesh_out, sol_out };
+        for (const std::string& f: files) {
+            unlink(f.c_str());
+        }
+        rmdir(dir.c_str());
+
+        if (ok) {
+            monitor_phase(opt, MMG_PHASE_DONE);
+            mmg_log_out("parmmg_remesh") << opt.parmmg_nb_procs << " processes: write " << t_write
+                << " s, ParMmg " << t_run << " s, read " << W.elapsed_time() - t_write - t_run
+                << " s" << std::endl;
+        }
+        return ok;
+#endif
+    }
+}
+
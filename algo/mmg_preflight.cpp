@@ -0,0 +1,398 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_preflight.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/algorithm.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+#include <geogram/mesh/mesh_geometry.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+
+namespace OGF {
+
+    namespace {
+
+        /* Elements per task of the parallel loops */
+        const index_t PREFLIGHT_CHUNK_SIZE = 16384;
+
+        /* Relative volume (area) below which an element is degenerate */
+        const double DEGENERATE_RATIO = 1e-12;
+
+        /* Runs func(from, to) on contiguous chunks and returns the sum of
+         * the counts, independent of the number of threads */
+        index_t count_in_chunks(index_t n, const std::function<index_t(index_t, index_t)>& func) {
+            index_t nb_chunks = (n + PREFLIGHT_CHUNK_SIZE - 1) / PREFLIGHT_CHUNK_SIZE;
+            std::vector<index_t> counts(nb_chunks, 0);
+            parallel_for(0, nb_chunks, [&](index_t chunk) {
+                index_t from = chunk * PREFLIGHT_CHUNK_SIZE;
+                counts[chunk] = func(from, std::min(n, from + PREFLIGHT_CHUNK_SIZE));
+            });
+            index_t total = 0;
+            for (index_t c : counts) total += c;
+            return total;
+        }
+
+        uint64_t hash_cell(int64_t x, int64_t y, int64_t z) {
+            uint64_t h = uint64_t(x) * 0x9E3779B97F4A7C15ULL;
+            h ^= uint64_t(y) + 0xC2B2AE3D27D4EB4FULL + (h << 6) + (h >> 2);
+            h ^= uint64_t(z) + 0x165667B19E3779F9ULL + (h << 6) + (h >> 2);
+            return h;
+        }
+
+        index_t count_duplicate_vertices(const Mesh& M, double tolerance) {
+            index_t nv = M.vertices.nb();
+            if (nv < 2) return 0;
+            double xyzmin[3];
+            double xyzmax[3];
+            GEO::get_bbox(M, xyzmin, xyzmax);
+            double diag2 = 0.;
+            for (index_t d = 0; d < 3; ++d) {
+                diag2 += (xyzmax[d] - xyzmin[d]) * (xyzmax[d] - xyzmin[d]);
+            }
+            double step = tolerance * std::sqrt(diag2);
+            if (step <= 0.) step = 1.;
+            auto grid_cell = [&](index_t v, int64_t* q) {
+                const double* p = M.vertices.point_ptr(v);
+                for (index_t d = 0; d < 3; ++d) {
+                    q[d] = int64_t(std::floor((p[d] - xyzmin[d]) / step));
+                }
+            };
+
+            /* spatial hashing: the vertices sorted by the hash of their grid
+             * cell of size step. A vertex closer than step to a previous one
+             * is in one of the 27 cells around its own, the hash collisions
+             * are resolved by the distance itself */
+            std::vector<std::pair<uint64_t, index_t> > keys(nv);
+            parallel_for_slice(0, nv, [&](index_t from, index_t to) {
+                int64_t q[3];
+                for (index_t v = from; v < to; ++v) {
+                    grid_cell(v, q);
+                    keys[v] = std::make_pair(hash_cell(q[0], q[1], q[2]), v);
+                }
+            });
+            GEO::sort(keys.begin(), keys.end());
+
+            double step2 = step * step;
+            auto has_previous = [&](index_t v) {
+                const double* p = M.vertices.point_ptr(v);
+                int64_t q[3];
+                grid_cell(v, q);
+                for (int64_t dx = -1; dx <= 1; ++dx) {
+                    for (int64_t dy = -1; dy <= 1; ++dy) {
+                        for (int64_t dz = -1; dz <= 1; ++dz) {
+                            uint64_t h = hash_cell(q[0] + dx, q[1] + dy, q[2] + dz);
+                            auto it = std::lower_bound(keys.begin(), keys.end(), std::make_pair(h, index_t(0)));
+                            for (; it != keys.end() && it->first == h && it->second < v; ++it) {
+                                const double* r = M.vertices.point_ptr(it->second);
+                                double d2 = (p[0] - r[0]) * (p[0] - r[0]) + (p[1] - r[1]) * (p[1] - r[1])
+                                    + (p[2] - r[2]) * (p[2] - r[2]);
+                                if (d2 <= step2) return true;
+                            }
+                        }
+                    }
+                }
+                return false;
+            };
+            return count_in_chunks(nv, [&](index_t from, index_t to) {
+                index_t nb = 0;
+                for (index_t v = from; v < to; ++v) {
+                    if (has_previous(v)) ++nb;
+                }
+                return nb;
+            });
+        }
+
+        /* Sorted runs of equal keys: counts the keys used once and the ones
+         * used more than twice */
+        template <class KEY> void count_runs(std::vector<KEY>& keys, index_t& nb_single, index_t& nb_over) {
+            GEO::sort(keys.begin(), keys.end());
+            nb_single = 0;
+            nb_over = 0;
+            index_t begin = 0;
+            index_t n = index_t(keys.size());
+            while (begin < n) {
+                index_t end = begin + 1;
+                while (end < n && keys[end] == keys[begin]) ++end;
+                if (end - begin == 1) ++nb_single;
+                if (end - begin > 2) ++nb_over;
+                begin = end;
+            }
+        }
+
+        void check_tets(const Mesh& M, MmgPreflightReport& report) {
+            index_t nc = M.cells.nb();
+            report.nb_non_simplicial = count_in_chunks(nc, [&](index_t from, index_t to) {
+                index_t nb = 0;
+                for (index_t c = from; c < to; ++c) {
+                    if (M.cells.type(c) != MESH_TET && M.cells.type(c) != MESH_PRISM) ++nb;
+                }
+                return nb;
+            });
+            report.nb_prisms = count_in_chunks(nc, [&](index_t from, index_t to) {
+                index_t nb = 0;
+                for (index_t c = from; c < to; ++c) {
+                    if (M.cells.type(c) == MESH_PRISM) ++nb;
+                }
+                return nb;
+            });
+            if (report.nb_non_simplicial > 0 || report.bad_dimension) return;
+
+            /* the prisms are not remeshed, only the tets are checked. Their
+             * triangles take part in the manifold check, a tet face can be
+             * glued to a prism */
+            bool mixed = (report.nb_prisms > 0);
+            const index_t* corners = (nc == 0 || mixed) ? NULL : M.cell_corners.vertex_index_ptr(0);
+            std::vector<char> negative(nc, 0);
+            report.nb_degenerate = count_in_chunks(nc, [&](index_t from, index_t to) {
+                index_t nb = 0;
+                vec3 p[4];
+                for (index_t c = from; c < to; ++c) {
+                    if (mixed && M.cells.type(c) != MESH_TET) continue;
+                    for (index_t lv = 0; lv < 4; ++lv) {
+                        p[lv] = vec3(M.vertices.point_ptr(mixed ? M.cells.vertex(c, lv) : corners[4 * c + lv]));
+                    }
+                    double max_l2 = 0.;
+                    for (index_t i = 0; i < 4; ++i) {
+                        for (index_t j = i + 1; j < 4; ++j) {
+                            vec3 e = p[j] - p[i];
+                            max_l2 = std::max(max_l2, dot(e, e));
+                        }
+                    }
+                    double six_volume = dot(p[1] - p[0], cross(p[2] - p[0], p[3] - p[0]));
+                    negative[c] = (six_volume < 0.);
+                    if (std::fabs(six_volume) <= DEGENERATE_RATIO * max_l2 * std::sqrt(max_l2)) ++nb;
+                }
+                return nb;
+            });
+            index_t nb_negative = count_in_chunks(nc, [&](index_t from, index_t to) {
+                return index_t(std::count(negative.begin() + from, negative.begin() + to, 1));
+            });
+            /* as in compute_mesh_quality(), the orientation of the input is
+             * the one of the majority */
+            index_t nb_tets = nc - report.nb_prisms;
+            report.nb_inverted = std::min(nb_negative, nb_tets - nb_negative);
+
+            if (mixed) {
+                /* 4 triangles per tet, 2 per prism */
+                std::vector<size_t> first_face(nc + 1, 0);
+                for (index_t c = 0; c < nc; ++c) {
+                    first_face[c + 1] = first_face[c] + (M.cells.type(c) == MESH_TET ? 4 : 2);
+                }
+                std::vector<std::array<index_t, 3> > faces(first_face[nc]);
+                parallel_for_slice(0, nc, [&](index_t from, index_t to) {
+                    for (index_t c = from; c < to; ++c) {
+                        size_t i = first_face[c];
+                        for (index_t lf = 0; lf < M.cells.nb_facets(c); ++lf) {
+                            if (M.cells.facet_nb_vertices(c, lf) != 3) continue;
+                            std::array<index_t, 3>& f = faces[i++];
+                            for (index_t k = 0; k < 3; ++k) {
+                                f[k] = M.cells.facet_vertex(c, lf, k);
+                            }
+                            std::sort(f.begin(), f.end());
+                        }
+                    }
+                });
+                index_t nb_boundary = 0;
+                count_runs(faces, nb_boundary, report.nb_non_manifold);
+                return;
+            }
+
+            std::vector<std::array<index_t, 3> > faces(4 * size_t(nc));
+            parallel_for_slice(0, nc, [&](index_t from, index_t to) {
+                for (index_t c = from; c < to; ++c) {
+                    for (index_t lf = 0; lf < 4; ++lf) {
+                        std::array<index_t, 3>& f = faces[4 * size_t(c) + lf];
+                        for (index_t k = 0; k < 3; ++k) {
+                            f[k] = corners[4 * c + (lf + 1 + k) % 4];
+                        }
+                        std::sort(f.begin(), f.end());
+                    }
+                }
+            });
+            index_t nb_boundary = 0;
+            count_runs(faces, nb_boundary, report.nb_non_manifold);
+        }
+
+        void check_triangles(const Mesh& M, MmgPreflightReport& report) {
+            index_t nf = M.facets.nb();
+            report.nb_non_simplicial = count_in_chunks(nf, [&](index_t from, index_t to) {
+                index_t nb = 0;
+                for (index_t f = from; f < to; ++f) {
+                    if (M.facets.nb_vertices(f) != 3) ++nb;
+                }
+                return nb;
+            });
+            if (report.nb_non_simplicial > 0 || report.bad_dimension) return;
+
+            const index_t* corners = (nf == 0) ? NULL : M.facet_corners.vertex_index_ptr(0);
+            report.nb_degenerate = count_in_chunks(nf, [&](index_t from, index_t to) {
+                index_t nb = 0;
+                for (index_t f = from; f < to; ++f) {
+                    vec3 p0(M.vertices.point_ptr(corners[3 * f]));
+                    vec3 p1(M.vertices.point_ptr(corners[3 * f + 1]));
+                    vec3 p2(M.vertices.point_ptr(corners[3 * f + 2]));
+                    vec3 e[3] = { p1 - p0, p2 - p1, p0 - p2 };
+                    double max_l2 = std::max(dot(e[0], e[0]), std::max(dot(e[1], e[1]), dot(e[2], e[2])));
+                    vec3 n = cross(e[0], -1. * e[2]);
+                    if (std::sqrt(dot(n, n)) <= DEGENERATE_RATIO * max_l2) ++nb;
+                }
+                return nb;
+            });
+
+            std::vector<uint64_t> edges(3 * size_t(nf));
+            parallel_for_slice(0, nf, [&](index_t from, index_t to) {
+                for (index_t f = from; f < to; ++f) {
+                    for (index_t le = 0; le < 3; ++le) {
+                        uint64_t a = corners[3 * f + le];
+                        uint64_t b = corners[3 * f + (le + 1) % 3];
+                        edges[3 * size_t(f) + le] = (std::min(a, b) << 32) | std::max(a, b);
+                    }
+                }
+            });
+            count_runs(edges, report.nb_border_edges, report.nb_non_manifold);
+        }
+
+        template <class T> const char* type_name();
+        template <> const char* type_name<double>() { return "double"; }
+        template <> const char* type_name<int>() { return "int"; }
+
+        /* Appends an error if name is set but is not an attribute of
+         * manager of type T with one of the dimensions (any if empty) */
+        template <class T> void check_attribute(const AttributesManager& manager, index_t nb_elements,
+                                                const char* where, const std::string& name,
+                                                const std::vector<index_t>& dimensions,
+                                                std::vector<std::string>& errors) {
+            if (name == "no_attribute" || name == "no_metric" || name == "no_ls" || name.empty()) return;
+            std::ostringstream error;
+            AttributesManager& attributes = const_cast<AttributesManager&>(manager);
+            const AttributeStore* store = manager.find_attribute_store(name);
+            if (store == NULL || !Attribute<T>::is_defined(attributes, name)) {
+                error << where << " attribute " << name << " is missing or not of type "
+                      << type_name<T>();
+            } else if (!dimensions.empty()
+                       && std::find(dimensions.begin(), dimensions.end(), store->dimension()) == dimensions.end()) {
+                error << where << " attribute " << name << " has dimension " << store->dimension()
+                      << ", expected " << dimensions[0];
+            } else if (store->size() != nb_elements) {
+                error << where << " attribute " << name << " has " << store->size()
+                      << " items for " << nb_elements << " elements";
+            } else {
+                return;
+            }
+            errors.push_back(error.str());
+        }
+
+        void check_attributes(const Mesh& M, const MmgOptions& opt, MmgPreflightReport& report) {
+            std::vector<std::string>& errors = report.attribute_errors;
+            check_attribute<double>(M.vertices.attributes(), M.vertices.nb(), "vertex", opt.metric_attribute,
+                                    std::vector<index_t>(1, opt.enable_anisotropy ? 6 : 1), errors);
+            if (opt.level_set) {
+                check_attribute<double>(M.vertices.attributes(), M.vertices.nb(), "vertex", opt.ls_attribute,
+                                        std::vector<index_t>(1, 1), errors);
+            }
+            check_attribute<double>(M.vertices.attributes(), M.vertices.nb(), "vertex", opt.displacement_attribute,
+                                    std::vector<index_t>(1, 3), errors);
+            check_attribute<int>(M.edges.attributes(), M.edges.nb(), "edge", opt.edge_attribute,
+                                 std::vector<index_t>(1, 1), errors);
+            check_attribute<int>(M.facets.attributes(), M.facets.nb(), "facet", opt.facet_attribute,
+                                 std::vector<index_t>(1, 1), errors);
+            if (!report.volume) return;
+            check_attribute<int>(M.cells.attributes(), M.cells.nb(), "cell", opt.cell_attribute,
+                                 std::vector<index_t>(1, 1), errors);
+            check_attribute<int>(M.cells.attributes(), M.cells.nb(), "cell", opt.local_cell_attribute,
+                                 std::vector<index_t>(1, 1), errors);
+        }
+    }
+
+    bool MmgPreflightReport::ok() const {
+        return !bad_dimension && nb_non_simplicial == 0 && nb_degenerate == 0
+            && nb_duplicate_vertices == 0 && nb_non_manifold == 0 && attribute_errors.empty();
+    }
+
+    std::string MmgPreflightReport::to_json() const {
+        std::ostringstream out;
+        out << "{\"elements\": \"" << (volume ? "tets" : "triangles") << "\""
+            << ", \"ok\": " << (ok() ? "true" : "false")
+            << ", \"bad_dimension\": " << (bad_dimension ? "true" : "false")
+            << ", \"non_simplicial\": " << nb_non_simplicial
+            << ", \"prisms\": " << nb_prisms
+            << ", \"inverted\": " << nb_inverted
+            << ", \"degenerate\": " << nb_degenerate
+            << ", \"duplicate_vertices\": " << nb_duplicate_vertices
+            << ", \"non_manifold\": " << nb_non_manifold
+            << ", \"border_edges\": " << nb_border_edges
+            << ", \"attribute_errors\": [";
+        for (index_t i = 0; i < attribute_errors.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << "\"" << attribute_errors[i] << "\"";
+        }
+        out << "], \"time\": " << time << "}";
+        return out.str();
+    }
+
+    bool preflight_check(const Mesh& M, bool volume_mesh, const MmgOptions& opt,
+                         MmgPreflightReport& report, double duplicate_tolerance) {
+        Stopwatch W("mmg_preflight", false);
+        report = MmgPreflightReport();
+        report.volume = volume_mesh;
+        report.bad_dimension = (M.vertices.dimension() != 3);
+        if (volume_mesh) {
+            check_tets(M, report);
+        } else {
+            check_triangles(M, report);
+        }
+        if (!report.bad_dimension) {
+            report.nb_duplicate_vertices = count_duplicate_vertices(M, duplicate_tolerance);
+        }
+        check_attributes(M, opt, report);
+        report.time = W.elapsed_time();
+        return report.ok();
+    }
+}
@@ -0,0 +1,102 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_PREFLIGHT__H
+#define H__OGF_MMGIG_MMG_PREFLIGHT__H
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <string>
+#include <vector>
+
+namespace GEO {
+    class Mesh;
+}
+
+namespace OGF {
+
+    /* Problems of an input found by preflight_check(), before any mmg call */
+    struct MmgPreflightReport {
+        bool volume = true; /* checked for mmg3d (tets) or mmgs (triangles) */
+        bool bad_dimension = false; /* vertices not of dimension 3 */
+        /* cells that are neither tets nor prisms, or facets that are not
+         * triangles (mmgs) */
+        index_t nb_non_simplicial = 0;
+        index_t nb_prisms = 0; /* kept as they are by mmg3d, not an error */
+        /* tets oriented against the majority. mmg reorients them one by
+         * one, this is reported but not an error */
+        index_t nb_inverted = 0;
+        index_t nb_degenerate = 0; /* flat tets, or triangles of zero area */
+        index_t nb_duplicate_vertices = 0; /* vertices at the position of a previous one */
+        /* tet faces shared by more than two tets, or triangle edges shared
+         * by more than two triangles */
+        index_t nb_non_manifold = 0;
+        /* triangle edges used by a single triangle (mmgs only). mmgs
+         * remeshes open surfaces, this is reported but not an error */
+        index_t nb_border_edges = 0;
+        /* attributes of the options that are missing or of the wrong type,
+         * dimension or size */
+        std::vector<std::string> attribute_errors;
+        double time = 0.;
+
+        /* No error, the mesh can be given to mmg */
+        bool ok() const;
+
+        /* One line JSON object, as MmgRemeshStats */
+        std::string to_json() const;
+    };
+
+    /**
+     * \brief Checks M before giving it to mmg3d (volume_mesh) or mmgs, in
+     *   parallel, and fills report instead of asserting.
+     * \details Duplicate vertices are the ones closer than
+     *   duplicate_tolerance times the bounding box diagonal to a vertex of
+     *   lower index. The attributes checked are the ones opt refers to (metric,
+     *   level set, displacement, edge, facet and cell references).
+     * \return report.ok()
+     */
+    bool mmgig_API preflight_check(const Mesh& M, bool volume_mesh, const MmgOptions& opt,
+                                   MmgPreflightReport& report,
+                                   double duplicate_tolerance = 1e-10);
+}
+
+#endif
@@ -0,0 +1,400 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_quality.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <sstream>
+
+namespace OGF {
+
+    namespace {
+
+        const double SQRT3 = 1.7320508075688772;
+        const double RAD_TO_DEG = 180. / M_PI;
+
+        /* Elements per task of the parallel loop */
+        const index_t QUALITY_CHUNK_SIZE = 16384;
+
+        /* Statistics of a range of elements, reduced afterwards */
+        struct Partial {
+            index_t nb = 0;
+            index_t nb_negative = 0;
+            double min_q = DBL_MAX;
+            double sum_q = 0.;
+            double min_a = DBL_MAX;
+            double max_a = 0.;
+            double min_l = DBL_MAX;
+            double max_l = 0.;
+            double sum_l = 0.;
+            index_t nb_l = 0;
+            index_t nb_short = 0;
+            index_t nb_long = 0;
+            std::vector<index_t> histogram;
+        };
+
+        /* Length of an edge in the metric of the options */
+        class EdgeMeasure {
+        public:
+            EdgeMeasure(const Mesh& M, const MmgOptions& opt) :
+                metric_(NULL), dim_(0), scale_(1.), sized_(false) {
+                if (opt.metric_attribute != "no_metric") {
+                    const AttributeStore* store = M.vertices.attributes().find_attribute_store(opt.metric_attribute);
+                    if (store != NULL && (store->dimension() == 1 || store->dimension() == 6)) {
+                        attribute_.bind_if_is_defined(const_cast<Mesh&>(M).vertices.attributes(), opt.metric_attribute);
+                    }
+                    if (!attribute_.is_bound()) {
+                        mmg_log_warn("mmg_quality") << opt.metric_attribute
+                            << " is not a double vertex attribute of dimension 1 or 6, edge lengths in model units" << std::endl;
+                    } else {
+                        metric_ = (M.vertices.nb() > 0) ? &attribute_[0] : NULL;
+                        dim_ = attribute_.dimension();
+                        sized_ = true;
+                    }
+                } else if (opt.hsiz > 0.) {
+                    scale_ = 1. / opt.hsiz;
+                    sized_ = true;
+                }
+            }
+
+            bool sized() const {
+                return sized_;
+            }
+
+            double length(const vec3& pa, const vec3& pb, index_t a, index_t b) const {
+                vec3 e = pb - pa;
+                if (metric_ == NULL) return scale_ * length_of(e);
+                if (dim_ == 1) {
+                    return length_of(e) * 0.5 * (1. / metric_[a] + 1. / metric_[b]);
+                }
+                double m[6];
+                for (index_t i = 0; i < 6; ++i) {
+                    m[i] = 0.5 * (metric_[6*a+i] + metric_[6*b+i]);
+                }
+                double l2 = m[0]*e.x*e.x + m[3]*e.y*e.y + m[5]*e.z*e.z
+                    + 2. * (m[1]*e.x*e.y + m[2]*e.x*e.z + m[4]*e.y*e.z);
+                return std::sqrt(std::max(l2, 0.));
+            }
+
+        private:
+            static double length_of(const vec3& e) {
+                return std::sqrt(dot(e, e));
+            }
+
+            Attribute<double> attribute_;
+            const double* metric_;
+            index_t dim_;
+            double scale_;
+            bool sized_;
+        };
+
+        /* Values of one element */
+        struct ElementQuality {
+            double quality;
+            bool negative;
+            double min_angle;
+            double max_angle;
+            double lengths[6];
+        };
+
+        double angle_between(const vec3& u, const vec3& v) {
+            double nu = std::sqrt(dot(u, u));
+            double nv = std::sqrt(dot(v, v));
+            if (nu == 0. || nv == 0.) return 0.;
+            double c = std::min(1., std::max(-1., dot(u, v) / (nu * nv)));
+            return std::acos(c) * RAD_TO_DEG;
+        }
+
+        const index_t tet_edges[6][2] = { {0,1}, {0,2}, {0,3}, {1,2}, {1,3}, {2,3} };
+
+        void tet_quality(const vec3* p, const index_t* v, const EdgeMeasure& measure, ElementQuality& q) {
+            double sum_l2 = 0.;
+            for (index_t e = 0; e < 6; ++e) {
+                vec3 d = p[tet_edges[e][1]] - p[tet_edges[e][0]];
+                sum_l2 += dot(d, d);
+                q.lengths[e] = measure.length(p[tet_edges[e][0]], p[tet_edges[e][1]],
+                                              v[tet_edges[e][0]], v[tet_edges[e][1]]);
+            }
+            double six_volume = dot(p[1] - p[0], cross(p[2] - p[0], p[3] - p[0]));
+            q.negative = six_volume < 0.;
+            q.quality = (sum_l2 > 0.) ? 12. * SQRT3 * std::fabs(six_volume) / std::pow(sum_l2, 1.5) : 0.;
+
+            /* inward normal of the face opposite to each vertex */
+            vec3 n[4];
+            for (index_t k = 0; k < 4; ++k) {
+                const vec3& a = p[(k + 1) % 4];
+                const vec3& b = p[(k + 2) % 4];
+                const vec3& c = p[(k + 3) % 4];
+                n[k] = cross(b - a, c - a);
+                if (dot(n[k], p[k] - a) < 0.) n[k] = -1. * n[k];
+            }
+            /* the dihedral angle at edge (i,j) is between the faces
+             * opposite to the two other vertices */
+            q.min_angle = 180.;
+            q.max_angle = 0.;
+            for (index_t e = 0; e < 6; ++e) {
+                const index_t* other = tet_edges[5 - e];
+                double angle = 180. - angle_between(n[other[0]], n[other[1]]);
+                q.min_angle = std::min(q.min_angle, angle);
+                q.max_angle = std::max(q.max_angle, angle);
+            }
+        }
+
+        void triangle_quality(const vec3* p, const index_t* v, const EdgeMeasure& measure, ElementQuality& q) {
+            double sum_l2 = 0.;
+            q.min_angle = 180.;
+            q.max_angle = 0.;
+            for (index_t i = 0; i < 3; ++i) {
+                const vec3& a = p[i];
+                const vec3& b = p[(i + 1) % 3];
+                const vec3& c = p[(i + 2) % 3];
+                vec3 d = b - a;
+                sum_l2 += dot(d, d);
+                q.lengths[i] = measure.length(a, b, v[i], v[(i + 1) % 3]);
+                double angle = angle_between(b - a, c - a);
+                q.min_angle = std::min(q.min_angle, angle);
+                q.max_angle = std::max(q.max_angle, angle);
+            }
+            vec3 n = cross(p[1] - p[0], p[2] - p[0]);
+            double area = 0.5 * std::sqrt(dot(n, n));
+            q.negative = false;
+            q.quality = (sum_l2 > 0.) ? 4. * SQRT3 * area / sum_l2 : 0.;
+        }
+    }
+
+    std::string MmgQualityStats::to_json() const {
+        std::ostringstream out;
+        out << "{\"elements\": \"" << (volume ? "tets" : "triangles") << "\""
+            << ", \"nb\": " << nb_elements
+            << ", \"inverted\": " << nb_inverted
+            << ", \"quality\": {\"min\": " << min_quality << ", \"mean\": " << mean_quality << "}"
+            << ", \"angle\": {\"min\": " << min_angle << ", \"max\": " << max_angle << "}"
+            << ", \"edge_length\": {\"sized\": " << (sized ? "true" : "false")
+            << ", \"min\": " << min_edge_length
+            << ", \"max\": " << max_edge_length
+            << ", \"mean\": " << mean_edge_length
+            << ", \"short\": " << nb_short_edges
+            << ", \"long\": " << nb_long_edges << "}"
+            << ", \"histogram\": [";
+        for (index_t i = 0; i < histogram.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << histogram[i];
+        }
+        out << "]}";
+        return out.str();
+    }
+
+    bool compute_mesh_quality(const Mesh& M, const MmgOptions& opt,
+                              MmgQualityStats& stats, index_t nb_bins,
+                              const std::string& attribute_prefix) {
+        stats = MmgQualityStats();
+        stats.volume = (M.cells.nb() > 0);
+        if ((stats.volume && !M.cells.are_simplices()) || (!stats.volume && !M.facets.are_simplices())) {
+            mmg_log_err("mmg_quality") << "needs a tet or a triangle mesh" << std::endl;
+            return false;
+        }
+        Stopwatch W("mmg_quality", false);
+        nb_bins = std::max(nb_bins, index_t(1));
+        index_t n = stats.volume ? M.cells.nb() : M.facets.nb();
+        index_t nb_corners = stats.volume ? 4 : 3;
+        index_t nb_edges = stats.volume ? 6 : 3;
+        const index_t* corners = (n == 0) ? NULL : (stats.volume
+            ? M.cell_corners.vertex_index_ptr(0) : M.facet_corners.vertex_index_ptr(0));
+        EdgeMeasure measure(M, opt);
+        stats.sized = measure.sized();
+
+        bool store = !attribute_prefix.empty();
+        std::vector<double> quality_values(store ? n : 0);
+        std::vector<double> min_angle_values(store ? n : 0);
+        std::vector<double> max_angle_values(store ? n : 0);
+        std::vector<double> max_length_values(store ? n : 0);
+
+        /* Contiguous chunks reduced in order, so the result does not depend
+         * on the number of threads */
+        index_t nb_chunks = (n + QUALITY_CHUNK_SIZE - 1) / QUALITY_CHUNK_SIZE;
+        std::vector<Partial> partials(nb_chunks);
+        parallel_for(0, nb_chunks, [&](index_t chunk) {
+            Partial& P = partials[chunk];
+            P.histogram.assign(nb_bins, 0);
+            index_t from = chunk * QUALITY_CHUNK_SIZE;
+            index_t to = std::min(n, from + QUALITY_CHUNK_SIZE);
+            ElementQuality q;
+            vec3 p[4];
+            for (index_t e = from; e < to; ++e) {
+                const index_t* v = corners + nb_corners * e;
+                for (index_t lv = 0; lv < nb_corners; ++lv) {
+                    p[lv] = vec3(M.vertices.point_ptr(v[lv]));
+                }
+                if (stats.volume) {
+                    tet_quality(p, v, measure, q);
+                } else {
+                    triangle_quality(p, v, measure, q);
+                }
+                ++P.nb;
+                if (q.negative) ++P.nb_negative;
+                P.min_q = std::min(P.min_q, q.quality);
+                P.sum_q += q.quality;
+                P.min_a = std::min(P.min_a, q.min_angle);
+                P.max_a = std::max(P.max_a, q.max_angle);
+                double max_l = 0.;
+                for (index_t i = 0; i < nb_edges; ++i) {
+                    double l = q.lengths[i];
+                    P.min_l = std::min(P.min_l, l);
+                    max_l = std::max(max_l, l);
+                    P.sum_l += l;
+                    if (l < 1. / std::sqrt(2.)) ++P.nb_short;
+                    if (l > std::sqrt(2.)) ++P.nb_long;
+                }
+                P.nb_l += nb_edges;
+                P.max_l = std::max(P.max_l, max_l);
+                index_t bin = index_t(std::min(std::max(q.quality, 0.), 1.) * double(nb_bins));
+                ++P.histogram[std::min(bin, nb_bins - 1)];
+                if (store) {
+                    quality_values[e] = q.quality;
+                    min_angle_values[e] = q.min_angle;
+                    max_angle_values[e] = q.max_angle;
+                    max_length_values[e] = max_l;
+                }
+            }
+        });
+
+        Partial total;
+        total.histogram.assign(nb_bins, 0);
+        for (const Partial& P : partials) {
+            total.nb += P.nb;
+            total.nb_negative += P.nb_negative;
+            total.min_q = std::min(total.min_q, P.min_q);
+            total.sum_q += P.sum_q;
+            total.min_a = std::min(total.min_a, P.min_a);
+            total.max_a = std::max(total.max_a, P.max_a);
+            total.min_l = std::min(total.min_l, P.min_l);
+            total.max_l = std::max(total.max_l, P.max_l);
+            total.sum_l += P.sum_l;
+            total.nb_l += P.nb_l;
+            total.nb_short += P.nb_short;
+            total.nb_long += P.nb_long;
+            for (index_t b = 0; b < nb_bins; ++b) total.histogram[b] += P.histogram[b];
+        }
+        stats.nb_elements = total.nb;
+        /* the orientation convention of the input is unknown, the tets
+         * oriented against the majority are the inverted ones */
+        stats.nb_inverted = std::min(total.nb_negative, total.nb - total.nb_negative);
+        if (total.nb > 0) {
+            stats.min_quality = total.min_q;
+            stats.mean_quality = total.sum_q / double(total.nb);
+            stats.min_angle = total.min_a;
+            stats.max_angle = total.max_a;
+            stats.min_edge_length = total.min_l;
+            stats.max_edge_length = total.max_l;
+            stats.mean_edge_length = total.sum_l / double(total.nb_l);
+        }
+        if (stats.sized) {
+            stats.nb_short_edges = total.nb_short;
+            stats.nb_long_edges = total.nb_long;
+        }
+        stats.histogram.swap(total.histogram);
+
+        if (store) {
+            AttributesManager& attributes = stats.volume
+                ? const_cast<Mesh&>(M).cells.attributes() : const_cast<Mesh&>(M).facets.attributes();
+            const std::vector<double>* values[4] = {
+                &quality_values, &min_angle_values, &max_angle_values, &max_length_values
+            };
+            const char* suffixes[4] = { "_quality", "_min_angle", "_max_angle", "_max_edge_length" };
+            for (index_t i = 0; i < 4; ++i) {
+                Attribute<double> attr(attributes, attribute_prefix + suffixes[i]);
+                if (n > 0) std::copy(values[i]->begin(), values[i]->end(), &attr[0]);
+            }
+        }
+        mmg_log_out("mmg_quality") << n << (stats.volume ? " tets" : " triangles")
+            << ", min quality " << stats.min_quality << ", mean " << stats.mean_quality
+            << ", " << W.elapsed_time() << " s" << std::endl;
+        return true;
+    }
+
+    void compute_element_qualities(const Mesh& M, std::vector<double>& quality, bool parallel) {
+        bool volume = (M.cells.nb() > 0);
+        index_t n = volume ? M.cells.nb() : M.facets.nb();
+        index_t nb_corners = volume ? 4 : 3;
+        quality.assign(n, 0.);
+        if (n == 0 || (volume && !M.cells.are_simplices()) || (!volume && !M.facets.are_simplices())) return;
+        const index_t* corners = volume ? M.cell_corners.vertex_index_ptr(0) : M.facet_corners.vertex_index_ptr(0);
+        EdgeMeasure measure(M, MmgOptions());
+        auto range = [&](index_t from, index_t to) {
+            ElementQuality q;
+            vec3 p[4];
+            for (index_t e = from; e < to; ++e) {
+                const index_t* v = corners + nb_corners * e;
+                for (index_t lv = 0; lv < nb_corners; ++lv) {
+                    p[lv] = vec3(M.vertices.point_ptr(v[lv]));
+                }
+                if (volume) {
+                    tet_quality(p, v, measure, q);
+                } else {
+                    triangle_quality(p, v, measure, q);
+                }
+                quality[e] = q.quality;
+            }
+        };
+        if (parallel) {
+            parallel_for_slice(0, n, range);
+        } else {
+            range(0, n);
+        }
+    }
+
+    bool mesh_meets_target(const MmgQualityStats& stats, const MmgOptions& opt,
+                           double min_quality) {
+        if (stats.nb_elements == 0 || stats.nb_inverted > 0) return false;
+        if (stats.min_quality < min_quality) return false;
+        if (stats.sized) {
+            return stats.nb_short_edges == 0 && stats.nb_long_edges == 0;
+        }
+        return stats.min_edge_length >= opt.hmin && stats.max_edge_length <= opt.hmax;
+    }
+}
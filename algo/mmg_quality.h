@@ -0,0 +1,111 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_QUALITY__H
+#define H__OGF_MMGIG_MMG_QUALITY__H
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <string>
+#include <vector>
+
+namespace GEO {
+    class Mesh;
+}
+
+namespace OGF {
+
+    /* Quality of the tets of a mesh, or of its triangles if it has no cells */
+    struct MmgQualityStats {
+        bool volume = true; /* tets or triangles */
+        index_t nb_elements = 0;
+        index_t nb_inverted = 0; /* tets of negative volume */
+        /* mmg quality: 72 sqrt(3) V / (sum l^2)^(3/2) for tets,
+         * 4 sqrt(3) A / sum l^2 for triangles, 1 for regular elements */
+        double min_quality = 0.;
+        double mean_quality = 0.;
+        /* dihedral angles of the tets, corner angles of the triangles (degrees) */
+        double min_angle = 0.;
+        double max_angle = 0.;
+        /* edge lengths in the metric (1 is the target) if sized, see
+         * compute_mesh_quality(), in model units otherwise */
+        bool sized = false;
+        double min_edge_length = 0.;
+        double max_edge_length = 0.;
+        double mean_edge_length = 0.;
+        index_t nb_short_edges = 0; /* sized lengths below 1/sqrt(2) */
+        index_t nb_long_edges = 0; /* sized lengths above sqrt(2) */
+        /* number of elements per quality bin, evenly spaced on [0,1] */
+        std::vector<index_t> histogram;
+
+        /* One line JSON object, as MmgRemeshStats */
+        std::string to_json() const;
+    };
+
+    /**
+     * \brief Quality, angles and edge lengths of all the elements, in parallel.
+     * \details Edge lengths are measured in the metric of
+     *   opt.metric_attribute if it is set (sizes or tensors, averaged on
+     *   the edge), relative to opt.hsiz if it is not 0, and in model units
+     *   otherwise (then compared with [opt.hmin, opt.hmax]). Each edge is
+     *   measured once per element containing it.
+     * \param[in] attribute_prefix if not empty, the per-element values are
+     *   stored in the cell (or facet) attributes <prefix>_quality,
+     *   <prefix>_min_angle, <prefix>_max_angle and <prefix>_max_edge_length
+     */
+    bool mmgig_API compute_mesh_quality(const Mesh& M, const MmgOptions& opt,
+                                        MmgQualityStats& stats, index_t nb_bins = 10,
+                                        const std::string& attribute_prefix = "");
+
+    /* Quality of each tet of M (or triangle if it has no cells), as in
+     * compute_mesh_quality(). All 0 if the elements are not simplices */
+    void mmgig_API compute_element_qualities(const Mesh& M, std::vector<double>& quality,
+                                             bool parallel = true);
+
+    /* True if all the elements have a quality of at least min_quality and
+     * their edges have the target size: within [1/sqrt(2), sqrt(2)] in the
+     * metric when sized, within [opt.hmin, opt.hmax] otherwise */
+    bool mmgig_API mesh_meets_target(const MmgQualityStats& stats, const MmgOptions& opt,
+                                     double min_quality);
+}
+
+#endif
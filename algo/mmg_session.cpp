@@ -0,0 +1,265 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_session.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+namespace OGF {
+    using namespace GEO;
+
+    MmgSession::MmgSession() :
+        mesh_(NULL),
+        met_(NULL),
+        volume_(true),
+        has_metric_(false),
+        has_level_set_(false),
+        is_level_set_output_(false),
+        nb_passes_(0) {
+    }
+
+    MmgSession::~MmgSession() {
+        clear();
+    }
+
+    void MmgSession::clear() {
+        if (mesh_ != NULL) {
+            if (volume_) {
+                mmg3d_free(mesh_, met_);
+            } else {
+                mmgs_free(mesh_, met_);
+            }
+        }
+        mesh_ = NULL;
+        met_ = NULL;
+        iso_values_.clear();
+        has_metric_ = false;
+        has_level_set_ = false;
+        is_level_set_output_ = false;
+        nb_passes_ = 0;
+    }
+
+    bool MmgSession::set_mesh(const Mesh& M, bool volume_mesh, const MmgOptions& opt) {
+        clear();
+        volume_ = volume_mesh;
+        bool ok = geo_to_mmg(M, mesh_, met_, volume_, opt.enable_anisotropy,
+                             opt.edge_attribute, opt.facet_attribute,
+                             volume_ ? opt.cell_attribute : std::string("no_attribute"),
+                             opt.parallel_conversion, opt.bulk_conversion);
+        if (!ok) {
+            mmg_log_err("MmgSession") << "failed to convert mesh to MMG5_pMesh" << std::endl;
+            clear();
+            return false;
+        }
+        if (opt.metric_attribute != "no_metric") {
+            if (!set_metric_from_attribute(M, mesh_, met_, volume_, opt)) {
+                clear();
+                return false;
+            }
+            has_metric_ = true;
+        }
+        return true;
+    }
+
+    void MmgSession::drop_solution() {
+        if (mesh_ == NULL || met_ == NULL) return;
+        if (volume_) {
+            MMG3D_Free_solutions(mesh_, met_);
+        } else {
+            MMGS_Free_solutions(mesh_, met_);
+        }
+        /* as in mmg3d_set_parameters() with hsiz: no values, mmg computes
+         * its own sizes from hmin, hmax and hausd */
+        met_->m = NULL;
+        met_->np = 0;
+        met_->npi = 0;
+    }
+
+    index_t MmgSession::nb_vertices() const {
+        return mesh_ == NULL ? 0 : (index_t) mesh_->np;
+    }
+
+    index_t MmgSession::nb_triangles() const {
+        return mesh_ == NULL ? 0 : (index_t) mesh_->nt;
+    }
+
+    index_t MmgSession::nb_tets() const {
+        return (mesh_ == NULL || !volume_) ? 0 : (index_t) mesh_->ne;
+    }
+
+    const double* MmgSession::vertex(index_t v) const {
+        geo_debug_assert(mesh_ != NULL && v < nb_vertices());
+        return mesh_->point[v+1].c;
+    }
+
+    index_t MmgSession::tet_vertex(index_t t, index_t lv) const {
+        geo_debug_assert(t < nb_tets() && lv < 4);
+        return index_t(mesh_->tetra[t+1].v[lv] - 1);
+    }
+
+    bool MmgSession::set_metric(const std::vector<double>& values, index_t dimension) {
+        if (mesh_ == NULL) {
+            mmg_log_err("MmgSession") << "no mesh in session" << std::endl;
+            return false;
+        }
+        if (dimension == 0 || values.size() != (size_t) nb_vertices() * dimension) {
+            mmg_log_err("MmgSession") << "metric size " << values.size()
+                << " does not match the " << nb_vertices() << " vertices" << std::endl;
+            return false;
+        }
+        if (!set_metric_values(mesh_, met_, volume_, values.data(), nb_vertices(), dimension, true)) {
+            return false;
+        }
+        has_metric_ = true;
+        has_level_set_ = false;
+        return true;
+    }
+
+    bool MmgSession::set_level_set(const std::vector<double>& values) {
+        if (mesh_ == NULL || !volume_) {
+            mmg_log_err("MmgSession") << "level set requires a volume mesh in session" << std::endl;
+            return false;
+        }
+        if (!set_metric(values, 1)) {
+            return false;
+        }
+        has_metric_ = false;
+        has_level_set_ = true;
+        return true;
+    }
+
+    bool MmgSession::remesh(const MmgOptions& opt) {
+        if (mesh_ == NULL) {
+            mmg_log_err("MmgSession") << "no mesh in session" << std::endl;
+            return false;
+        }
+        if (has_level_set_) {
+            mmg_log_err("MmgSession") << "a level set is set, use extract_iso()" << std::endl;
+            return false;
+        }
+        Stopwatch W("MmgSession", false);
+        if (!has_metric_) {
+            drop_solution();
+        }
+        iso_values_.clear();
+        is_level_set_output_ = false;
+        int ier = MMG5_SUCCESS;
+        if (volume_) {
+            mmg3d_set_parameters(mesh_, met_, opt, has_metric_);
+            MMG3D_Set_iparameter(mesh_, met_, MMG3D_IPARAM_iso, 0);
+            ier = run_mmg(MMG_CALL_MMG3DLIB, mesh_, met_);
+        } else {
+            mmgs_set_parameters(mesh_, met_, opt, has_metric_);
+            ier = run_mmg(MMG_CALL_MMGSLIB, mesh_, met_);
+        }
+        /* the sizes of a pass are not reused by the next one */
+        has_metric_ = false;
+        drop_solution();
+        if (ier != MMG5_SUCCESS) {
+            mmg_log_err("MmgSession") << "failed to remesh (pass " << nb_passes_ + 1 << ")" << std::endl;
+            return false;
+        }
+        is_level_set_output_ = false;
+        ++nb_passes_;
+        mmg_log_out("MmgSession") << "pass " << nb_passes_ << ": " << nb_vertices() << " vertices, "
+            << nb_triangles() << " triangles, " << nb_tets() << " tets, "
+            << W.elapsed_time() << " s" << std::endl;
+        return true;
+    }
+
+    bool MmgSession::extract_iso(const MmgOptions& opt) {
+        if (!has_level_set_) {
+            mmg_log_err("MmgSession") << "no level set, use set_level_set() first" << std::endl;
+            return false;
+        }
+        if (!mmg3d_set_ls_parameters(mesh_, met_, opt)) {
+            return false;
+        }
+        Stopwatch W("MmgSession", false);
+        int ier = run_mmg(MMG_CALL_MMG3DLS, mesh_, met_);
+        has_level_set_ = false;
+        /* the level set is kept for get_mesh() only, the solution is
+         * emptied so that a later remesh() does not take it as sizes */
+        iso_values_.clear();
+        if (ier == MMG5_SUCCESS) {
+            iso_values_.assign(met_->m, met_->m + met_->np + 1);
+        }
+        drop_solution();
+        if (ier != MMG5_SUCCESS) {
+            mmg_log_err("MmgSession") << "failed to remesh isovalue" << std::endl;
+            return false;
+        }
+        is_level_set_output_ = true;
+        ++nb_passes_;
+        mmg_log_out("MmgSession") << "iso pass " << nb_passes_ << ": " << nb_vertices() << " vertices, "
+            << nb_triangles() << " triangles, " << nb_tets() << " tets, "
+            << W.elapsed_time() << " s" << std::endl;
+        return true;
+    }
+
+    bool MmgSession::get_mesh(Mesh& M_out, const MmgOptions& opt) const {
+        if (mesh_ == NULL) {
+            mmg_log_err("MmgSession") << "no mesh in session" << std::endl;
+            return false;
+        }
+        if (is_level_set_output_) {
+            MMG5_Sol ls = MMG5_Sol();
+            ls.dim = 3;
+            ls.size = 1;
+            ls.type = MMG5_Scalar;
+            ls.np = ls.npi = ls.npmax = int(iso_values_.size()) - 1;
+            ls.m = const_cast<double*>(iso_values_.data());
+            return mmg_iso_to_geo(mesh_, &ls, M_out, opt);
+        }
+        bool ok = mmg_to_geo(mesh_, M_out, opt.edge_attribute, opt.facet_attribute,
+                             volume_ ? opt.cell_attribute : std::string("no_attribute"),
+                             opt.parallel_conversion, false, opt.bulk_conversion);
+        if (ok) {
+            connect_output(mesh_, M_out, volume_, opt);
+        }
+        return ok;
+    }
+}
+
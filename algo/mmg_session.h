@@ -0,0 +1,153 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_SESSION__H
+#define H__OGF_MMGIG_MMG_SESSION__H
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <vector>
+
+extern "C" {
+#include "mmg/libmmg.h"
+}
+
+namespace GEO {
+    class Mesh;
+}
+
+namespace OGF {
+
+    /**
+     * \brief Keeps a mesh in the mmg data structures across several
+     *   remeshing passes.
+     * \details The GEO::Mesh is converted once by set_mesh(). Each pass
+     *   takes the sizes (or the level set) at the current mmg vertices,
+     *   and the result is only converted back by get_mesh(). Typical
+     *   adaptation loop:
+     *   \code
+     *   MmgSession S;
+     *   S.set_mesh(M, true, opt);
+     *   for (...) {
+     *       // evaluate sizes at S.vertex(v), v < S.nb_vertices()
+     *       S.set_metric(sizes, 1);
+     *       S.remesh(opt);
+     *   }
+     *   S.get_mesh(M_out, opt);
+     *   \endcode
+     */
+    class mmgig_API MmgSession {
+    public:
+        MmgSession();
+        ~MmgSession();
+
+        /* Convert M into the session (mmg3d if volume_mesh, mmgs otherwise),
+         * with the attributes listed in opt */
+        bool set_mesh(const Mesh& M, bool volume_mesh, const MmgOptions& opt);
+
+        /* Release the mmg structures */
+        void clear();
+
+        bool is_initialized() const {
+            return mesh_ != NULL;
+        }
+
+        bool volume_mesh() const {
+            return volume_;
+        }
+
+        index_t nb_vertices() const;
+        index_t nb_triangles() const;
+        index_t nb_tets() const;
+
+        /* Coordinates of the current vertex v (0-based) */
+        const double* vertex(index_t v) const;
+
+        /* Vertex lv (0 to 3) of the current tet t, both 0-based */
+        index_t tet_vertex(index_t t, index_t lv) const;
+
+        /* Sizes (dimension 1) or upper triangular metric tensors
+         * (dimension 6) at the current vertices, used by the next remesh() */
+        bool set_metric(const std::vector<double>& values, index_t dimension);
+
+        /* Level set at the current vertices, used by the next extract_iso() */
+        bool set_level_set(const std::vector<double>& values);
+
+        /* One remeshing pass (MMG3D_mmg3dlib / MMGS_mmgslib). Uses the metric
+         * given since the last pass if any, the sizes of opt otherwise */
+        bool remesh(const MmgOptions& opt);
+
+        /* Discretize the level set in the mesh (MMG3D_mmg3dls) */
+        bool extract_iso(const MmgOptions& opt);
+
+        /* Number of successful passes since set_mesh() */
+        index_t nb_passes() const {
+            return nb_passes_;
+        }
+
+        /* Convert the current mesh back, with the attributes of opt. After
+         * extract_iso(), only the elements selected by opt.iso_output are
+         * converted and the level set is stored in opt.ls_attribute */
+        bool get_mesh(Mesh& M_out, const MmgOptions& opt) const;
+
+    private:
+        MmgSession(const MmgSession&);
+        MmgSession& operator=(const MmgSession&);
+
+        /* Empties met_, so that mmg does not take the output metric or
+         * the level set of a pass as the sizes of the next one */
+        void drop_solution();
+
+        MMG5_pMesh mesh_;
+        MMG5_pSol met_;
+        /* Level set after extract_iso(), 1-based as ls->m, for get_mesh() */
+        std::vector<double> iso_values_;
+        bool volume_;
+        bool has_metric_;
+        bool has_level_set_;
+        bool is_level_set_output_;
+        index_t nb_passes_;
+    };
+}
+
+#endif
+
@@ -0,0 +1,686 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_sizemap.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace OGF {
+
+    namespace {
+        /* Triangles of the surface, 3 vertices each */
+        void surface_triangles(const Mesh& M, std::vector<index_t>& triangles) {
+            triangles.clear();
+            if (M.facets.nb() > 0) {
+                for (index_t f = 0; f < M.facets.nb(); ++f) {
+                    index_t n = M.facets.nb_vertices(f);
+                    /* polygons are fanned */
+                    for (index_t lv = 1; lv + 1 < n; ++lv) {
+                        triangles.push_back(M.facets.vertex(f, 0));
+                        triangles.push_back(M.facets.vertex(f, lv));
+                        triangles.push_back(M.facets.vertex(f, lv + 1));
+                    }
+                }
+                return;
+            }
+            for (index_t c = 0; c < M.cells.nb(); ++c) {
+                for (index_t lf = 0; lf < M.cells.nb_facets(c); ++lf) {
+                    if (M.cells.adjacent(c, lf) != NO_CELL) continue;
+                    index_t n = M.cells.facet_nb_vertices(c, lf);
+                    for (index_t lv = 1; lv + 1 < n; ++lv) {
+                        triangles.push_back(M.cells.facet_vertex(c, lf, 0));
+                        triangles.push_back(M.cells.facet_vertex(c, lf, lv));
+                        triangles.push_back(M.cells.facet_vertex(c, lf, lv + 1));
+                    }
+                }
+            }
+        }
+
+        /* Elements around each vertex, element e of size n has the vertices
+         * elements[n*e .. n*e+n-1]. The elements of vertex v are
+         * star[star_begin[v] .. star_begin[v+1]-1] */
+        void build_stars(index_t nv, const std::vector<index_t>& elements, index_t n,
+                         std::vector<index_t>& star_begin, std::vector<index_t>& star) {
+            star_begin.assign(nv + 1, 0);
+            for (index_t c = 0; c < elements.size(); ++c) {
+                ++star_begin[elements[c] + 1];
+            }
+            for (index_t v = 0; v < nv; ++v) {
+                star_begin[v + 1] += star_begin[v];
+            }
+            star.resize(elements.size());
+            std::vector<index_t> fill(star_begin.begin(), star_begin.end() - 1);
+            for (index_t e = 0; e < elements.size() / n; ++e) {
+                for (index_t lv = 0; lv < n; ++lv) {
+                    star[fill[elements[n*e+lv]]++] = e;
+                }
+            }
+        }
+
+        /* Gradient of the linear interpolation of f on a triangle (n = 3) or
+         * a tet (n = 4), weighted by its area or volume */
+        void element_gradient(const vec3* p, const double* f, index_t n, vec3& g, double& weight) {
+            vec3 e1 = p[1] - p[0];
+            vec3 e2 = p[2] - p[0];
+            double df1 = f[1] - f[0];
+            double df2 = f[2] - f[0];
+            g = vec3(0., 0., 0.);
+            weight = 0.;
+            if (n == 4) {
+                vec3 e3 = p[3] - p[0];
+                double df3 = f[3] - f[0];
+                double det = dot(e1, cross(e2, e3));
+                if (det == 0.) return;
+                g = (1. / det) * (df1 * cross(e2, e3) + df2 * cross(e3, e1) + df3 * cross(e1, e2));
+                weight = std::fabs(det) / 6.;
+            } else {
+                double g11 = dot(e1, e1);
+                double g12 = dot(e1, e2);
+                double g22 = dot(e2, e2);
+                double det = g11 * g22 - g12 * g12;
+                if (det == 0.) return;
+                double a = (g22 * df1 - g12 * df2) / det;
+                double b = (g11 * df2 - g12 * df1) / det;
+                g = a * e1 + b * e2;
+                weight = 0.5 * std::sqrt(det);
+            }
+        }
+
+        /* Eigen decomposition of a symmetric 3x3 matrix (upper triangular
+         * m11 m12 m13 m22 m23 m33) by Jacobi rotations */
+        void symmetric_eigen(const double* m, double* lambda, vec3* vectors) {
+            double a[3][3] = {
+                {m[0], m[1], m[2]},
+                {m[1], m[3], m[4]},
+                {m[2], m[4], m[5]}
+            };
+            double v[3][3] = {{1.,0.,0.},{0.,1.,0.},{0.,0.,1.}};
+            for (index_t sweep = 0; sweep < 50; ++sweep) {
+                double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+                if (off < 1e-30) break;
+                for (index_t p = 0; p < 2; ++p) {
+                    for (index_t q = p + 1; q < 3; ++q) {
+                        if (a[p][q] == 0.) continue;
+                        double theta = (a[q][q] - a[p][p]) / (2. * a[p][q]);
+                        double t = ((theta >= 0.) ? 1. : -1.) / (std::fabs(theta) + std::sqrt(theta * theta + 1.));
+                        double c = 1. / std::sqrt(t * t + 1.);
+                        double s = t * c;
+                        for (index_t k = 0; k < 3; ++k) {
+                            double akp = a[k][p];
+                            double akq = a[k][q];
+                            a[k][p] = c * akp - s * akq;
+                            a[k][q] = s * akp + c * akq;
+                        }
+                        for (index_t k = 0; k < 3; ++k) {
+                            double apk = a[p][k];
+                            double aqk = a[q][k];
+                            a[p][k] = c * apk - s * aqk;
+                            a[q][k] = s * apk + c * aqk;
+                        }
+                        for (index_t k = 0; k < 3; ++k) {
+                            double vkp = v[k][p];
+                            double vkq = v[k][q];
+                            v[k][p] = c * vkp - s * vkq;
+                            v[k][q] = s * vkp + c * vkq;
+                        }
+                    }
+                }
+            }
+            for (index_t i = 0; i < 3; ++i) {
+                lambda[i] = a[i][i];
+                vectors[i] = vec3(v[0][i], v[1][i], v[2][i]);
+            }
+        }
+
+        double curvature_to_size(double k, const MmgOptions& opt) {
+            k = std::fabs(k);
+            double h = (k > 0.) ? std::sqrt(8. * opt.hausd / k) : opt.hmax;
+            return std::min(std::max(h, opt.hmin), opt.hmax);
+        }
+
+        /* m += w d d^T, upper triangular part */
+        void add_direction(double* m, const vec3& d, double w) {
+            m[0] += w * d.x * d.x;
+            m[1] += w * d.x * d.y;
+            m[2] += w * d.x * d.z;
+            m[3] += w * d.y * d.y;
+            m[4] += w * d.y * d.z;
+            m[5] += w * d.z * d.z;
+        }
+
+        void isotropic_tensor(double* m, double h) {
+            double l = 1. / (h * h);
+            m[0] = l; m[1] = 0.; m[2] = 0.;
+            m[3] = l; m[4] = 0.;
+            m[5] = l;
+        }
+    }
+
+    bool compute_curvature_size_map(const Mesh& M, const MmgOptions& opt,
+                                    std::vector<double>& values) {
+        if (opt.hausd <= 0. || opt.hmin <= 0. || opt.hmax < opt.hmin) {
+            mmg_log_err("mmg_sizemap") << "needs hausd > 0 and 0 < hmin <= hmax" << std::endl;
+            return false;
+        }
+        Stopwatch W("mmg_sizemap", false);
+        index_t nv = M.vertices.nb();
+        index_t dim = opt.enable_anisotropy ? 6 : 1;
+        bool volume_mesh = (M.cells.nb() > 0);
+        std::vector<index_t> triangles;
+        surface_triangles(M, triangles);
+        index_t nt = index_t(triangles.size() / 3);
+
+        /* vertex -> triangles */
+        std::vector<index_t> star_begin;
+        std::vector<index_t> star;
+        build_stars(nv, triangles, 3, star_begin, star);
+
+        /* area weighted normals */
+        std::vector<vec3> tri_normal(nt);
+        parallel_for(0, nt, [&](index_t t) {
+            vec3 p0(M.vertices.point_ptr(triangles[3*t]));
+            vec3 p1(M.vertices.point_ptr(triangles[3*t+1]));
+            vec3 p2(M.vertices.point_ptr(triangles[3*t+2]));
+            tri_normal[t] = 0.5 * cross(p1 - p0, p2 - p0);
+        });
+
+        double cos_feature = std::cos(opt.angle_value * M_PI / 180.);
+        std::vector<char> is_feature(nv, 0);
+        values.assign(dim * nv, 0.);
+
+        parallel_for(0, nv, [&](index_t v) {
+            double* value = &values[dim * v];
+            if (star_begin[v] == star_begin[v + 1]) {
+                if (dim == 6) isotropic_tensor(value, opt.hmax);
+                else value[0] = opt.hmax;
+                return;
+            }
+            vec3 n(0., 0., 0.);
+            for (index_t s = star_begin[v]; s < star_begin[v + 1]; ++s) {
+                n += tri_normal[star[s]];
+            }
+            double nl = length(n);
+            if (opt.angle_detection && nl > 0.) {
+                for (index_t s = star_begin[v]; s < star_begin[v + 1] && !is_feature[v]; ++s) {
+                    const vec3& ns = tri_normal[star[s]];
+                    double l = length(ns);
+                    if (l > 0. && dot(ns, n) < cos_feature * l * nl) is_feature[v] = 1;
+                }
+            }
+            if (nl == 0.) {
+                if (dim == 6) isotropic_tensor(value, opt.hmax);
+                else value[0] = opt.hmax;
+                return;
+            }
+            n = (1. / nl) * n;
+
+            /* tangent frame */
+            vec3 t1 = (std::fabs(n.x) < 0.9) ? cross(n, vec3(1., 0., 0.)) : cross(n, vec3(0., 1., 0.));
+            t1 = normalize(t1);
+            vec3 t2 = cross(n, t1);
+
+            /* Least squares fit of the second fundamental form [a b; b c]
+             * to the normal curvatures along the edges,
+             * k_e = 2 n.(p_j - p_i) / |p_j - p_i|^2 */
+            vec3 p(M.vertices.point_ptr(v));
+            double A[3][3] = {{0.,0.,0.},{0.,0.,0.},{0.,0.,0.}};
+            double B[3] = {0., 0., 0.};
+            double k_max = 0.;
+            index_t nb_edges = 0;
+            for (index_t s = star_begin[v]; s < star_begin[v + 1]; ++s) {
+                index_t t = star[s];
+                for (index_t lv = 0; lv < 3; ++lv) {
+                    index_t w = triangles[3*t+lv];
+                    if (w == v) continue;
+                    vec3 e = vec3(M.vertices.point_ptr(w)) - p;
+                    double l2 = length2(e);
+                    if (l2 == 0.) continue;
+                    double k = 2. * dot(n, e) / l2;
+                    double u = dot(e, t1);
+                    double w2 = dot(e, t2);
+                    double dl = std::sqrt(u * u + w2 * w2);
+                    if (dl == 0.) continue;
+                    u /= dl;
+                    w2 /= dl;
+                    double row[3] = {u * u, 2. * u * w2, w2 * w2};
+                    for (index_t i = 0; i < 3; ++i) {
+                        for (index_t j = 0; j < 3; ++j) A[i][j] += row[i] * row[j];
+                        B[i] += row[i] * k;
+                    }
+                    k_max = std::max(k_max, std::fabs(k));
+                    ++nb_edges;
+                }
+            }
+
+            /* Solve by Cramer's rule, isotropic fallback if degenerate */
+            double det = A[0][0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1])
+                       - A[0][1] * (A[1][0] * A[2][2] - A[1][2] * A[2][0])
+                       + A[0][2] * (A[1][0] * A[2][1] - A[1][1] * A[2][0]);
+            double trace = A[0][0] + A[1][1] + A[2][2];
+            if (nb_edges < 3 || std::fabs(det) < 1e-12 * trace * trace * trace) {
+                double h = curvature_to_size(k_max, opt);
+                if (dim == 6) isotropic_tensor(value, h);
+                else value[0] = h;
+                return;
+            }
+            double x[3];
+            for (index_t i = 0; i < 3; ++i) {
+                double Ai[3][3];
+                for (index_t r = 0; r < 3; ++r) {
+                    for (index_t c = 0; c < 3; ++c) Ai[r][c] = (c == i) ? B[r] : A[r][c];
+                }
+                x[i] = (Ai[0][0] * (Ai[1][1] * Ai[2][2] - Ai[1][2] * Ai[2][1])
+                      - Ai[0][1] * (Ai[1][0] * Ai[2][2] - Ai[1][2] * Ai[2][0])
+                      + Ai[0][2] * (Ai[1][0] * Ai[2][1] - Ai[1][1] * Ai[2][0])) / det;
+            }
+            double a = x[0], b = x[1], c = x[2];
+
+            /* principal curvatures and directions */
+            double mean = 0.5 * (a + c);
+            double delta = std::sqrt(0.25 * (a - c) * (a - c) + b * b);
+            double k1 = mean + delta;
+            double k2 = mean - delta;
+            double theta = 0.5 * std::atan2(2. * b, a - c);
+            vec3 d1 = std::cos(theta) * t1 + std::sin(theta) * t2;
+            vec3 d2 = cross(n, d1);
+            double h1 = curvature_to_size(k1, opt);
+            double h2 = curvature_to_size(k2, opt);
+            if (dim == 1) {
+                value[0] = std::min(h1, h2);
+                return;
+            }
+            /* across a volume boundary, the smallest tangent size keeps the
+             * boundary tets from being flat */
+            double hn = volume_mesh ? std::min(h1, h2) : opt.hmax;
+            add_direction(value, d1, 1. / (h1 * h1));
+            add_direction(value, d2, 1. / (h2 * h2));
+            add_direction(value, n, 1. / (hn * hn));
+        });
+
+        /* On sharp features the fit is meaningless, mmg follows the ridges
+         * itself: use the finest size of the smooth neighbours */
+        index_t nb_features = 0;
+        if (opt.angle_detection) {
+            std::vector<double> feature_values(values);
+            parallel_for(0, nv, [&](index_t v) {
+                if (!is_feature[v]) return;
+                double h_best = opt.hmax;
+                index_t best = NO_VERTEX;
+                for (index_t s = star_begin[v]; s < star_begin[v + 1]; ++s) {
+                    index_t t = star[s];
+                    for (index_t lv = 0; lv < 3; ++lv) {
+                        index_t w = triangles[3*t+lv];
+                        if (w == v || is_feature[w]) continue;
+                        double h = (dim == 6) ? 1. / std::sqrt(std::max(values[6*w], std::max(values[6*w+3], values[6*w+5])))
+                                              : values[w];
+                        if (best == NO_VERTEX || h < h_best) {
+                            h_best = h;
+                            best = w;
+                        }
+                    }
+                }
+                double* value = &feature_values[dim * v];
+                if (dim == 6) isotropic_tensor(value, h_best);
+                else value[0] = h_best;
+            });
+            values.swap(feature_values);
+            nb_features = index_t(std::count(is_feature.begin(), is_feature.end(), char(1)));
+        }
+
+        mmg_log_out("mmg_sizemap") << nv << " vertices, " << nt << " surface triangles, "
+            << nb_features << " feature vertices, " << (dim == 6 ? "anisotropic" : "isotropic")
+            << ", " << W.elapsed_time() << " s" << std::endl;
+        return true;
+    }
+
+    bool compute_hessian_size_map(const Mesh& M, const std::string& field,
+                                  double error, const MmgOptions& opt,
+                                  std::vector<double>& values) {
+        if (error <= 0. || opt.hmin <= 0. || opt.hmax < opt.hmin) {
+            mmg_log_err("mmg_sizemap") << "needs error > 0 and 0 < hmin <= hmax" << std::endl;
+            return false;
+        }
+        if (!Attribute<double>::is_defined(M.vertices.attributes(), field, 1)) {
+            mmg_log_err("mmg_sizemap") << field << " is not a scalar double vertex attribute" << std::endl;
+            return false;
+        }
+        Stopwatch W("mmg_sizemap", false);
+        bool volume_mesh = (M.cells.nb() > 0);
+        index_t n = volume_mesh ? 4 : 3;
+        if ((volume_mesh && !M.cells.are_simplices()) || (!volume_mesh && !M.facets.are_simplices())) {
+            mmg_log_err("mmg_sizemap") << "Hessian recovery needs a tet or a triangle mesh" << std::endl;
+            return false;
+        }
+        index_t nv = M.vertices.nb();
+        index_t ne = volume_mesh ? M.cells.nb() : M.facets.nb();
+        std::vector<index_t> elements(n * ne);
+        for (index_t e = 0; e < ne; ++e) {
+            for (index_t lv = 0; lv < n; ++lv) {
+                elements[n*e+lv] = volume_mesh ? M.cells.vertex(e, lv) : M.facets.vertex(e, lv);
+            }
+        }
+        std::vector<index_t> star_begin;
+        std::vector<index_t> star;
+        build_stars(nv, elements, n, star_begin, star);
+        Attribute<double> f_attr;
+        f_attr.bind_if_is_defined(const_cast<Mesh&>(M).vertices.attributes(), field);
+        const double* f = (nv > 0) ? &f_attr[0] : NULL;
+
+        /* Double recovery: element gradients of f averaged at the vertices,
+         * then the same for each component of the vertex gradient. 'data'
+         * has 'stride' values per vertex. */
+        auto recover_gradient = [&](const double* data, index_t stride, index_t component,
+                                    std::vector<vec3>& gradient) {
+            gradient.assign(nv, vec3(0., 0., 0.));
+            parallel_for(0, nv, [&](index_t v) {
+                vec3 sum(0., 0., 0.);
+                double total = 0.;
+                for (index_t s = star_begin[v]; s < star_begin[v + 1]; ++s) {
+                    index_t e = star[s];
+                    vec3 p[4];
+                    double fe[4];
+                    for (index_t lv = 0; lv < n; ++lv) {
+                        index_t w = elements[n*e+lv];
+                        p[lv] = vec3(M.vertices.point_ptr(w));
+                        fe[lv] = data[stride * w + component];
+                    }
+                    vec3 g;
+                    double weight;
+                    element_gradient(p, fe, n, g, weight);
+                    sum += weight * g;
+                    total += weight;
+                }
+                if (total > 0.) gradient[v] = (1. / total) * sum;
+            });
+        };
+
+        std::vector<vec3> gradient;
+        recover_gradient(f, 1, 0, gradient);
+        std::vector<double> grad_values(3 * nv);
+        for (index_t v = 0; v < nv; ++v) {
+            for (index_t d = 0; d < 3; ++d) grad_values[3*v+d] = gradient[v][d];
+        }
+        std::vector<vec3> hessian_rows[3];
+        for (index_t d = 0; d < 3; ++d) {
+            recover_gradient(grad_values.data(), 3, d, hessian_rows[d]);
+        }
+
+        /* M = sum_i clamp(c |lambda_i| / error) v_i v_i^T, c = 2/9 bounds the
+         * P1 interpolation error on a simplex in the metric */
+        const double c = 2. / 9.;
+        double lmin = 1. / (opt.hmax * opt.hmax);
+        double lmax = 1. / (opt.hmin * opt.hmin);
+        index_t dim = opt.enable_anisotropy ? 6 : 1;
+        values.assign(dim * nv, 0.);
+        parallel_for(0, nv, [&](index_t v) {
+            double h[6] = {
+                hessian_rows[0][v].x, 0.5 * (hessian_rows[0][v].y + hessian_rows[1][v].x),
+                0.5 * (hessian_rows[0][v].z + hessian_rows[2][v].x), hessian_rows[1][v].y,
+                0.5 * (hessian_rows[1][v].z + hessian_rows[2][v].y), hessian_rows[2][v].z
+            };
+            double lambda[3];
+            vec3 vectors[3];
+            symmetric_eigen(h, lambda, vectors);
+            double lambda_max = lmin;
+            for (index_t i = 0; i < 3; ++i) {
+                lambda[i] = std::min(std::max(c * std::fabs(lambda[i]) / error, lmin), lmax);
+                lambda_max = std::max(lambda_max, lambda[i]);
+            }
+            if (dim == 1) {
+                values[v] = 1. / std::sqrt(lambda_max);
+                return;
+            }
+            double* m = &values[6 * v];
+            for (index_t i = 0; i < 3; ++i) {
+                add_direction(m, vectors[i], lambda[i]);
+            }
+        });
+
+        mmg_log_out("mmg_sizemap") << "Hessian of " << field << " on " << nv << " vertices, "
+            << (dim == 6 ? "anisotropic" : "isotropic") << ", " << W.elapsed_time() << " s" << std::endl;
+        return true;
+    }
+
+    namespace {
+        void store_size_map(Mesh& M, const std::vector<double>& values, index_t dim,
+                            const std::string& attribute_name) {
+            if (M.vertices.attributes().is_defined(attribute_name)) {
+                M.vertices.attributes().delete_attribute_store(attribute_name);
+            }
+            Attribute<double> h;
+            if (dim == 6) {
+                h.create_vector_attribute(M.vertices.attributes(), attribute_name, 6);
+            } else {
+                h.bind(M.vertices.attributes(), attribute_name);
+            }
+            if (M.vertices.nb() > 0) {
+                std::copy(values.begin(), values.end(), &h[0]);
+            }
+        }
+    }
+
+    bool store_hessian_size_map(Mesh& M, const std::string& field, double error,
+                                const MmgOptions& opt, const std::string& attribute_name) {
+        std::vector<double> values;
+        if (!compute_hessian_size_map(M, field, error, opt, values)) return false;
+        store_size_map(M, values, opt.enable_anisotropy ? 6 : 1, attribute_name);
+        return true;
+    }
+
+    bool store_curvature_size_map(Mesh& M, const MmgOptions& opt,
+                                  const std::string& attribute_name) {
+        std::vector<double> values;
+        if (!compute_curvature_size_map(M, opt, values)) return false;
+        store_size_map(M, values, opt.enable_anisotropy ? 6 : 1, attribute_name);
+        return true;
+    }
+
+    namespace {
+        /* Regular tets (equilateral triangles) of edge 1 per unit volume
+         * (area): 6 sqrt(2) and 4 / sqrt(3) */
+        const double TETS_PER_UNIT_VOLUME = 8.485281374;
+        const double TRIANGLES_PER_UNIT_AREA = 2.309401077;
+
+        /* Rough peak memory per element: the mmg arrays with their
+         * reserve, the adjacency, the vertices and the GEO::Mesh copy */
+        const double MMG3D_BYTES_PER_TET = 160.;
+        const double MMGS_BYTES_PER_TRIANGLE = 200.;
+
+        /* Elements per task of the parallel integration */
+        const index_t ESTIMATE_CHUNK_SIZE = 16384;
+
+        /* As count_in_chunks() in mmg_preflight.cpp, the sum does not
+         * depend on the number of threads */
+        double sum_in_chunks(index_t n, const std::function<double(index_t, index_t)>& func) {
+            index_t nb_chunks = (n + ESTIMATE_CHUNK_SIZE - 1) / ESTIMATE_CHUNK_SIZE;
+            std::vector<double> sums(nb_chunks, 0.);
+            parallel_for(0, nb_chunks, [&](index_t chunk) {
+                index_t from = chunk * ESTIMATE_CHUNK_SIZE;
+                sums[chunk] = func(from, std::min(n, from + ESTIMATE_CHUNK_SIZE));
+            });
+            double total = 0.;
+            for (double s : sums) total += s;
+            return total;
+        }
+
+        /* Elements of edge 1 per element of size m, m being a size or the
+         * upper triangular part of a tensor */
+        double metric_density(const double* m, index_t dim, bool volume_mesh,
+                              double scale, double hmin, double hmax) {
+            if (dim == 6) {
+                double det = m[0] * (m[3] * m[5] - m[4] * m[4])
+                    - m[1] * (m[1] * m[5] - m[4] * m[2])
+                    + m[2] * (m[1] * m[4] - m[3] * m[2]);
+                det = std::max(det, 0.);
+                return volume_mesh ? std::sqrt(det) / (scale * scale * scale) : std::cbrt(det) / (scale * scale);
+            }
+            double h = m[0] * scale;
+            if (hmin > 0.) h = std::max(h, hmin);
+            if (hmax > 0.) h = std::min(h, hmax);
+            return volume_mesh ? 1. / (h * h * h) : 1. / (h * h);
+        }
+    }
+
+    bool estimate_element_count(const Mesh& M, bool volume_mesh,
+                                const MmgOptions& opt, double& nb_elements) {
+        nb_elements = 0.;
+        index_t nv = M.vertices.nb();
+        std::vector<double> density(nv, 0.);
+        if (has_input_metric(opt)) {
+            std::vector<double> curvature;
+            const double* values = NULL;
+            index_t dim = 1;
+            Attribute<double> h_local;
+            if (opt.metric_attribute != "no_metric") {
+                if (!M.vertices.attributes().is_defined(opt.metric_attribute)) {
+                    mmg_log_err("mmg_budget") << opt.metric_attribute << " is not a vertex attribute, cancel" << std::endl;
+                    return false;
+                }
+                h_local.bind(M.vertices.attributes(), opt.metric_attribute);
+                dim = h_local.dimension();
+                values = (nv == 0) ? NULL : &h_local[0];
+            } else {
+                if (!compute_curvature_size_map(M, opt, curvature)) return false;
+                dim = opt.enable_anisotropy ? 6 : 1;
+                values = curvature.data();
+            }
+            if (dim != 1 && dim != 6) {
+                mmg_log_err("mmg_budget") << "metric dimension should be 1 or 6, got " << dim << std::endl;
+                return false;
+            }
+            parallel_for_slice(0, nv, [&](index_t from, index_t to) {
+                for (index_t v = from; v < to; ++v) {
+                    density[v] = metric_density(values + dim * v, dim, volume_mesh,
+                                                opt.metric_scale, opt.hmin, opt.hmax);
+                }
+            });
+        } else {
+            double h = (opt.hsiz > 0.) ? opt.hsiz : opt.hmax;
+            if (h <= 0.) {
+                mmg_log_err("mmg_budget") << "no metric, hsiz nor hmax to estimate the sizes from" << std::endl;
+                return false;
+            }
+            std::fill(density.begin(), density.end(), volume_mesh ? 1. / (h * h * h) : 1. / (h * h));
+        }
+
+        if (volume_mesh) {
+            nb_elements = TETS_PER_UNIT_VOLUME * sum_in_chunks(M.cells.nb(), [&](index_t from, index_t to) {
+                double sum = 0.;
+                for (index_t c = from; c < to; ++c) {
+                    if (M.cells.type(c) != MESH_TET) {
+                        sum += 1. / TETS_PER_UNIT_VOLUME;
+                        continue;
+                    }
+                    vec3 p[4];
+                    double d = 0.;
+                    for (index_t lv = 0; lv < 4; ++lv) {
+                        index_t v = M.cells.vertex(c, lv);
+                        p[lv] = vec3(M.vertices.point_ptr(v));
+                        d += 0.25 * density[v];
+                    }
+                    double volume = std::fabs(dot(p[1] - p[0], cross(p[2] - p[0], p[3] - p[0]))) / 6.;
+                    sum += volume * d;
+                }
+                return sum;
+            });
+        } else {
+            nb_elements = TRIANGLES_PER_UNIT_AREA * sum_in_chunks(M.facets.nb(), [&](index_t from, index_t to) {
+                double sum = 0.;
+                for (index_t f = from; f < to; ++f) {
+                    /* polygons are fanned */
+                    index_t n = M.facets.nb_vertices(f);
+                    index_t v0 = M.facets.vertex(f, 0);
+                    vec3 p0(M.vertices.point_ptr(v0));
+                    for (index_t lv = 1; lv + 1 < n; ++lv) {
+                        index_t v1 = M.facets.vertex(f, lv);
+                        index_t v2 = M.facets.vertex(f, lv + 1);
+                        vec3 p1(M.vertices.point_ptr(v1));
+                        vec3 p2(M.vertices.point_ptr(v2));
+                        double area = 0.5 * length(cross(p1 - p0, p2 - p0));
+                        sum += area * (density[v0] + density[v1] + density[v2]) / 3.;
+                    }
+                }
+                return sum;
+            });
+        }
+        return true;
+    }
+
+    bool apply_element_budget(const Mesh& M, bool volume_mesh, MmgOptions& opt) {
+        if (opt.target_elements == 0 && opt.memory_budget <= 0.) return true;
+        Stopwatch W("mmg_budget", false);
+        double estimate = 0.;
+        if (!estimate_element_count(M, volume_mesh, opt, estimate)) return false;
+        if (opt.target_elements > 0 && estimate > 0.) {
+            double scale = std::pow(estimate / double(opt.target_elements), volume_mesh ? 1. / 3. : 0.5);
+            if (has_input_metric(opt)) {
+                opt.metric_scale *= scale;
+                opt.hmin *= scale;
+                opt.hmax *= scale;
+            } else {
+                opt.hsiz = scale * ((opt.hsiz > 0.) ? opt.hsiz : opt.hmax);
+            }
+            mmg_log_out("mmg_budget") << "about " << index_t(estimate) << " elements, sizes scaled by "
+                << scale << " for " << opt.target_elements << std::endl;
+            estimate = double(opt.target_elements);
+        }
+        double nb_input = double(volume_mesh ? M.cells.nb() : M.facets.nb());
+        double bytes = (volume_mesh ? MMG3D_BYTES_PER_TET : MMGS_BYTES_PER_TRIANGLE) * std::max(estimate, nb_input);
+        if (opt.memory_budget > 0. && bytes > opt.memory_budget * 1e9) {
+            mmg_log_err("mmg_budget") << "about " << index_t(estimate) << " elements, "
+                << bytes * 1e-9 << " GB estimated, over the budget of " << opt.memory_budget
+                << " GB, cancel" << std::endl;
+            return false;
+        }
+        mmg_log_out("mmg_budget") << "about " << index_t(estimate) << " elements, "
+            << bytes * 1e-9 << " GB estimated, " << W.elapsed_time() << " s" << std::endl;
+        return true;
+    }
+}
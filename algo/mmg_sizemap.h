@@ -0,0 +1,122 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_SIZEMAP__H
+#define H__OGF_MMGIG_MMG_SIZEMAP__H
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <vector>
+
+namespace GEO {
+    class Mesh;
+}
+
+namespace OGF {
+
+    /**
+     * \brief Per-vertex sizes from the discrete curvature of the surface.
+     * \details The surface is M.facets, or the border of M.cells if there
+     *   are no facets. The principal curvatures k1, k2 are fitted at each
+     *   surface vertex, and the size along each principal direction is the
+     *   one giving a chordal deviation of opt.hausd, h = sqrt(8 hausd / |k|),
+     *   clamped to [opt.hmin, opt.hmax]. Interior vertices get opt.hmax, mmg
+     *   grades the sizes with opt.hgrad. If opt.angle_detection is set, the
+     *   vertices on sharp features (normals apart by more than
+     *   opt.angle_value) take the smallest size of their smooth neighbours.
+     *   Computed in parallel over the vertices.
+     * \param[out] values one size per vertex, or if opt.enable_anisotropy the
+     *   upper triangular part of the metric tensor (m11 m12 m13 m22 m23 m33)
+     *   with the principal directions as eigenvectors.
+     */
+    bool mmgig_API compute_curvature_size_map(const Mesh& M, const MmgOptions& opt,
+                                              std::vector<double>& values);
+
+    /* Same, stored in the vertex attribute attribute_name (dimension 6 if
+     * opt.enable_anisotropy), usable as MmgOptions::metric_attribute */
+    bool mmgig_API store_curvature_size_map(Mesh& M, const MmgOptions& opt,
+                                            const std::string& attribute_name);
+
+    /**
+     * \brief Per-vertex sizes bounding the P1 interpolation error of a field.
+     * \details The Hessian of the scalar vertex attribute field is recovered
+     *   by averaging element gradients at the vertices twice, on the tets of
+     *   M or on its triangles if there are no cells. Each eigenvalue becomes
+     *   clamp(2/9 |lambda| / error, 1/hmax^2, 1/hmin^2), so that the
+     *   interpolation error is about error everywhere.
+     * \param[out] values one size per vertex (given by the largest
+     *   eigenvalue), or if opt.enable_anisotropy the metric tensor
+     *   (m11 m12 m13 m22 m23 m33)
+     */
+    bool mmgig_API compute_hessian_size_map(const Mesh& M, const std::string& field,
+                                            double error, const MmgOptions& opt,
+                                            std::vector<double>& values);
+
+    /* Same, stored in the vertex attribute attribute_name */
+    bool mmgig_API store_hessian_size_map(Mesh& M, const std::string& field, double error,
+                                          const MmgOptions& opt, const std::string& attribute_name);
+
+    /**
+     * \brief A priori number of elements of the remeshing of M with opt.
+     * \details The density of the metric (metric_attribute or the
+     *   curvature size map, scaled by metric_scale and clamped to
+     *   [hmin, hmax]; else hsiz, or hmax if hsiz is 0) is integrated over
+     *   the tets (volume_mesh) or the triangles, h^-3 or h^-2 for a size h
+     *   and sqrt(det) or det^(1/3) for a tensor, times the number of
+     *   regular elements of edge 1 per unit volume or area. Computed in
+     *   parallel. The cells that are not tets are kept by mmg3d and
+     *   counted once. hausd and hgrad are not taken into account.
+     */
+    bool mmgig_API estimate_element_count(const Mesh& M, bool volume_mesh,
+                                          const MmgOptions& opt, double& nb_elements);
+
+    /**
+     * \brief Applies opt.target_elements and opt.memory_budget.
+     * \details With a target, the sizes are scaled by
+     *   (estimate / target)^(1/d), through metric_scale, hmin and hmax
+     *   with a metric, hsiz without. The call fails if the memory for the
+     *   larger of the input and the estimated output is over the budget.
+     */
+    bool mmgig_API apply_element_budget(const Mesh& M, bool volume_mesh, MmgOptions& opt);
+}
+
+#endif
@@ -0,0 +1,74 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <sstream>
+
+namespace OGF {
+
+    std::string MmgRemeshStats::to_json() const {
+        std::ostringstream out;
+        out << "{\"success\": " << (success ? "true" : "false")
+            << ", \"skipped\": " << (skipped ? "true" : "false")
+            << ", \"mmg_return_code\": " << mmg_return_code
+            << ", \"input\": {\"vertices\": " << nb_vertices_in
+            << ", \"edges\": " << nb_edges_in
+            << ", \"triangles\": " << nb_triangles_in
+            << ", \"tets\": " << nb_tets_in << "}"
+            << ", \"output\": {\"vertices\": " << nb_vertices_out
+            << ", \"edges\": " << nb_edges_out
+            << ", \"triangles\": " << nb_triangles_out
+            << ", \"tets\": " << nb_tets_out << "}"
+            << ", \"vertex_ratio\": " << vertex_ratio()
+            << ", \"times\": {\"geo_to_mmg\": " << times.geo_to_mmg
+            << ", \"setup\": " << times.setup
+            << ", \"mmg\": " << times.mmg
+            << ", \"mmg_to_geo\": " << times.mmg_to_geo
+            << ", \"connect\": " << times.connect
+            << ", \"transfer\": " << times.transfer
+            << ", \"reorder\": " << times.reorder
+            << ", \"total\": " << times.total << "}"
+            << ", \"mmg_memory\": " << mmg_memory
+            << ", \"peak_memory\": " << peak_memory << "}";
+        return out.str();
+    }
+}
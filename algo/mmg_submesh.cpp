@@ -0,0 +1,1149 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_submesh.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+#include <geogram/mesh/mesh_geometry.h>
+
+#include <algorithm>
+#include <array>
+
+namespace OGF {
+    using namespace GEO;
+
+    namespace {
+        typedef std::array<index_t,3> Triple;
+
+        Triple sorted_triple(index_t v0, index_t v1, index_t v2) {
+            Triple t = {{v0, v1, v2}};
+            std::sort(t.begin(), t.end());
+            return t;
+        }
+
+        std::pair<index_t,index_t> sorted_pair(index_t v1, index_t v2) {
+            return std::make_pair(std::min(v1,v2), std::max(v1,v2));
+        }
+
+        bool is_interface_face(const Mesh& M, const std::vector<index_t>& cell_part,
+                               index_t c, index_t lf) {
+            index_t adj = M.cells.adjacent(c,lf);
+            return adj != NO_CELL && cell_part[adj] != cell_part[c];
+        }
+
+        /* Counting sort of the (key, item) pairs, the ones with a key of
+         * nb_keys or more are dropped. The items keep their order */
+        void bucket_by_key(const std::vector<std::pair<index_t,index_t> >& key_items, index_t nb_keys,
+                           std::vector<index_t>& begin, std::vector<index_t>& items) {
+            begin.assign(nb_keys + 1, 0);
+            for (const std::pair<index_t,index_t>& ki : key_items) {
+                if (ki.first < nb_keys) ++begin[ki.first + 1];
+            }
+            for (index_t k = 0; k < nb_keys; ++k) {
+                begin[k + 1] += begin[k];
+            }
+            items.resize(begin[nb_keys]);
+            std::vector<index_t> next(begin.begin(), begin.end() - 1);
+            for (const std::pair<index_t,index_t>& ki : key_items) {
+                if (ki.first < nb_keys) items[next[ki.first]++] = ki.second;
+            }
+        }
+    }
+
+    const Mesh& cell_connected_input(const Mesh& M, Mesh& connected) {
+        /* A connected mesh of more than one cell has an adjacent cell on
+         * its first cells already, the scan stops there */
+        if (M.cells.nb() <= 1) return M;
+        for (index_t c = 0; c < M.cells.nb(); ++c) {
+            for (index_t lf = 0; lf < M.cells.nb_facets(c); ++lf) {
+                if (M.cells.adjacent(c,lf) != NO_CELL) return M;
+            }
+        }
+        connected.copy(M);
+        connected.cells.connect();
+        return connected;
+    }
+
+    void compute_facet_cells(const Mesh& M, std::vector<index_t>& facet_cell) {
+        facet_cell.assign(M.facets.nb(), NO_CELL);
+        if (M.facets.nb() == 0) return;
+
+        std::vector<std::pair<Triple,index_t> > facets;
+        facets.reserve(M.facets.nb());
+        for (index_t f = 0; f < M.facets.nb(); ++f) {
+            if (M.facets.nb_vertices(f) != 3) continue;
+            facets.push_back(std::make_pair(sorted_triple(
+                M.facets.vertex(f,0), M.facets.vertex(f,1), M.facets.vertex(f,2)), f));
+        }
+        std::sort(facets.begin(), facets.end());
+
+        parallel_for_slice(0, M.cells.nb(), [&](index_t from, index_t to) {
+            for (index_t c = from; c < to; ++c) {
+                for (index_t lf = 0; lf < M.cells.nb_facets(c); ++lf) {
+                    if (M.cells.facet_nb_vertices(c,lf) != 3) continue;
+                    /* each face is looked up from one of its cells only */
+                    index_t adj = M.cells.adjacent(c,lf);
+                    if (adj != NO_CELL && adj < c) continue;
+                    std::pair<Triple,index_t> query(sorted_triple(
+                        M.cells.facet_vertex(c,lf,0), M.cells.facet_vertex(c,lf,1),
+                        M.cells.facet_vertex(c,lf,2)), 0);
+                    auto it = std::lower_bound(facets.begin(), facets.end(), query);
+                    for (; it != facets.end() && it->first == query.first; ++it) {
+                        facet_cell[it->second] = c;
+                    }
+                }
+            }
+        });
+    }
+
+    void compute_selection_facet_cells(const Mesh& M, const std::vector<index_t>& cell_part,
+                                       std::vector<index_t>& facet_cell) {
+        facet_cell.assign(M.facets.nb(), NO_CELL);
+        if (M.facets.nb() == 0) return;
+
+        std::vector<char> in_parts(M.vertices.nb(), 0);
+        std::vector<std::pair<Triple,index_t> > faces;
+        for (index_t c = 0; c < M.cells.nb(); ++c) {
+            if (cell_part[c] == FROZEN_PART) continue;
+            for (index_t lv = 0; lv < M.cells.nb_vertices(c); ++lv) {
+                in_parts[M.cells.vertex(c,lv)] = 1;
+            }
+            for (index_t lf = 0; lf < M.cells.nb_facets(c); ++lf) {
+                if (M.cells.facet_nb_vertices(c,lf) != 3) continue;
+                index_t adj = M.cells.adjacent(c,lf);
+                if (adj != NO_CELL && adj < c && cell_part[adj] != FROZEN_PART) continue;
+                faces.push_back(std::make_pair(sorted_triple(
+                    M.cells.facet_vertex(c,lf,0), M.cells.facet_vertex(c,lf,1),
+                    M.cells.facet_vertex(c,lf,2)), c));
+            }
+        }
+        std::sort(faces.begin(), faces.end());
+
+        parallel_for_slice(0, M.facets.nb(), [&](index_t from, index_t to) {
+            for (index_t f = from; f < to; ++f) {
+                if (M.facets.nb_vertices(f) != 3) continue;
+                index_t v0 = M.facets.vertex(f,0);
+                index_t v1 = M.facets.vertex(f,1);
+                index_t v2 = M.facets.vertex(f,2);
+                if (!in_parts[v0] || !in_parts[v1] || !in_parts[v2]) continue;
+                std::pair<Triple,index_t> query(sorted_triple(v0, v1, v2), 0);
+                auto it = std::lower_bound(faces.begin(), faces.end(), query);
+                if (it != faces.end() && it->first == query.first) {
+                    facet_cell[f] = it->second;
+                }
+            }
+        });
+    }
+
+    void compute_part_elements(const Mesh& M,
+                               const std::vector<index_t>& cell_part,
+                               index_t nb_parts,
+                               const std::vector<index_t>& facet_cell,
+                               PartElements& elements) {
+        /* The frozen cells are skipped, they can be most of M */
+        index_t nb_part_cells = 0;
+        for (index_t c = 0; c < M.cells.nb(); ++c) {
+            if (cell_part[c] < nb_parts) ++nb_part_cells;
+        }
+        std::vector<std::pair<index_t,index_t> > key_items;
+        key_items.reserve(nb_part_cells);
+        for (index_t c = 0; c < M.cells.nb(); ++c) {
+            if (cell_part[c] < nb_parts) key_items.push_back(std::make_pair(cell_part[c], c));
+        }
+        bucket_by_key(key_items, nb_parts, elements.cell_begin, elements.cells);
+
+        key_items.clear();
+        for (index_t f = 0; f < M.facets.nb(); ++f) {
+            index_t c = facet_cell[f];
+            if (c != NO_CELL) key_items.push_back(std::make_pair(cell_part[c], f));
+        }
+        bucket_by_key(key_items, nb_parts, elements.facet_begin, elements.facets);
+
+        /* An edge is in the parts that have cells at both its vertices */
+        key_items.clear();
+        if (M.edges.nb() > 0) {
+            std::vector<std::pair<index_t,index_t> > vertex_parts;
+            vertex_parts.reserve(4 * size_t(nb_part_cells));
+            for (index_t c = 0; c < M.cells.nb(); ++c) {
+                if (cell_part[c] >= nb_parts) continue;
+                for (index_t lv = 0; lv < M.cells.nb_vertices(c); ++lv) {
+                    vertex_parts.push_back(std::make_pair(M.cells.vertex(c,lv), cell_part[c]));
+                }
+            }
+            std::sort(vertex_parts.begin(), vertex_parts.end());
+            vertex_parts.erase(std::unique(vertex_parts.begin(), vertex_parts.end()), vertex_parts.end());
+            std::vector<index_t> parts_begin;
+            std::vector<index_t> parts;
+            bucket_by_key(vertex_parts, M.vertices.nb(), parts_begin, parts);
+            for (index_t e = 0; e < M.edges.nb(); ++e) {
+                index_t v0 = M.edges.vertex(e,0);
+                index_t v1 = M.edges.vertex(e,1);
+                const index_t* p0 = parts.data() + parts_begin[v0];
+                const index_t* p0_end = parts.data() + parts_begin[v0 + 1];
+                const index_t* p1 = parts.data() + parts_begin[v1];
+                const index_t* p1_end = parts.data() + parts_begin[v1 + 1];
+                /* both lists are sorted */
+                while (p0 != p0_end && p1 != p1_end) {
+                    if (*p0 < *p1) {
+                        ++p0;
+                    } else if (*p1 < *p0) {
+                        ++p1;
+                    } else {
+                        key_items.push_back(std::make_pair(*p0, e));
+                        ++p0;
+                        ++p1;
+                    }
+                }
+            }
+        }
+        bucket_by_key(key_items, nb_parts, elements.edge_begin, elements.edges);
+    }
+
+    bool submesh_to_mmg(const Mesh& M,
+                        const std::vector<index_t>& cell_part,
+                        index_t part,
+                        const std::vector<index_t>& facet_cell,
+                        const PartElements& elements,
+                        const MmgOptions& opt,
+                        MMG5_pMesh& mmg, MMG5_pSol& met) {
+        std::vector<index_t> cells(elements.cells.begin() + elements.cell_begin[part],
+                                   elements.cells.begin() + elements.cell_begin[part + 1]);
+        std::vector<index_t> vertices;
+        vertices.reserve(4 * cells.size());
+        for (index_t c: cells) {
+            for (index_t lv = 0; lv < 4; ++lv) {
+                vertices.push_back(M.cells.vertex(c,lv));
+            }
+        }
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+        auto local = [&](index_t v) -> int {
+            return int(std::lower_bound(vertices.begin(), vertices.end(), v) - vertices.begin()) + 1;
+        };
+
+        Attribute< int > edge_attribute;
+        Attribute< int > facet_attribute;
+        Attribute< int > cell_attribute;
+        if (opt.edge_attribute != "no_attribute") {
+            if (!M.edges.attributes().is_defined(opt.edge_attribute)) {
+                mmg_log_err("mmg_submesh") << "failed to find attribute named " << opt.edge_attribute << " on edges" << std::endl;
+                return false;
+            }
+            edge_attribute.bind(M.edges.attributes(), opt.edge_attribute);
+        }
+        if (opt.facet_attribute != "no_attribute") {
+            if (!M.facets.attributes().is_defined(opt.facet_attribute)) {
+                mmg_log_err("mmg_submesh") << "failed to find attribute named " << opt.facet_attribute << " on facets" << std::endl;
+                return false;
+            }
+            facet_attribute.bind(M.facets.attributes(), opt.facet_attribute);
+        }
+        if (opt.cell_attribute != "no_attribute") {
+            if (!M.cells.attributes().is_defined(opt.cell_attribute)) {
+                mmg_log_err("mmg_submesh") << "failed to find attribute named " << opt.cell_attribute << " on cells" << std::endl;
+                return false;
+            }
+            cell_attribute.bind(M.cells.attributes(), opt.cell_attribute);
+        }
+
+        /* Triangles: the input facets owned by the part, then the faces
+         * shared with other parts that do not carry an input facet */
+        std::vector<index_t> triangles;
+        std::vector<int> triangle_refs;
+        std::vector<bool> triangle_required;
+        std::vector<std::pair<index_t,index_t> > facet_faces; /* (cell, local facet) */
+        for (index_t i = elements.facet_begin[part]; i < elements.facet_begin[part + 1]; ++i) {
+            index_t f = elements.facets[i];
+            index_t c = facet_cell[f];
+            Triple tf = sorted_triple(M.facets.vertex(f,0), M.facets.vertex(f,1), M.facets.vertex(f,2));
+            bool required = false;
+            for (index_t lf = 0; lf < 4; ++lf) {
+                Triple tc = sorted_triple(M.cells.facet_vertex(c,lf,0),
+                        M.cells.facet_vertex(c,lf,1), M.cells.facet_vertex(c,lf,2));
+                if (tc == tf) {
+                    required = is_interface_face(M, cell_part, c, lf);
+                    if (required) facet_faces.push_back(std::make_pair(c,lf));
+                    break;
+                }
+            }
+            for (index_t lv = 0; lv < 3; ++lv) {
+                triangles.push_back(M.facets.vertex(f,lv));
+            }
+            triangle_refs.push_back(facet_attribute.is_bound() ? facet_attribute[f] : 0);
+            triangle_required.push_back(required);
+        }
+        std::sort(facet_faces.begin(), facet_faces.end());
+        for (index_t c: cells) {
+            for (index_t lf = 0; lf < 4; ++lf) {
+                if (!is_interface_face(M, cell_part, c, lf)) continue;
+                if (std::binary_search(facet_faces.begin(), facet_faces.end(), std::make_pair(c,lf))) continue;
+                for (index_t lv = 0; lv < 3; ++lv) {
+                    triangles.push_back(M.cells.facet_vertex(c,lf,lv));
+                }
+                triangle_refs.push_back(INTERFACE_REF);
+                triangle_required.push_back(true);
+            }
+        }
+
+        std::vector<index_t> edges;
+        std::vector<int> edge_refs;
+        for (index_t i = elements.edge_begin[part]; i < elements.edge_begin[part + 1]; ++i) {
+            index_t e = elements.edges[i];
+            edges.push_back(M.edges.vertex(e,0));
+            edges.push_back(M.edges.vertex(e,1));
+            edge_refs.push_back(edge_attribute.is_bound() ? edge_attribute[e] : 0);
+        }
+
+        MMG3D_Init_mesh(MMG5_ARG_start, MMG5_ARG_ppMesh,&mmg,MMG5_ARG_ppMet,&met, MMG5_ARG_end);
+        if (MMG3D_Set_meshSize(mmg, (int) vertices.size(), (int) cells.size(), 0,
+                    (int) triangle_refs.size(), 0, (int) edge_refs.size()) != 1) {
+            mmg_log_err("mmg_submesh") << "failed to MMG3D_Set_meshSize" << std::endl;
+            return false;
+        }
+        for (index_t i = 0; i < vertices.size(); ++i) {
+            const double* p = M.vertices.point_ptr(vertices[i]);
+            for (index_t d = 0; d < 3; ++d) {
+                mmg->point[i+1].c[d] = p[d];
+            }
+        }
+        for (index_t i = 0; i < cells.size(); ++i) {
+            for (index_t lv = 0; lv < 4; ++lv) {
+                mmg->tetra[i+1].v[lv] = local(M.cells.vertex(cells[i],lv));
+            }
+            if (cell_attribute.is_bound()) {
+                mmg->tetra[i+1].ref = cell_attribute[cells[i]];
+            }
+        }
+        for (index_t i = 0; i < triangle_refs.size(); ++i) {
+            for (index_t lv = 0; lv < 3; ++lv) {
+                mmg->tria[i+1].v[lv] = local(triangles[3*i+lv]);
+            }
+            mmg->tria[i+1].ref = triangle_refs[i];
+        }
+        for (index_t i = 0; i < edge_refs.size(); ++i) {
+            mmg->edge[i+1].a = local(edges[2*i]);
+            mmg->edge[i+1].b = local(edges[2*i+1]);
+            mmg->edge[i+1].ref = edge_refs[i];
+        }
+
+        MMG5_type metric_type = opt.enable_anisotropy ? MMG5_Tensor : MMG5_Scalar;
+        if (MMG3D_Set_solSize(mmg,met,MMG5_Vertex,(int)vertices.size(),metric_type) != 1) {
+            mmg_log_err("mmg_submesh") << "failed to MMG3D_Set_solSize" << std::endl;
+            return false;
+        }
+        for (index_t v = 0; v < vertices.size(); ++v) {
+            met->m[v+1] = 1.;
+        }
+        if (opt.metric_attribute != "no_metric") {
+            if (!M.vertices.attributes().is_defined(opt.metric_attribute)) {
+                mmg_log_err("mmg_submesh") << opt.metric_attribute << " is not a vertex attribute, cancel" << std::endl;
+                return false;
+            }
+            Attribute<double> h_local(M.vertices.attributes(), opt.metric_attribute);
+            index_t dim = opt.enable_anisotropy ? 6 : 1;
+            if (h_local.dimension() != dim) {
+                mmg_log_err("mmg_submesh") << opt.metric_attribute << " should have dimension " << dim << ", cancel" << std::endl;
+                return false;
+            }
+            std::vector<double> values(dim * vertices.size());
+            for (index_t i = 0; i < vertices.size(); ++i) {
+                for (index_t k = 0; k < dim; ++k) {
+                    values[dim*i+k] = h_local[dim*vertices[i]+k];
+                }
+            }
+            if (!set_metric_values(mmg, met, true, values.data(), index_t(vertices.size()), dim, false)) {
+                return false;
+            }
+        }
+        if (MMG3D_Chk_meshData(mmg,met) != 1) {
+            mmg_log_err("mmg_submesh") << "error in mmg: inconsistant mesh and sol" << std::endl;
+            return false;
+        }
+        MMG3D_Set_handGivenMesh(mmg);
+
+        /* Freeze the faces between parts */
+        for (index_t i = 0; i < triangle_required.size(); ++i) {
+            if (!triangle_required[i]) continue;
+            MMG3D_Set_requiredTriangle(mmg, int(i+1));
+            for (index_t lv = 0; lv < 3; ++lv) {
+                MMG3D_Set_requiredVertex(mmg, mmg->tria[i+1].v[lv]);
+            }
+        }
+        return true;
+    }
+
+    /*************************************************************************/
+
+    VertexGrid::VertexGrid(const Mesh& M) {
+        double xyzmin[3];
+        double xyzmax[3];
+        get_bbox(M, xyzmin, xyzmax);
+        double diag = 0.;
+        for (index_t d = 0; d < 3; ++d) {
+            diag += geo_sqr(xyzmax[d] - xyzmin[d]);
+        }
+        diag = ::sqrt(diag);
+        if (diag == 0.) diag = 1.;
+        /* mmg scales the coordinates to the unit box and back, so the frozen
+         * vertices move by a few ulps */
+        tolerance_ = 1e-9 * diag;
+        cell_size_ = 1e3 * tolerance_;
+    }
+
+    VertexGrid::Key VertexGrid::key(const double* p) const {
+        Key k = {
+            (long long) ::floor(p[0] / cell_size_),
+            (long long) ::floor(p[1] / cell_size_),
+            (long long) ::floor(p[2] / cell_size_)
+        };
+        return k;
+    }
+
+    void VertexGrid::insert(const double* p, index_t id) {
+        Entry entry = { id, { p[0], p[1], p[2] } };
+        entries_.insert(std::make_pair(key(p), entry));
+    }
+
+    index_t VertexGrid::find(const double* p) const {
+        Key center = key(p);
+        for (int di = -1; di <= 1; ++di) {
+            for (int dj = -1; dj <= 1; ++dj) {
+                for (int dk = -1; dk <= 1; ++dk) {
+                    Key k = { center.i + di, center.j + dj, center.k + dk };
+                    auto range = entries_.equal_range(k);
+                    for (auto it = range.first; it != range.second; ++it) {
+                        const double* q = it->second.p;
+                        if (::fabs(p[0]-q[0]) <= tolerance_
+                                && ::fabs(p[1]-q[1]) <= tolerance_
+                                && ::fabs(p[2]-q[2]) <= tolerance_) {
+                            return it->second.id;
+                        }
+                    }
+                }
+            }
+        }
+        return NO_VERTEX;
+    }
+
+    /*************************************************************************/
+
+    SubmeshStitcher::SubmeshStitcher(const Mesh& M, const MmgOptions& opt) :
+        M_(M),
+        opt_(opt),
+        metric_dim_(0),
+        shared_(M) {
+        if (opt.metric_attribute != "no_metric") {
+            metric_dim_ = opt.enable_anisotropy ? 6 : 1;
+            input_metric_.bind_if_is_defined(M.vertices.attributes(), opt.metric_attribute);
+        }
+        shared_id_.assign(M.vertices.nb(), NO_VERTEX);
+    }
+
+    const double* SubmeshStitcher::input_metric(index_t v) const {
+        if (!input_metric_.is_bound() || input_metric_.dimension() != metric_dim_) {
+            return NULL;
+        }
+        return &input_metric_[metric_dim_ * v];
+    }
+
+    index_t SubmeshStitcher::new_vertex(const double* p, const double* metric) {
+        index_t v = index_t(points_.size() / 3);
+        points_.insert(points_.end(), p, p+3);
+        for (index_t k = 0; k < metric_dim_; ++k) {
+            metric_.push_back(metric == NULL ? 0. : metric[k]);
+        }
+        return v;
+    }
+
+    index_t SubmeshStitcher::register_shared_vertex(index_t v) {
+        if (shared_id_[v] == NO_VERTEX) {
+            const double* p = M_.vertices.point_ptr(v);
+            shared_id_[v] = new_vertex(p, input_metric(v));
+            shared_.insert(p, shared_id_[v]);
+        }
+        return shared_id_[v];
+    }
+
+    void SubmeshStitcher::add_edge(index_t v1, index_t v2, int ref) {
+        edges_.push_back(v1);
+        edges_.push_back(v2);
+        edge_refs_.push_back(ref);
+    }
+
+    void SubmeshStitcher::add_frozen_and_interfaces(const std::vector<index_t>& cell_part,
+                                                    const std::vector<index_t>& facet_cell) {
+        /* Vertices on the faces between parts (or between a part and the
+         * frozen cells) */
+        for (index_t c = 0; c < M_.cells.nb(); ++c) {
+            for (index_t lf = 0; lf < 4; ++lf) {
+                if (!is_interface_face(M_, cell_part, c, lf)) continue;
+                for (index_t lv = 0; lv < 3; ++lv) {
+                    register_shared_vertex(M_.cells.facet_vertex(c,lf,lv));
+                }
+            }
+        }
+
+        Attribute< int > edge_attribute;
+        Attribute< int > facet_attribute;
+        Attribute< int > cell_attribute;
+        edge_attribute.bind_if_is_defined(M_.edges.attributes(), opt_.edge_attribute);
+        facet_attribute.bind_if_is_defined(M_.facets.attributes(), opt_.facet_attribute);
+        cell_attribute.bind_if_is_defined(M_.cells.attributes(), opt_.cell_attribute);
+
+        /* Frozen cells, kept as is */
+        std::vector<bool> frozen_vertex(M_.vertices.nb(), false);
+        for (index_t c = 0; c < M_.cells.nb(); ++c) {
+            if (cell_part[c] != FROZEN_PART) continue;
+            for (index_t lv = 0; lv < 4; ++lv) {
+                index_t v = M_.cells.vertex(c,lv);
+                frozen_vertex[v] = true;
+                if (shared_id_[v] == NO_VERTEX) {
+                    shared_id_[v] = new_vertex(M_.vertices.point_ptr(v), input_metric(v));
+                }
+                tets_.push_back(shared_id_[v]);
+            }
+            tet_refs_.push_back(cell_attribute.is_bound() ? cell_attribute[c] : 0);
+            tet_parts_.push_back(FROZEN_PART);
+        }
+        for (index_t f = 0; f < M_.facets.nb(); ++f) {
+            index_t c = facet_cell[f];
+            if (c == NO_CELL || cell_part[c] != FROZEN_PART) continue;
+            for (index_t lv = 0; lv < 3; ++lv) {
+                triangles_.push_back(shared_id_[M_.facets.vertex(f,lv)]);
+            }
+            triangle_refs_.push_back(facet_attribute.is_bound() ? facet_attribute[f] : 0);
+        }
+
+        /* Input edges: the ones of the frozen cells are kept, the ones between
+         * two interface vertices must survive the stitching of the parts */
+        for (index_t e = 0; e < M_.edges.nb(); ++e) {
+            index_t v1 = M_.edges.vertex(e,0);
+            index_t v2 = M_.edges.vertex(e,1);
+            if (frozen_vertex[v1] && frozen_vertex[v2]) {
+                add_edge(shared_id_[v1], shared_id_[v2], edge_attribute.is_bound() ? edge_attribute[e] : 0);
+            } else if (shared_id_[v1] != NO_VERTEX && shared_id_[v2] != NO_VERTEX) {
+                interface_edges_.push_back(sorted_pair(shared_id_[v1], shared_id_[v2]));
+            }
+        }
+        std::sort(interface_edges_.begin(), interface_edges_.end());
+    }
+
+    void SubmeshStitcher::add_part(MMG5_pMesh mmg, MMG5_pSol met, index_t part) {
+        index_t np = index_t(mmg->np);
+        bool has_metric = metric_dim_ > 0 && met != NULL && met->np == mmg->np
+            && index_t(met->size) == metric_dim_;
+
+        /* Only the vertices of the boundary triangles can be on an interface */
+        std::vector<bool> on_boundary(np+1, false);
+        for (int k = 1; k <= mmg->nt; ++k) {
+            for (index_t lv = 0; lv < 3; ++lv) {
+                on_boundary[mmg->tria[k].v[lv]] = true;
+            }
+        }
+        std::vector<index_t> id(np+1, NO_VERTEX);
+        for (index_t v = 1; v <= np; ++v) {
+            const double* p = mmg->point[v].c;
+            if (on_boundary[v]) {
+                id[v] = shared_.find(p);
+            }
+            if (id[v] == NO_VERTEX) {
+                id[v] = new_vertex(p, has_metric ? &met->m[metric_dim_ * v] : NULL);
+            }
+        }
+
+        for (int k = 1; k <= mmg->ne; ++k) {
+            for (index_t lv = 0; lv < 4; ++lv) {
+                tets_.push_back(id[mmg->tetra[k].v[lv]]);
+            }
+            tet_refs_.push_back(mmg->tetra[k].ref);
+            tet_parts_.push_back(part);
+        }
+        std::vector<std::pair<index_t,index_t> > interface_triangle_edges;
+        for (int k = 1; k <= mmg->nt; ++k) {
+            const MMG5_Tria& t = mmg->tria[k];
+            if (t.ref == INTERFACE_REF) {
+                for (index_t le = 0; le < 3; ++le) {
+                    interface_triangle_edges.push_back(sorted_pair(id[t.v[le]], id[t.v[(le+1)%3]]));
+                }
+                continue;
+            }
+            for (index_t lv = 0; lv < 3; ++lv) {
+                triangles_.push_back(id[t.v[lv]]);
+            }
+            triangle_refs_.push_back(t.ref);
+        }
+        std::sort(interface_triangle_edges.begin(), interface_triangle_edges.end());
+
+        /* mmg outputs the edges of the frozen triangles as required edges, the
+         * ones that were not input edges are dropped */
+        for (int k = 1; k <= mmg->na; ++k) {
+            std::pair<index_t,index_t> e = sorted_pair(id[mmg->edge[k].a], id[mmg->edge[k].b]);
+            if (std::binary_search(interface_triangle_edges.begin(), interface_triangle_edges.end(), e)
+                    && !std::binary_search(interface_edges_.begin(), interface_edges_.end(), e)) {
+                continue;
+            }
+            add_edge(e.first, e.second, mmg->edge[k].ref);
+        }
+    }
+
+    void SubmeshStitcher::get_mesh(Mesh& M_out, std::vector<index_t>* cell_part) {
+        /* Edges on an interface come from both sides */
+        std::vector<index_t> edge_order(edge_refs_.size());
+        for (index_t e = 0; e < edge_order.size(); ++e) edge_order[e] = e;
+        auto edge_key = [&](index_t e) {
+            return sorted_pair(edges_[2*e], edges_[2*e+1]);
+        };
+        std::stable_sort(edge_order.begin(), edge_order.end(), [&](index_t a, index_t b) {
+            return edge_key(a) < edge_key(b);
+        });
+        edge_order.erase(std::unique(edge_order.begin(), edge_order.end(), [&](index_t a, index_t b) {
+            return edge_key(a) == edge_key(b);
+        }), edge_order.end());
+
+        M_out.clear();
+        index_t nv = index_t(points_.size() / 3);
+        M_out.vertices.create_vertices(nv);
+        M_out.edges.create_edges(index_t(edge_order.size()));
+        M_out.facets.create_triangles(index_t(triangle_refs_.size()));
+        M_out.cells.create_tets(index_t(tet_refs_.size()));
+
+        Attribute< int > edge_attribute;
+        Attribute< int > facet_attribute;
+        Attribute< int > cell_attribute;
+        if (opt_.edge_attribute != "no_attribute") {
+            edge_attribute.bind(M_out.edges.attributes(), opt_.edge_attribute);
+        }
+        if (opt_.facet_attribute != "no_attribute") {
+            facet_attribute.bind(M_out.facets.attributes(), opt_.facet_attribute);
+        }
+        if (opt_.cell_attribute != "no_attribute") {
+            cell_attribute.bind(M_out.cells.attributes(), opt_.cell_attribute);
+        }
+        Attribute<double> metric;
+        if (metric_dim_ == 1) {
+            metric.bind(M_out.vertices.attributes(), opt_.metric_attribute);
+        } else if (metric_dim_ > 1) {
+            metric.create_vector_attribute(M_out.vertices.attributes(), opt_.metric_attribute, metric_dim_);
+        }
+
+        parallel_for_slice(0, nv, [&](index_t from, index_t to) {
+            for (index_t v = from; v < to; ++v) {
+                double* p = M_out.vertices.point_ptr(v);
+                p[0] = points_[3*v];
+                p[1] = points_[3*v+1];
+                p[2] = points_[3*v+2];
+                for (index_t k = 0; k < metric_dim_; ++k) {
+                    metric[metric_dim_*v+k] = metric_[metric_dim_*v+k];
+                }
+            }
+        });
+        for (index_t e = 0; e < edge_order.size(); ++e) {
+            index_t i = edge_order[e];
+            M_out.edges.set_vertex(e,0,edges_[2*i]);
+            M_out.edges.set_vertex(e,1,edges_[2*i+1]);
+            if (edge_attribute.is_bound()) edge_attribute[e] = edge_refs_[i];
+        }
+        parallel_for_slice(0, M_out.facets.nb(), [&](index_t from, index_t to) {
+            for (index_t t = from; t < to; ++t) {
+                for (index_t lv = 0; lv < 3; ++lv) {
+                    M_out.facets.set_vertex(t,lv,triangles_[3*t+lv]);
+                }
+                if (facet_attribute.is_bound()) facet_attribute[t] = triangle_refs_[t];
+            }
+        });
+        parallel_for_slice(0, M_out.cells.nb(), [&](index_t from, index_t to) {
+            for (index_t c = from; c < to; ++c) {
+                for (index_t lv = 0; lv < 4; ++lv) {
+                    M_out.cells.set_vertex(c,lv,tets_[4*c+lv]);
+                }
+                if (cell_attribute.is_bound()) cell_attribute[c] = tet_refs_[c];
+            }
+        });
+        M_out.facets.connect();
+        M_out.cells.connect();
+
+        if (cell_part != NULL) {
+            *cell_part = tet_parts_;
+        }
+    }
+
+    /*************************************************************************/
+
+    namespace {
+        /* Converts and remeshes the parts, meshes[p] and mets[p] receive
+         * part p (to be freed by the caller, also on failure) */
+        bool remesh_each_part(const Mesh& M,
+                              const std::vector<index_t>& cell_part,
+                              index_t nb_parts,
+                              const std::vector<index_t>& facet_cell,
+                              const MmgOptions& opt,
+                              std::vector<MMG5_pMesh>& meshes,
+                              std::vector<MMG5_pSol>& mets) {
+            meshes.assign(nb_parts, NULL);
+            mets.assign(nb_parts, NULL);
+            std::vector<int> status(nb_parts, MMG5_SUCCESS);
+            bool has_metric = (opt.metric_attribute != "no_metric");
+
+            /* Each part lives in its own MMG5_pMesh. The parts share the
+             * metric type of opt, so their mmg calls run concurrently under
+             * the MmgCallGuard of run_mmg() */
+            PartElements elements;
+            compute_part_elements(M, cell_part, nb_parts, facet_cell, elements);
+            MmgLogBuffer* log = MmgLogScope::current();
+            parallel_for(0, nb_parts, [&](index_t p) {
+                MmgLogScope log_scope(log);
+                if (!submesh_to_mmg(M, cell_part, p, facet_cell, elements, opt, meshes[p], mets[p])) {
+                    status[p] = MMG5_STRONGFAILURE;
+                    return;
+                }
+                if (meshes[p]->ne == 0) return;
+                if (opt.monitor != NULL && opt.monitor->cancel_requested) {
+                    status[p] = MMG5_STRONGFAILURE;
+                    return;
+                }
+                mmg3d_set_parameters(meshes[p], mets[p], opt, has_metric);
+                MMG3D_Set_iparameter(meshes[p], mets[p], MMG3D_IPARAM_verbose, -1);
+                status[p] = run_mmg(MMG_CALL_MMG3DLIB, meshes[p], mets[p]);
+            });
+
+            bool ok = monitor_phase(opt, MMG_PHASE_CONVERSION_BACK);
+            for (index_t p = 0; ok && p < nb_parts; ++p) {
+                if (status[p] != MMG5_SUCCESS) {
+                    mmg_log_err("mmg3d_parallel") << "failed to remesh part " << p << std::endl;
+                    ok = false;
+                }
+            }
+            return ok;
+        }
+    }
+
+    bool remesh_parts(const Mesh& M,
+                      const std::vector<index_t>& cell_part,
+                      index_t nb_parts,
+                      const MmgOptions& opt,
+                      Mesh& M_out,
+                      std::vector<index_t>* out_cell_part) {
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING)) return false;
+        Stopwatch W("remesh_parts", false);
+        std::vector<index_t> facet_cell;
+        compute_facet_cells(M, facet_cell);
+
+        std::vector<MMG5_pMesh> meshes;
+        std::vector<MMG5_pSol> mets;
+        bool ok = remesh_each_part(M, cell_part, nb_parts, facet_cell, opt, meshes, mets);
+        double t_remesh = W.elapsed_time();
+        if (ok) {
+            SubmeshStitcher stitcher(M, opt);
+            stitcher.add_frozen_and_interfaces(cell_part, facet_cell);
+            for (index_t p = 0; p < nb_parts; ++p) {
+                stitcher.add_part(meshes[p], mets[p], p);
+                mmg3d_free(meshes[p], mets[p]);
+                meshes[p] = NULL;
+            }
+            stitcher.get_mesh(M_out, out_cell_part);
+            mmg_log_out("mmg3d_parallel") << nb_parts << " parts: remesh " << t_remesh
+                << " s, stitch " << W.elapsed_time() - t_remesh << " s, "
+                << M_out.vertices.nb() << " vertices, " << M_out.cells.nb() << " tets" << std::endl;
+        }
+        for (index_t p = 0; p < nb_parts; ++p) {
+            if (meshes[p] != NULL) mmg3d_free(meshes[p], mets[p]);
+        }
+        return ok;
+    }
+
+    /*************************************************************************/
+
+    SelectionSplicer::SelectionSplicer(const Mesh& M, const std::vector<index_t>& cell_part,
+                                       const std::vector<index_t>& facet_cell, const MmgOptions& opt) :
+        M_(M),
+        cell_part_(cell_part),
+        facet_cell_(facet_cell),
+        opt_(opt),
+        metric_dim_(0),
+        nb_kept_vertices_(0),
+        interface_(M) {
+        if (opt.metric_attribute != "no_metric") {
+            metric_dim_ = opt.enable_anisotropy ? 6 : 1;
+            input_metric_.bind_if_is_defined(M.vertices.attributes(), opt.metric_attribute);
+        }
+
+        /* A vertex is kept unless all its cells are selected */
+        std::vector<char> in_region(M.vertices.nb(), 0);
+        for (index_t c = 0; c < M.cells.nb(); ++c) {
+            if (cell_part[c] == FROZEN_PART) continue;
+            selected_cells_.push_back(c);
+            for (index_t lv = 0; lv < 4; ++lv) {
+                in_region[M.cells.vertex(c,lv)] = 1;
+            }
+        }
+        std::vector<char> kept(M.vertices.nb(), 0);
+        for (index_t v = 0; v < M.vertices.nb(); ++v) {
+            kept[v] = !in_region[v];
+        }
+        for (index_t c = 0; c < M.cells.nb(); ++c) {
+            if (cell_part[c] != FROZEN_PART) continue;
+            for (index_t lv = 0; lv < 4; ++lv) {
+                kept[M.cells.vertex(c,lv)] = 1;
+            }
+        }
+        vertex_id_.assign(M.vertices.nb(), NO_VERTEX);
+        for (index_t v = 0; v < M.vertices.nb(); ++v) {
+            if (!kept[v]) continue;
+            vertex_id_[v] = nb_kept_vertices_++;
+            if (in_region[v]) interface_.insert(M.vertices.point_ptr(v), vertex_id_[v]);
+        }
+
+        for (index_t e = 0; e < M.edges.nb(); ++e) {
+            index_t v1 = M.edges.vertex(e,0);
+            index_t v2 = M.edges.vertex(e,1);
+            if (kept[v1] && kept[v2] && in_region[v1] && in_region[v2]) {
+                interface_edges_.push_back(sorted_pair(vertex_id_[v1], vertex_id_[v2]));
+            }
+        }
+        std::sort(interface_edges_.begin(), interface_edges_.end());
+    }
+
+    void SelectionSplicer::add_part(MMG5_pMesh mmg, MMG5_pSol met) {
+        index_t np = index_t(mmg->np);
+        bool has_metric = metric_dim_ > 0 && met != NULL && met->np == mmg->np
+            && index_t(met->size) == metric_dim_;
+
+        std::vector<bool> on_boundary(np+1, false);
+        for (int k = 1; k <= mmg->nt; ++k) {
+            for (index_t lv = 0; lv < 3; ++lv) {
+                on_boundary[mmg->tria[k].v[lv]] = true;
+            }
+        }
+        std::vector<index_t> id(np+1, NO_VERTEX);
+        for (index_t v = 1; v <= np; ++v) {
+            const double* p = mmg->point[v].c;
+            if (on_boundary[v]) {
+                id[v] = interface_.find(p);
+            }
+            if (id[v] == NO_VERTEX) {
+                id[v] = nb_kept_vertices_ + index_t(points_.size() / 3);
+                points_.insert(points_.end(), p, p+3);
+                for (index_t k = 0; k < metric_dim_; ++k) {
+                    metric_.push_back(has_metric ? met->m[metric_dim_ * v + k] : 0.);
+                }
+            }
+        }
+
+        for (int k = 1; k <= mmg->ne; ++k) {
+            for (index_t lv = 0; lv < 4; ++lv) {
+                tets_.push_back(id[mmg->tetra[k].v[lv]]);
+            }
+            tet_refs_.push_back(mmg->tetra[k].ref);
+        }
+        std::vector<std::pair<index_t,index_t> > interface_triangle_edges;
+        for (int k = 1; k <= mmg->nt; ++k) {
+            const MMG5_Tria& t = mmg->tria[k];
+            if (t.ref == INTERFACE_REF) {
+                for (index_t le = 0; le < 3; ++le) {
+                    interface_triangle_edges.push_back(sorted_pair(id[t.v[le]], id[t.v[(le+1)%3]]));
+                }
+                continue;
+            }
+            for (index_t lv = 0; lv < 3; ++lv) {
+                triangles_.push_back(id[t.v[lv]]);
+            }
+            triangle_refs_.push_back(t.ref);
+        }
+        std::sort(interface_triangle_edges.begin(), interface_triangle_edges.end());
+
+        /* The input edges between interface vertices are copied with the
+         * frozen edges, the other edges of the frozen triangles were added
+         * by mmg */
+        for (int k = 1; k <= mmg->na; ++k) {
+            std::pair<index_t,index_t> e = sorted_pair(id[mmg->edge[k].a], id[mmg->edge[k].b]);
+            if (std::binary_search(interface_triangle_edges.begin(), interface_triangle_edges.end(), e)
+                    || std::binary_search(interface_edges_.begin(), interface_edges_.end(), e)) {
+                continue;
+            }
+            edges_.push_back(e);
+            edge_refs_.push_back(mmg->edge[k].ref);
+        }
+    }
+
+    void SelectionSplicer::get_mesh(Mesh& M_out) {
+        std::vector<index_t> cell_id(M_.cells.nb(), NO_CELL);
+        index_t nb_frozen = 0;
+        for (index_t c = 0; c < M_.cells.nb(); ++c) {
+            if (cell_part_[c] == FROZEN_PART) cell_id[c] = nb_frozen++;
+        }
+        std::vector<index_t> kept_facets;
+        for (index_t f = 0; f < M_.facets.nb(); ++f) {
+            if (facet_cell_[f] != NO_CELL) continue;
+            bool kept = true;
+            for (index_t lv = 0; kept && lv < M_.facets.nb_vertices(f); ++lv) {
+                kept = (vertex_id_[M_.facets.vertex(f,lv)] != NO_VERTEX);
+            }
+            if (kept) kept_facets.push_back(f);
+        }
+        std::vector<index_t> kept_edges;
+        for (index_t e = 0; e < M_.edges.nb(); ++e) {
+            if (vertex_id_[M_.edges.vertex(e,0)] != NO_VERTEX
+                    && vertex_id_[M_.edges.vertex(e,1)] != NO_VERTEX) {
+                kept_edges.push_back(e);
+            }
+        }
+        /* Edges on the faces between two parts come from both sides */
+        std::vector<index_t> edge_order(edges_.size());
+        for (index_t e = 0; e < edge_order.size(); ++e) edge_order[e] = e;
+        std::stable_sort(edge_order.begin(), edge_order.end(), [&](index_t a, index_t b) {
+            return edges_[a] < edges_[b];
+        });
+        edge_order.erase(std::unique(edge_order.begin(), edge_order.end(), [&](index_t a, index_t b) {
+            return edges_[a] == edges_[b];
+        }), edge_order.end());
+
+        index_t nb_new_vertices = index_t(points_.size() / 3);
+        index_t nb_kept_facets = index_t(kept_facets.size());
+        index_t nb_kept_edges = index_t(kept_edges.size());
+        M_out.clear();
+        M_out.vertices.create_vertices(nb_kept_vertices_ + nb_new_vertices);
+        M_out.edges.create_edges(nb_kept_edges + index_t(edge_order.size()));
+        M_out.facets.create_triangles(nb_kept_facets + index_t(triangle_refs_.size()));
+        M_out.cells.create_tets(nb_frozen + index_t(tet_refs_.size()));
+
+        Attribute< int > in_edge_attribute;
+        Attribute< int > in_facet_attribute;
+        Attribute< int > in_cell_attribute;
+        in_edge_attribute.bind_if_is_defined(M_.edges.attributes(), opt_.edge_attribute);
+        in_facet_attribute.bind_if_is_defined(M_.facets.attributes(), opt_.facet_attribute);
+        in_cell_attribute.bind_if_is_defined(M_.cells.attributes(), opt_.cell_attribute);
+        Attribute< int > edge_attribute;
+        Attribute< int > facet_attribute;
+        Attribute< int > cell_attribute;
+        if (opt_.edge_attribute != "no_attribute") {
+            edge_attribute.bind(M_out.edges.attributes(), opt_.edge_attribute);
+        }
+        if (opt_.facet_attribute != "no_attribute") {
+            facet_attribute.bind(M_out.facets.attributes(), opt_.facet_attribute);
+        }
+        if (opt_.cell_attribute != "no_attribute") {
+            cell_attribute.bind(M_out.cells.attributes(), opt_.cell_attribute);
+        }
+        Attribute<double> metric;
+        if (metric_dim_ == 1) {
+            metric.bind(M_out.vertices.attributes(), opt_.metric_attribute);
+        } else if (metric_dim_ > 1) {
+            metric.create_vector_attribute(M_out.vertices.attributes(), opt_.metric_attribute, metric_dim_);
+        }
+        bool has_input_metric = input_metric_.is_bound() && input_metric_.dimension() == metric_dim_;
+
+        /* The frozen elements, by index */
+        parallel_for_slice(0, M_.vertices.nb(), [&](index_t from, index_t to) {
+            for (index_t v = from; v < to; ++v) {
+                index_t w = vertex_id_[v];
+                if (w == NO_VERTEX) continue;
+                const double* p = M_.vertices.point_ptr(v);
+                double* q = M_out.vertices.point_ptr(w);
+                q[0] = p[0];
+                q[1] = p[1];
+                q[2] = p[2];
+                for (index_t k = 0; k < metric_dim_; ++k) {
+                    metric[metric_dim_*w+k] = has_input_metric ? input_metric_[metric_dim_*v+k] : 0.;
+                }
+            }
+        });
+        parallel_for_slice(0, M_.cells.nb(), [&](index_t from, index_t to) {
+            for (index_t c = from; c < to; ++c) {
+                index_t d = cell_id[c];
+                if (d == NO_CELL) continue;
+                for (index_t lv = 0; lv < 4; ++lv) {
+                    M_out.cells.set_vertex(d,lv,vertex_id_[M_.cells.vertex(c,lv)]);
+                }
+                if (cell_attribute.is_bound()) {
+                    cell_attribute[d] = in_cell_attribute.is_bound() ? in_cell_attribute[c] : 0;
+                }
+            }
+        });
+        parallel_for_slice(0, nb_kept_facets, [&](index_t from, index_t to) {
+            for (index_t t = from; t < to; ++t) {
+                index_t f = kept_facets[t];
+                for (index_t lv = 0; lv < 3; ++lv) {
+                    M_out.facets.set_vertex(t,lv,vertex_id_[M_.facets.vertex(f,lv)]);
+                }
+                if (facet_attribute.is_bound()) {
+                    facet_attribute[t] = in_facet_attribute.is_bound() ? in_facet_attribute[f] : 0;
+                }
+            }
+        });
+        for (index_t i = 0; i < nb_kept_edges; ++i) {
+            index_t e = kept_edges[i];
+            M_out.edges.set_vertex(i,0,vertex_id_[M_.edges.vertex(e,0)]);
+            M_out.edges.set_vertex(i,1,vertex_id_[M_.edges.vertex(e,1)]);
+            if (edge_attribute.is_bound()) {
+                edge_attribute[i] = in_edge_attribute.is_bound() ? in_edge_attribute[e] : 0;
+            }
+        }
+
+        /* The elements of the parts */
+        for (index_t v = 0; v < nb_new_vertices; ++v) {
+            index_t w = nb_kept_vertices_ + v;
+            double* q = M_out.vertices.point_ptr(w);
+            q[0] = points_[3*v];
+            q[1] = points_[3*v+1];
+            q[2] = points_[3*v+2];
+            for (index_t k = 0; k < metric_dim_; ++k) {
+                metric[metric_dim_*w+k] = metric_[metric_dim_*v+k];
+            }
+        }
+        for (index_t i = 0; i < tet_refs_.size(); ++i) {
+            for (index_t lv = 0; lv < 4; ++lv) {
+                M_out.cells.set_vertex(nb_frozen+i,lv,tets_[4*i+lv]);
+            }
+            if (cell_attribute.is_bound()) cell_attribute[nb_frozen+i] = tet_refs_[i];
+        }
+        for (index_t i = 0; i < triangle_refs_.size(); ++i) {
+            for (index_t lv = 0; lv < 3; ++lv) {
+                M_out.facets.set_vertex(nb_kept_facets+i,lv,triangles_[3*i+lv]);
+            }
+            if (facet_attribute.is_bound()) facet_attribute[nb_kept_facets+i] = triangle_refs_[i];
+        }
+        for (index_t i = 0; i < edge_order.size(); ++i) {
+            index_t j = edge_order[i];
+            M_out.edges.set_vertex(nb_kept_edges+i,0,edges_[j].first);
+            M_out.edges.set_vertex(nb_kept_edges+i,1,edges_[j].second);
+            if (edge_attribute.is_bound()) edge_attribute[nb_kept_edges+i] = edge_refs_[j];
+        }
+
+        if (opt_.output_adjacency != "none") {
+            /* the boundary triangles are few */
+            M_out.facets.connect();
+            connect_cells(M_out, cell_id, nb_frozen);
+        }
+    }
+
+    void SelectionSplicer::connect_cells(Mesh& M_out, const std::vector<index_t>& cell_id,
+                                         index_t nb_frozen) const {
+        /* The adjacency between frozen cells is the input one */
+        parallel_for_slice(0, M_.cells.nb(), [&](index_t from, index_t to) {
+            for (index_t c = from; c < to; ++c) {
+                index_t d = cell_id[c];
+                if (d == NO_CELL) continue;
+                for (index_t lf = 0; lf < 4; ++lf) {
+                    index_t adj = M_.cells.adjacent(c,lf);
+                    M_out.cells.set_adjacent(d, lf, adj == NO_CELL ? NO_CELL : cell_id[adj]);
+                }
+            }
+        });
+
+        /* The faces of the new cells are paired with each other and with
+         * the frozen faces that were against a selected cell */
+        typedef std::pair<index_t,index_t> CellFacet;
+        std::vector<std::pair<Triple,CellFacet> > faces;
+        for (index_t c : selected_cells_) {
+            for (index_t lf = 0; lf < 4; ++lf) {
+                index_t adj = M_.cells.adjacent(c,lf);
+                if (adj == NO_CELL || cell_id[adj] == NO_CELL) continue;
+                for (index_t lf2 = 0; lf2 < 4; ++lf2) {
+                    if (M_.cells.adjacent(adj,lf2) != c) continue;
+                    faces.push_back(std::make_pair(sorted_triple(
+                        vertex_id_[M_.cells.facet_vertex(adj,lf2,0)],
+                        vertex_id_[M_.cells.facet_vertex(adj,lf2,1)],
+                        vertex_id_[M_.cells.facet_vertex(adj,lf2,2)]), CellFacet(cell_id[adj], lf2)));
+                    break;
+                }
+            }
+        }
+        for (index_t d = nb_frozen; d < M_out.cells.nb(); ++d) {
+            for (index_t lf = 0; lf < 4; ++lf) {
+                M_out.cells.set_adjacent(d, lf, NO_CELL);
+                faces.push_back(std::make_pair(sorted_triple(
+                    M_out.cells.facet_vertex(d,lf,0), M_out.cells.facet_vertex(d,lf,1),
+                    M_out.cells.facet_vertex(d,lf,2)), CellFacet(d, lf)));
+            }
+        }
+        std::sort(faces.begin(), faces.end());
+        index_t i = 0;
+        while (i < faces.size()) {
+            index_t j = i + 1;
+            while (j < faces.size() && faces[j].first == faces[i].first) ++j;
+            /* a face of more than two cells is left open */
+            if (j == i + 2) {
+                const CellFacet& a = faces[i].second;
+                const CellFacet& b = faces[i+1].second;
+                M_out.cells.set_adjacent(a.first, a.second, b.first);
+                M_out.cells.set_adjacent(b.first, b.second, a.first);
+            }
+            i = j;
+        }
+    }
+
+    bool remesh_selection(const Mesh& M,
+                          const std::vector<index_t>& cell_part,
+                          index_t nb_parts,
+                          const MmgOptions& opt,
+                          Mesh& M_out) {
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING)) return false;
+        Stopwatch W("remesh_selection", false);
+        std::vector<index_t> facet_cell;
+        compute_selection_facet_cells(M, cell_part, facet_cell);
+
+        std::vector<MMG5_pMesh> meshes;
+        std::vector<MMG5_pSol> mets;
+        bool ok = remesh_each_part(M, cell_part, nb_parts, facet_cell, opt, meshes, mets);
+        double t_remesh = W.elapsed_time();
+        if (ok) {
+            SelectionSplicer splicer(M, cell_part, facet_cell, opt);
+            for (index_t p = 0; p < nb_parts; ++p) {
+                splicer.add_part(meshes[p], mets[p]);
+                mmg3d_free(meshes[p], mets[p]);
+                meshes[p] = NULL;
+            }
+            splicer.get_mesh(M_out);
+            mmg_log_out("mmg3d_local") << nb_parts << " parts: remesh " << t_remesh
+                << " s, splice " << W.elapsed_time() - t_remesh << " s, "
+                << M_out.vertices.nb() << " vertices, " << M_out.cells.nb() << " tets" << std::endl;
+        }
+        for (index_t p = 0; p < nb_parts; ++p) {
+            if (meshes[p] != NULL) mmg3d_free(meshes[p], mets[p]);
+        }
+        return ok;
+    }
+}
+
@@ -0,0 +1,276 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_SUBMESH__H
+#define H__OGF_MMGIG_MMG_SUBMESH__H
+
+/* Internal header: remeshing of a tetrahedral mesh by parts, with the faces
+ * between parts frozen, and stitching of the remeshed parts. Used by the
+ * domain decomposition (mmg_parallel.cpp) and the local remeshing
+ * (mmg_local.cpp). Not part of the plugin API. */
+
+#include <OGF/mmgig/algo/mmg_conversion.h>
+
+#include <geogram/basic/attributes.h>
+
+#include <vector>
+#include <unordered_map>
+
+namespace OGF {
+
+    /* Part of the cells that are not remeshed */
+    const index_t FROZEN_PART = index_t(-1);
+
+    /* Reference of the triangles added on the faces between two parts. They
+     * are required during remeshing and dropped by the stitching */
+    const int INTERFACE_REF = 2147483000;
+
+    /* M, or a copy of M with connected cells if M has none: the faces
+     * between parts and the facets of the cells are found through the cell
+     * adjacency */
+    const Mesh& cell_connected_input(const Mesh& M, Mesh& connected);
+
+    /* For each facet of M, one of the cells it is a face of (NO_CELL if none).
+     * M.cells must be connected */
+    void compute_facet_cells(const Mesh& M, std::vector<index_t>& facet_cell);
+
+    /* For each facet of M that is a face of a cell of a part (cell_part[c]
+     * != FROZEN_PART), that cell, NO_CELL for the other facets. Only the
+     * facets with all their vertices in the parts are looked up, the cost
+     * beyond a scan of M follows the size of the parts. M.cells must be
+     * connected */
+    void compute_selection_facet_cells(const Mesh& M, const std::vector<index_t>& cell_part,
+                                       std::vector<index_t>& facet_cell);
+
+    /* The cells of each part, the input facets they own and the input
+     * edges with both vertices in the part, by increasing index. Gathered
+     * in one pass over M, so that converting the parts is linear in the
+     * size of M instead of nb_parts times it. The elements of part p are
+     * cells[cell_begin[p]] to cells[cell_begin[p+1]-1], same for the
+     * facets and edges */
+    struct PartElements {
+        std::vector<index_t> cell_begin;
+        std::vector<index_t> cells;
+        std::vector<index_t> facet_begin;
+        std::vector<index_t> facets;
+        std::vector<index_t> edge_begin;
+        std::vector<index_t> edges;
+    };
+
+    void compute_part_elements(const Mesh& M,
+                               const std::vector<index_t>& cell_part,
+                               index_t nb_parts,
+                               const std::vector<index_t>& facet_cell,
+                               PartElements& elements);
+
+    /* Converts the cells c of M with cell_part[c] == part into mmg3d. The
+     * faces shared with other parts (or frozen cells) become required
+     * triangles, with INTERFACE_REF unless they carry an input facet.
+     * The metric (opt.metric_attribute) is restricted to the part */
+    bool submesh_to_mmg(const Mesh& M,
+                        const std::vector<index_t>& cell_part,
+                        index_t part,
+                        const std::vector<index_t>& facet_cell,
+                        const PartElements& elements,
+                        const MmgOptions& opt,
+                        MMG5_pMesh& mmg, MMG5_pSol& met);
+
+    /* Remeshes concurrently the parts 0..nb_parts-1 of M (cell_part) and
+     * stitches them with the frozen cells into M_out. out_cell_part receives
+     * the part of each output cell. M.cells must be connected, see
+     * cell_connected_input() */
+    bool remesh_parts(const Mesh& M,
+                      const std::vector<index_t>& cell_part,
+                      index_t nb_parts,
+                      const MmgOptions& opt,
+                      Mesh& M_out,
+                      std::vector<index_t>* out_cell_part = NULL);
+
+    /* remesh_parts() for parts that are a small fraction of M, see
+     * SelectionSplicer: the frozen elements are copied by index and only
+     * the adjacency around the parts is computed. M.cells must be
+     * connected */
+    bool remesh_selection(const Mesh& M,
+                          const std::vector<index_t>& cell_part,
+                          index_t nb_parts,
+                          const MmgOptions& opt,
+                          Mesh& M_out);
+
+    /* Points matched with a small tolerance through a hash grid: the
+     * vertices on the faces between parts are frozen during remeshing but
+     * mmg scales and unscales the coordinates */
+    class VertexGrid {
+    public:
+        /* The tolerance is relative to the bounding box of M */
+        explicit VertexGrid(const Mesh& M);
+
+        void insert(const double* p, index_t id);
+
+        /* The id of a point inserted within the tolerance of p, NO_VERTEX
+         * if none */
+        index_t find(const double* p) const;
+
+    private:
+        struct Key {
+            long long i, j, k;
+            bool operator==(const Key& rhs) const {
+                return i == rhs.i && j == rhs.j && k == rhs.k;
+            }
+        };
+        struct KeyHash {
+            size_t operator()(const Key& key) const {
+                return size_t(key.i * 73856093LL ^ key.j * 19349663LL ^ key.k * 83492791LL);
+            }
+        };
+        struct Entry {
+            index_t id;
+            double p[3];
+        };
+
+        Key key(const double* p) const;
+
+        double cell_size_;
+        double tolerance_;
+        std::unordered_multimap<Key, Entry, KeyHash> entries_;
+    };
+
+    /**
+     * \brief Assembles the remeshed parts and the frozen cells in one mesh.
+     * \details The vertices on the faces between parts are matched through
+     *   a VertexGrid.
+     */
+    class SubmeshStitcher {
+    public:
+        SubmeshStitcher(const Mesh& M, const MmgOptions& opt);
+
+        /* Registers the vertices on the faces between parts, the frozen cells
+         * and the input edges between interface vertices */
+        void add_frozen_and_interfaces(const std::vector<index_t>& cell_part,
+                                       const std::vector<index_t>& facet_cell);
+
+        /* Appends a remeshed part */
+        void add_part(MMG5_pMesh mmg, MMG5_pSol met, index_t part);
+
+        /* Builds the result. The frozen cells come first, in their input
+         * order. If cell_part is given, it receives the part of each output
+         * cell (FROZEN_PART for the frozen ones) */
+        void get_mesh(Mesh& M_out, std::vector<index_t>* cell_part = NULL);
+
+    private:
+        const double* input_metric(index_t v) const;
+        index_t new_vertex(const double* p, const double* metric);
+        index_t register_shared_vertex(index_t v);
+        void add_edge(index_t v1, index_t v2, int ref);
+
+        const Mesh& M_;
+        const MmgOptions& opt_;
+        index_t metric_dim_;
+        Attribute<double> input_metric_;
+        VertexGrid shared_;
+        std::vector<index_t> shared_id_; /* input vertex -> output, or NO_VERTEX */
+        std::vector<std::pair<index_t,index_t> > interface_edges_;
+
+        std::vector<double> points_;
+        std::vector<double> metric_;
+        std::vector<index_t> tets_;
+        std::vector<int> tet_refs_;
+        std::vector<index_t> tet_parts_;
+        std::vector<index_t> triangles_;
+        std::vector<int> triangle_refs_;
+        std::vector<index_t> edges_;
+        std::vector<int> edge_refs_;
+    };
+
+    /**
+     * \brief Splices remeshed parts into the frozen rest of M.
+     * \details For a selection that is a small fraction of M (local
+     *   remeshing), the frozen vertices, cells, facets and edges are copied
+     *   by index, in their input order, without going through the hash
+     *   grid: only the vertices on the faces between the parts and the
+     *   frozen cells are matched. The cell adjacency of the frozen cells is
+     *   copied from M, which must be connected, and only the faces of the
+     *   new cells and the frozen faces around them are paired. The vertices
+     *   only used by selected cells disappear.
+     */
+    class SelectionSplicer {
+    public:
+        /* facet_cell as given by compute_selection_facet_cells() */
+        SelectionSplicer(const Mesh& M, const std::vector<index_t>& cell_part,
+                         const std::vector<index_t>& facet_cell, const MmgOptions& opt);
+
+        /* Appends a remeshed part */
+        void add_part(MMG5_pMesh mmg, MMG5_pSol met);
+
+        /* Builds the result, the frozen cells first */
+        void get_mesh(Mesh& M_out);
+
+    private:
+        void connect_cells(Mesh& M_out, const std::vector<index_t>& cell_id, index_t nb_frozen) const;
+
+        const Mesh& M_;
+        const std::vector<index_t>& cell_part_;
+        const std::vector<index_t>& facet_cell_;
+        const MmgOptions& opt_;
+        index_t metric_dim_;
+        Attribute<double> input_metric_;
+        std::vector<index_t> selected_cells_;
+        std::vector<index_t> vertex_id_; /* input vertex -> output, NO_VERTEX if not kept */
+        index_t nb_kept_vertices_;
+        VertexGrid interface_;
+        /* Input edges between interface vertices (output ids), kept with
+         * the frozen edges */
+        std::vector<std::pair<index_t,index_t> > interface_edges_;
+
+        /* The elements of the parts, their vertices numbered from
+         * nb_kept_vertices_ */
+        std::vector<double> points_;
+        std::vector<double> metric_;
+        std::vector<index_t> tets_;
+        std::vector<int> tet_refs_;
+        std::vector<index_t> triangles_;
+        std::vector<int> triangle_refs_;
+        std::vector<std::pair<index_t,index_t> > edges_;
+        std::vector<int> edge_refs_;
+    };
+}
+
+#endif
+
@@ -0,0 +1,337 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_sweep.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+#include <OGF/mmgig/algo/mmg_quality.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace OGF {
+
+    namespace {
+
+        /* More combinations than this are most likely a typo in the ranges */
+        const index_t MAX_SWEEP_COMBINATIONS = 4096;
+
+        /* The fields that reach mmg3d_set_parameters() and mmgs_set_parameters(),
+         * the others are read by the conversion or the wrappers and would be
+         * the same for every combination */
+        const char* const SWEPT_KEYS[] = {
+            "angle_detection", "angle_value", "hausd", "hsiz", "hmin", "hmax", "hgrad",
+            "optim", "opnbdy", "noinsert", "noswap", "nomove", "nosurf"
+        };
+
+        bool is_swept_key(const std::string& key) {
+            for (const char* swept : SWEPT_KEYS) {
+                if (key == swept) return true;
+            }
+            return false;
+        }
+
+        struct SweptField {
+            std::string key;
+            std::vector<std::string> values;
+        };
+
+        std::string trim(const std::string& s) {
+            std::size_t b = s.find_first_not_of(" \t");
+            if (b == std::string::npos) return "";
+            std::size_t e = s.find_last_not_of(" \t");
+            return s.substr(b, e - b + 1);
+        }
+
+        std::vector<std::string> split(const std::string& s, char separator) {
+            std::vector<std::string> items;
+            std::istringstream in(s);
+            std::string item;
+            while (std::getline(in, item, separator)) {
+                item = trim(item);
+                if (!item.empty()) items.push_back(item);
+            }
+            return items;
+        }
+
+        std::string format_value(double value) {
+            std::ostringstream out;
+            out.precision(12);
+            out << value;
+            return out.str();
+        }
+
+        bool parse_double(const std::string& s, double& value) {
+            char* end = NULL;
+            value = std::strtod(s.c_str(), &end);
+            return end != s.c_str() && *end == '\0';
+        }
+
+        bool parse_ranges(const std::string& ranges, double size_scale, std::vector<SweptField>& fields) {
+            for (const std::string& range : split(ranges, ';')) {
+                std::size_t eq = range.find('=');
+                SweptField field;
+                field.key = trim(range.substr(0, eq));
+                if (eq == std::string::npos || field.key.empty()) {
+                    mmg_log_err("mmg_sweep") << "expected field=values, got " << range << std::endl;
+                    return false;
+                }
+                if (!is_swept_key(field.key)) {
+                    std::string keys;
+                    for (const char* swept : SWEPT_KEYS) keys += std::string(" ") + swept;
+                    mmg_log_err("mmg_sweep") << field.key << " cannot be swept, the fields are" << keys << std::endl;
+                    return false;
+                }
+                std::string values = trim(range.substr(eq + 1));
+                if (values.find(':') != std::string::npos) {
+                    std::vector<std::string> bounds = split(values, ':');
+                    double from = 0.;
+                    double to = 0.;
+                    double count = 0.;
+                    if (bounds.size() != 3 || !parse_double(bounds[0], from) || !parse_double(bounds[1], to)
+                        || !parse_double(bounds[2], count) || count < 1.) {
+                        mmg_log_err("mmg_sweep") << "expected from:to:count, got " << values << std::endl;
+                        return false;
+                    }
+                    index_t n = index_t(count);
+                    for (index_t i = 0; i < n; ++i) {
+                        double t = (n == 1) ? 0. : double(i) / double(n - 1);
+                        field.values.push_back(format_value(from + t * (to - from)));
+                    }
+                } else {
+                    field.values = split(values, ',');
+                }
+                if (field.values.empty()) {
+                    mmg_log_err("mmg_sweep") << "no value for " << field.key << std::endl;
+                    return false;
+                }
+                bool is_size = (field.key == "hausd" || field.key == "hsiz"
+                                || field.key == "hmin" || field.key == "hmax");
+                if (is_size && size_scale != 1.) {
+                    for (std::string& value : field.values) {
+                        double v = 0.;
+                        if (!parse_double(value, v)) {
+                            mmg_log_err("mmg_sweep") << "cannot parse " << field.key << "=" << value << std::endl;
+                            return false;
+                        }
+                        value = format_value(v * size_scale);
+                    }
+                }
+                fields.push_back(field);
+            }
+            return true;
+        }
+
+        /* a is at least as good as b on all scores, and better on one */
+        bool dominates(const MmgSweepResult& a, const MmgSweepResult& b) {
+            bool no_worse = a.nb_elements <= b.nb_elements && a.min_quality >= b.min_quality && a.time <= b.time;
+            bool better = a.nb_elements < b.nb_elements || a.min_quality > b.min_quality || a.time < b.time;
+            return no_worse && better;
+        }
+    }
+
+    std::string MmgSweepResult::to_json() const {
+        std::ostringstream out;
+        out << "{\"settings\": \"" << settings << "\""
+            << ", \"ok\": " << (ok ? "true" : "false")
+            << ", \"elements\": " << nb_elements
+            << ", \"min_quality\": " << min_quality
+            << ", \"time\": " << time
+            << ", \"pareto\": " << (pareto ? "true" : "false") << "}";
+        return out.str();
+    }
+
+    bool mmg_parameter_sweep(const Mesh& M, const std::string& ranges,
+                             const MmgOptions& opt,
+                             std::vector<MmgSweepResult>& results,
+                             double size_scale) {
+        results.clear();
+        std::vector<SweptField> fields;
+        if (!parse_ranges(ranges, size_scale, fields)) return false;
+        index_t nb_combinations = 1;
+        for (const SweptField& field : fields) {
+            nb_combinations *= index_t(field.values.size());
+            if (nb_combinations > MAX_SWEEP_COMBINATIONS) {
+                mmg_log_err("mmg_sweep") << "more than " << MAX_SWEEP_COMBINATIONS
+                    << " combinations, cancel" << std::endl;
+                return false;
+            }
+        }
+
+        /* The options of each combination, the first field varying the slowest */
+        std::vector<MmgOptions> combination_opts(nb_combinations, opt);
+        results.resize(nb_combinations);
+        for (index_t c = 0; c < nb_combinations; ++c) {
+            MmgOptions& c_opt = combination_opts[c];
+            index_t rest = c;
+            std::string settings;
+            for (index_t f = index_t(fields.size()); f-- > 0;) {
+                const SweptField& field = fields[f];
+                const std::string& value = field.values[rest % field.values.size()];
+                rest /= index_t(field.values.size());
+                if (!mmg_options_set(c_opt, field.key, value)) return false;
+                settings = field.key + "=" + value + (settings.empty() ? "" : " ") + settings;
+            }
+            c_opt.parallel_conversion = false;
+            c_opt.monitor = NULL;
+            c_opt.stats = NULL;
+            results[c].settings = settings;
+        }
+
+        bool volume = (M.cells.nb() > 0);
+        if (preflight_failed(M, volume, opt)) return false;
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION)) return false;
+        StatsRecorder clock(opt, M);
+        MMG5_pMesh mesh = NULL;
+        MMG5_pSol met = NULL;
+        auto free_mesh = [&](MMG5_pMesh m, MMG5_pSol s) {
+            if (volume) {
+                mmg3d_free(m, s);
+            } else {
+                mmgs_free(m, s);
+            }
+        };
+        bool ok = geo_to_mmg(M, mesh, met, volume, opt.enable_anisotropy, opt.edge_attribute, opt.facet_attribute,
+                             volume ? opt.cell_attribute : "no_attribute", opt.parallel_conversion, opt.bulk_conversion);
+        if (!ok) {
+            mmg_log_err("mmg_sweep") << "failed to convert mesh to MMG5_pMesh" << std::endl;
+            free_mesh(mesh, met);
+            return false;
+        }
+        clock.lap(&MmgPhaseTimes::geo_to_mmg);
+
+        /* The metric is set once, the copies inherit it */
+        bool has_metric = has_input_metric(opt);
+        if (!monitor_phase(opt, MMG_PHASE_ANALYSIS)
+            || (has_metric && !set_input_metric(M, mesh, met, volume, opt))) {
+            free_mesh(mesh, met);
+            return false;
+        }
+        clock.lap(&MmgPhaseTimes::setup);
+
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING)) {
+            free_mesh(mesh, met);
+            return false;
+        }
+        /* As in mmg3d_extract_iso_levels(), parallel_for gives a contiguous
+         * range of combinations to each thread, at most one copy of the mmg
+         * mesh per core is alive */
+        std::vector<int> status(nb_combinations, MMG5_STRONGFAILURE);
+        MmgLogBuffer* log = MmgLogScope::current();
+        parallel_for(0, nb_combinations, [&](index_t c) {
+            MmgLogScope log_scope(log);
+            if (opt.monitor != NULL && opt.monitor->cancel_requested) return;
+            const MmgOptions& c_opt = combination_opts[c];
+            MmgSweepResult& result = results[c];
+            Stopwatch W("mmg_sweep", false);
+            MMG5_pMesh c_mesh = NULL;
+            MMG5_pSol c_met = NULL;
+            if (volume && mmg3d_clone(mesh, met, c_mesh, c_met)) {
+                mmg3d_set_parameters(c_mesh, c_met, c_opt, has_metric);
+                MMG3D_Set_iparameter(c_mesh, c_met, MMG3D_IPARAM_verbose, -1);
+                status[c] = run_mmg(MMG_CALL_MMG3DLIB, c_mesh, c_met);
+            } else if (!volume && mmgs_clone(mesh, met, c_mesh, c_met)) {
+                mmgs_set_parameters(c_mesh, c_met, c_opt, has_metric);
+                MMGS_Set_iparameter(c_mesh, c_met, MMGS_IPARAM_verbose, -1);
+                status[c] = run_mmg(MMG_CALL_MMGSLIB, c_mesh, c_met);
+            }
+            if (status[c] == MMG5_SUCCESS) {
+                result.mesh = std::make_shared<Mesh>();
+                result.ok = mmg_to_geo(c_mesh, *result.mesh, c_opt.edge_attribute, c_opt.facet_attribute,
+                                       volume ? c_opt.cell_attribute : "no_attribute", false, false,
+                                       c_opt.bulk_conversion);
+                connect_output(c_mesh, *result.mesh, volume, c_opt);
+            }
+            if (c_mesh != NULL) free_mesh(c_mesh, c_met);
+            result.time = W.elapsed_time();
+            if (result.ok) {
+                std::vector<double> quality;
+                compute_element_qualities(*result.mesh, quality, false);
+                result.nb_elements = index_t(quality.size());
+                result.min_quality = quality.empty() ? 0. : *std::min_element(quality.begin(), quality.end());
+            } else {
+                result.mesh.reset();
+            }
+        });
+        clock.lap(&MmgPhaseTimes::mmg);
+        free_mesh(mesh, met);
+
+        /* The combinations skipped after a cancel did not fail */
+        if (opt.monitor != NULL && opt.monitor->cancel_requested) {
+            mmg_log_out("mmg_sweep") << "cancelled" << std::endl;
+            for (MmgSweepResult& result : results) result.mesh.reset();
+            return false;
+        }
+
+        /* Pareto front on (elements, min quality, time) */
+        std::vector<Mesh*> kept;
+        int worst = MMG5_SUCCESS;
+        for (index_t c = 0; c < nb_combinations; ++c) {
+            MmgSweepResult& result = results[c];
+            if (!result.ok) {
+                mmg_log_warn("mmg_sweep") << result.settings << " failed" << std::endl;
+                worst = (status[c] != MMG5_SUCCESS) ? status[c] : MMG5_STRONGFAILURE;
+                continue;
+            }
+            result.pareto = true;
+            for (index_t other = 0; other < nb_combinations && result.pareto; ++other) {
+                result.pareto = !(results[other].ok && dominates(results[other], result));
+            }
+        }
+        for (MmgSweepResult& result : results) {
+            if (result.pareto) {
+                kept.push_back(result.mesh.get());
+            } else {
+                result.mesh.reset();
+            }
+        }
+        clock.mmg_done(worst, NULL);
+        ok = !kept.empty() && monitor_phase(opt, MMG_PHASE_CONVERSION_BACK);
+        if (ok) clock.output(kept);
+        monitor_phase(opt, MMG_PHASE_DONE);
+        return ok;
+    }
+}
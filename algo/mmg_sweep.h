@@ -0,0 +1,98 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_SWEEP__H
+#define H__OGF_MMGIG_MMG_SWEEP__H
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace GEO {
+    class Mesh;
+}
+
+namespace OGF {
+
+    /* One combination of a parameter sweep and the score of its result */
+    struct MmgSweepResult {
+        std::string settings; /* the swept fields, e.g. "hausd=0.01 hgrad=1.3" */
+        bool ok = false;
+        index_t nb_elements = 0; /* tets (mmg3d) or triangles (mmgs) */
+        double min_quality = 0.; /* see compute_mesh_quality() */
+        double time = 0.; /* mmg call and conversion back (s) */
+        /* not dominated by another result: none has fewer elements, a
+         * better minimum quality and a lower time at once */
+        bool pareto = false;
+        std::shared_ptr<Mesh> mesh; /* kept for the Pareto results only */
+
+        /* One line JSON object, as MmgRemeshStats */
+        std::string to_json() const;
+    };
+
+    /**
+     * \brief Remeshes M with each combination of the ranges, concurrently,
+     *   and keeps the Pareto-best results.
+     * \details ranges are "field=values" separated by ';', the values of a
+     *   field being a comma separated list or "from:to:count" (evenly
+     *   spaced), e.g. "hausd=0.001,0.005; hgrad=1.1:1.5:3; optim=0,1".
+     *   The fields are the mmg parameters among the ones of
+     *   mmg_options_set() (angle_detection, angle_value, hausd, hsiz, hmin,
+     *   hmax, hgrad, optim, opnbdy, noinsert, noswap, nomove, nosurf),
+     *   applied on top of opt, other fields are rejected. Returns false
+     *   without scoring when opt.monitor cancels. M is converted once (mmg3d if it has cells, mmgs otherwise)
+     *   with the metric of opt, each combination runs on its own copy of
+     *   the mmg mesh. The fields used by the conversion and the metric
+     *   (attributes, anisotropy, curvature_size_map) are taken from opt.
+     * \param[in] size_scale multiplies the values of hausd, hsiz, hmin and
+     *   hmax in ranges, e.g. to give them relative to the bounding box
+     * \param[out] results one per combination, in the order of ranges
+     */
+    bool mmgig_API mmg_parameter_sweep(const Mesh& M, const std::string& ranges,
+                                       const MmgOptions& opt,
+                                       std::vector<MmgSweepResult>& results,
+                                       double size_scale = 1.);
+}
+
+#endif
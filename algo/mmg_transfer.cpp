@@ -0,0 +1,283 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#include <OGF/mmgig/algo/mmg_transfer.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+#include <OGF/mmgig/algo/mmg_sizemap.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+#include <geogram/mesh/mesh_AABB.h>
+#include <geogram/points/nn_search.h>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+
+namespace OGF {
+
+    namespace {
+        /* Vertices and barycentric weights of an output vertex in the
+         * input mesh, unused slots have a zero weight */
+        struct Location {
+            index_t v[4];
+            double w[4];
+        };
+
+        double tet_volume(const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3) {
+            return dot(p1 - p0, cross(p2 - p0, p3 - p0));
+        }
+
+        void tet_location(const Mesh& M, index_t t, const vec3& p, Location& loc) {
+            vec3 q[4];
+            for (index_t lv = 0; lv < 4; ++lv) {
+                loc.v[lv] = M.cells.vertex(t, lv);
+                q[lv] = vec3(M.vertices.point_ptr(loc.v[lv]));
+            }
+            double volume = tet_volume(q[0], q[1], q[2], q[3]);
+            if (volume == 0.) {
+                for (index_t lv = 0; lv < 4; ++lv) loc.w[lv] = 0.25;
+                return;
+            }
+            loc.w[0] = tet_volume(p, q[1], q[2], q[3]) / volume;
+            loc.w[1] = tet_volume(q[0], p, q[2], q[3]) / volume;
+            loc.w[2] = tet_volume(q[0], q[1], p, q[3]) / volume;
+            loc.w[3] = 1. - loc.w[0] - loc.w[1] - loc.w[2];
+        }
+
+        /* q is the point of triangle f nearest to the vertex */
+        void triangle_location(const Mesh& M, index_t f, const vec3& q, Location& loc) {
+            vec3 p[3];
+            for (index_t lv = 0; lv < 3; ++lv) {
+                loc.v[lv] = M.facets.vertex(f, lv);
+                p[lv] = vec3(M.vertices.point_ptr(loc.v[lv]));
+            }
+            loc.v[3] = loc.v[0];
+            loc.w[3] = 0.;
+            vec3 n = cross(p[1] - p[0], p[2] - p[0]);
+            double n2 = dot(n, n);
+            if (n2 == 0.) {
+                for (index_t lv = 0; lv < 3; ++lv) loc.w[lv] = 1. / 3.;
+                return;
+            }
+            double sum = 0.;
+            for (index_t lv = 0; lv < 3; ++lv) {
+                const vec3& a = p[(lv + 1) % 3];
+                const vec3& b = p[(lv + 2) % 3];
+                loc.w[lv] = std::max(0., dot(cross(b - a, q - a), n) / n2);
+                sum += loc.w[lv];
+            }
+            for (index_t lv = 0; lv < 3; ++lv) {
+                loc.w[lv] = (sum > 0.) ? loc.w[lv] / sum : 1. / 3.;
+            }
+        }
+
+        void vertex_location(index_t v, Location& loc) {
+            for (index_t lv = 0; lv < 4; ++lv) {
+                loc.v[lv] = v;
+                loc.w[lv] = (lv == 0) ? 1. : 0.;
+            }
+        }
+
+        /* Double vertex attributes of M selected by names */
+        bool selected_attributes(const Mesh& M, const std::string& names,
+                                 std::vector<std::string>& selected) {
+            selected.clear();
+            AttributesManager& attributes = const_cast<Mesh&>(M).vertices.attributes();
+            if (names == "all") {
+                GEO::vector<std::string> all;
+                attributes.list_attribute_names(all);
+                for (const std::string& name : all) {
+                    if (name == "point") continue;
+                    if (!Attribute<double>::is_defined(attributes, name)) continue;
+                    selected.push_back(name);
+                }
+                return true;
+            }
+            std::istringstream in(names);
+            std::string name;
+            while (std::getline(in, name, ',')) {
+                name.erase(0, name.find_first_not_of(" \t"));
+                name.erase(name.find_last_not_of(" \t") + 1);
+                if (name.empty()) continue;
+                if (!Attribute<double>::is_defined(attributes, name)) {
+                    mmg_log_err("mmg_transfer") << name << " is not a double vertex attribute" << std::endl;
+                    return false;
+                }
+                selected.push_back(name);
+            }
+            return true;
+        }
+    }
+
+    bool transfer_vertex_attributes(const Mesh& M_in, Mesh& M_out,
+                                    const std::string& names, bool parallel) {
+        if (names == "no_attribute") return true;
+        std::vector<std::string> selected;
+        if (!selected_attributes(M_in, names, selected)) return false;
+        if (selected.empty()) return true;
+        Stopwatch W("mmg_transfer", false);
+
+        bool in_tets = (M_in.cells.nb() > 0 && M_in.cells.are_simplices());
+        bool in_triangles = (M_in.facets.nb() > 0 && M_in.facets.are_simplices());
+        if (!in_tets && !in_triangles && M_in.vertices.nb() == 0) {
+            mmg_log_err("mmg_transfer") << "input mesh has no element to interpolate on" << std::endl;
+            return false;
+        }
+
+        /* The trees are built without reordering, M_in is not modified */
+        Mesh& M_ref = const_cast<Mesh&>(M_in);
+        std::unique_ptr<MeshCellsAABB> cells_aabb;
+        std::unique_ptr<MeshFacetsAABB> facets_aabb;
+        NearestNeighborSearch_var nn;
+        if (in_tets) cells_aabb.reset(new MeshCellsAABB(M_ref, false));
+        if (in_triangles) {
+            facets_aabb.reset(new MeshFacetsAABB(M_ref, false));
+        } else {
+            nn = NearestNeighborSearch::create(3);
+            nn->set_points(M_in.vertices.nb(), M_in.vertices.point_ptr(0));
+        }
+
+        index_t nv = M_out.vertices.nb();
+        std::vector<Location> locations(nv);
+        for_each_slice(nv, parallel, [&](index_t from, index_t to) {
+            for (index_t v = from; v < to; ++v) {
+                vec3 p(M_out.vertices.point_ptr(v));
+                Location& loc = locations[v];
+                if (in_tets) {
+                    index_t t = cells_aabb->containing_tet(p);
+                    if (t != MeshCellsAABB::NO_TET) {
+                        tet_location(M_in, t, p, loc);
+                        continue;
+                    }
+                }
+                if (in_triangles) {
+                    vec3 q;
+                    double sq_dist;
+                    index_t f = facets_aabb->nearest_facet(p, q, sq_dist);
+                    triangle_location(M_in, f, q, loc);
+                } else {
+                    vertex_location(nn->get_nearest_neighbor(p.data()), loc);
+                }
+            }
+        });
+
+        for (const std::string& name : selected) {
+            Attribute<double> src;
+            src.bind_if_is_defined(M_ref.vertices.attributes(), name);
+            index_t dim = src.dimension();
+            if (M_out.vertices.attributes().is_defined(name)) {
+                M_out.vertices.attributes().delete_attribute_store(name);
+            }
+            Attribute<double> dst;
+            if (dim > 1) {
+                dst.create_vector_attribute(M_out.vertices.attributes(), name, dim);
+            } else {
+                dst.bind(M_out.vertices.attributes(), name);
+            }
+            if (nv == 0) continue;
+            const double* in = &src[0];
+            double* out = &dst[0];
+            for_each_slice(nv, parallel, [&](index_t from, index_t to) {
+                for (index_t v = from; v < to; ++v) {
+                    const Location& loc = locations[v];
+                    for (index_t d = 0; d < dim; ++d) {
+                        double value = 0.;
+                        for (index_t lv = 0; lv < 4; ++lv) {
+                            value += loc.w[lv] * in[dim * loc.v[lv] + d];
+                        }
+                        out[dim * v + d] = value;
+                    }
+                }
+            });
+        }
+        mmg_log_out("mmg_transfer") << selected.size() << " attribute(s) on " << nv
+            << " vertices in " << W.elapsed_time() << " s" << std::endl;
+        return true;
+    }
+
+    bool adapt_to_field(const Mesh& M, Mesh& M_out, const std::string& field,
+                        double error, index_t nb_iterations, const MmgOptions& opt) {
+        if (!Attribute<double>::is_defined(const_cast<Mesh&>(M).vertices.attributes(), field, 1)) {
+            mmg_log_err("mmg_adapt") << field << " is not a scalar double vertex attribute" << std::endl;
+            return false;
+        }
+        bool volume_mesh = (M.cells.nb() > 0);
+        const std::string metric_name = "mmgig_hessian_metric";
+
+        /* field and the requested attributes always come from M */
+        std::string transferred = field;
+        if (opt.transfer_attributes == "all") {
+            transferred = "all";
+        } else if (opt.transfer_attributes != "no_attribute") {
+            transferred += "," + opt.transfer_attributes;
+        }
+
+        MmgOptions pass_opt = opt;
+        pass_opt.metric_attribute = metric_name;
+        pass_opt.curvature_size_map = false;
+        pass_opt.transfer_attributes = "no_attribute";
+
+        Mesh current;
+        current.copy(M);
+        for (index_t it = 0; it < nb_iterations; ++it) {
+            if (!store_hessian_size_map(current, field, error, opt, metric_name)) return false;
+            Mesh next;
+            bool ok = volume_mesh ? mmg3d_tet_remesh(current, next, pass_opt)
+                                  : mmgs_tri_remesh(current, next, pass_opt);
+            if (!ok) {
+                mmg_log_err("mmg_adapt") << "remeshing failed at pass " << it + 1 << std::endl;
+                return false;
+            }
+            if (!transfer_vertex_attributes(M, next, transferred, opt.parallel_conversion)) return false;
+            mmg_log_out("mmg_adapt") << "pass " << it + 1 << "/" << nb_iterations << ": "
+                << current.vertices.nb() << " -> " << next.vertices.nb() << " vertices" << std::endl;
+            current.copy(next);
+        }
+        if (current.vertices.attributes().is_defined(metric_name)) {
+            current.vertices.attributes().delete_attribute_store(metric_name);
+        }
+        M_out.copy(current);
+        return true;
+    }
+}
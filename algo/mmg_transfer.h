@@ -0,0 +1,88 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+#ifndef H__OGF_MMGIG_MMG_TRANSFER__H
+#define H__OGF_MMGIG_MMG_TRANSFER__H
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+
+#include <string>
+
+namespace GEO {
+    class Mesh;
+}
+
+namespace OGF {
+
+    /**
+     * \brief Interpolates vertex attributes of M_in at the vertices of M_out.
+     * \details Each vertex of M_out is located in the tets of M_in (AABB
+     *   tree) and the attributes are interpolated with its barycentric
+     *   coordinates. Vertices outside the tets, and all vertices if M_in is a
+     *   surface, are projected on the nearest triangle of M_in (or take the
+     *   values of the nearest vertex if M_in has no triangles). The
+     *   locations are computed once for all the attributes, in parallel.
+     * \param[in] names comma separated list of double vertex attributes (of
+     *   any dimension), or "all" for every double vertex attribute but the
+     *   geometry
+     * \return false if a named attribute is missing or M_in has no simplex
+     */
+    bool mmgig_API transfer_vertex_attributes(const Mesh& M_in, Mesh& M_out,
+                                              const std::string& names,
+                                              bool parallel = true);
+
+    /**
+     * \brief Solution-adaptive remeshing loop.
+     * \details Each of the nb_iterations passes computes a metric from the
+     *   Hessian of the scalar vertex attribute field on the current mesh
+     *   (see compute_hessian_size_map()), remeshes with mmg3d (tet meshes)
+     *   or mmgs (surfaces), and interpolates field and
+     *   opt.transfer_attributes on the new mesh. The values always come from
+     *   M, so the interpolation errors of the passes do not add up.
+     * \param[in] error target interpolation error of field, in its units
+     */
+    bool mmgig_API adapt_to_field(const Mesh& M, Mesh& M_out,
+                                  const std::string& field, double error,
+                                  index_t nb_iterations, const MmgOptions& opt);
+}
+
+#endif
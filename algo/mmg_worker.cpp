@@ -0,0 +1,571 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+/*
+ * Crash isolation of the wrappers (MmgOptions::isolate): the wrapper runs
+ * in a forked worker, which sees the input through the copy-on-write pages
+ * of the fork, and writes its result to a memfd that the caller maps once
+ * the worker has exited. The monitor and the statistics live in an
+ * anonymous shared mapping, so that the progress bar follows the worker.
+ */
+
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#ifdef __linux__
+#include <fstream>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace OGF {
+
+#ifdef __linux__
+
+    namespace {
+
+        const uint64_t WORKER_MAGIC = 0x31304b524f57474dULL; /* "MGWORK01" */
+
+        /* Exit codes of the worker */
+        const int WORKER_FAILED = 1;
+        const int WORKER_OUT_OF_MEMORY = 2;
+
+        /* Placed in a MAP_SHARED mapping before the fork */
+        struct WorkerShared {
+            MmgMonitor monitor;
+            MmgRemeshStats stats;
+        };
+
+        class FdWriter {
+        public:
+            explicit FdWriter(int fd) : fd_(fd), ok_(true) {
+            }
+
+            void write(const void* data, size_t size) {
+                const char* p = static_cast<const char*>(data);
+                while (ok_ && size > 0) {
+                    ssize_t n = ::write(fd_, p, size);
+                    if (n <= 0) {
+                        ok_ = false;
+                        return;
+                    }
+                    p += n;
+                    size -= size_t(n);
+                }
+            }
+
+            template <class T> void value(const T& v) {
+                write(&v, sizeof(T));
+            }
+
+            void string(const std::string& s) {
+                value(uint64_t(s.size()));
+                write(s.data(), s.size());
+            }
+
+            bool ok() const {
+                return ok_;
+            }
+
+        private:
+            int fd_;
+            bool ok_;
+        };
+
+        class MappedReader {
+        public:
+            MappedReader(const char* data, size_t size) : data_(data), size_(size), pos_(0), ok_(true) {
+            }
+
+            void read(void* data, size_t size) {
+                if (!ok_ || size > size_ - pos_) {
+                    ok_ = false;
+                    return;
+                }
+                std::memcpy(data, data_ + pos_, size);
+                pos_ += size;
+            }
+
+            template <class T> T value() {
+                T v = T();
+                read(&v, sizeof(T));
+                return v;
+            }
+
+            std::string string() {
+                uint64_t size = value<uint64_t>();
+                if (!ok_ || size > size_ - pos_) {
+                    ok_ = false;
+                    return "";
+                }
+                std::string s(data_ + pos_, size_t(size));
+                pos_ += size_t(size);
+                return s;
+            }
+
+            bool ok() const {
+                return ok_;
+            }
+
+        private:
+            const char* data_;
+            size_t size_;
+            size_t pos_;
+            bool ok_;
+        };
+
+        enum {
+            ATTRIBUTE_DOUBLE = 0,
+            ATTRIBUTE_INT = 1,
+            ATTRIBUTE_INDEX = 2,
+            ATTRIBUTE_CHAR = 3,
+            ATTRIBUTE_BOOL = 4,
+            ATTRIBUTE_OTHER = 5
+        };
+
+        int attribute_kind(AttributesManager& attributes, const std::string& name) {
+            if (Attribute<double>::is_defined(attributes, name)) return ATTRIBUTE_DOUBLE;
+            if (Attribute<int>::is_defined(attributes, name)) return ATTRIBUTE_INT;
+            if (Attribute<index_t>::is_defined(attributes, name)) return ATTRIBUTE_INDEX;
+            if (Attribute<char>::is_defined(attributes, name)) return ATTRIBUTE_CHAR;
+            if (Attribute<bool>::is_defined(attributes, name)) return ATTRIBUTE_BOOL;
+            return ATTRIBUTE_OTHER;
+        }
+
+        template <class T> void write_attribute(FdWriter& out, AttributesManager& attributes,
+                                                const std::string& name, index_t dim, index_t nb) {
+            Attribute<T> a(attributes, name);
+            out.write(&a[0], sizeof(T) * dim * nb);
+        }
+
+        /* Attribute<bool> has no contiguous storage of bools, one byte each */
+        void write_bool_attribute(FdWriter& out, AttributesManager& attributes,
+                                  const std::string& name, index_t dim, index_t nb) {
+            Attribute<bool> a(attributes, name);
+            std::vector<uint8_t> bytes(size_t(dim) * nb);
+            for (index_t i = 0; i < dim * nb; ++i) bytes[i] = a[i] ? 1 : 0;
+            out.write(bytes.data(), bytes.size());
+        }
+
+        /* The double, int, index_t, char and bool attributes of one kind of
+         * elements, the other types (vec3, ...) are not transferred */
+        void write_attributes(FdWriter& out, const AttributesManager& manager, index_t nb) {
+            AttributesManager& attributes = const_cast<AttributesManager&>(manager);
+            GEO::vector<std::string> names;
+            manager.list_attribute_names(names);
+            std::vector<std::string> kept;
+            for (const std::string& name : names) {
+                if (name == "point") continue;
+                if (attribute_kind(attributes, name) != ATTRIBUTE_OTHER) {
+                    kept.push_back(name);
+                }
+            }
+            out.value(uint64_t(kept.size()));
+            for (const std::string& name : kept) {
+                int kind = attribute_kind(attributes, name);
+                index_t dim = manager.find_attribute_store(name)->dimension();
+                out.value(uint32_t(kind));
+                out.string(name);
+                out.value(uint32_t(dim));
+                if (nb == 0) continue;
+                switch (kind) {
+                case ATTRIBUTE_DOUBLE: write_attribute<double>(out, attributes, name, dim, nb); break;
+                case ATTRIBUTE_INT: write_attribute<int>(out, attributes, name, dim, nb); break;
+                case ATTRIBUTE_INDEX: write_attribute<index_t>(out, attributes, name, dim, nb); break;
+                case ATTRIBUTE_CHAR: write_attribute<char>(out, attributes, name, dim, nb); break;
+                default: write_bool_attribute(out, attributes, name, dim, nb); break;
+                }
+            }
+        }
+
+        template <class T> void read_attribute(MappedReader& in, AttributesManager& manager,
+                                               const std::string& name, index_t dim, index_t nb) {
+            Attribute<T> a;
+            if (manager.is_defined(name)) manager.delete_attribute_store(name);
+            a.create_vector_attribute(manager, name, dim);
+            if (nb > 0) in.read(&a[0], sizeof(T) * dim * nb);
+        }
+
+        void read_bool_attribute(MappedReader& in, AttributesManager& manager,
+                                 const std::string& name, index_t dim, index_t nb) {
+            Attribute<bool> a;
+            if (manager.is_defined(name)) manager.delete_attribute_store(name);
+            a.create_vector_attribute(manager, name, dim);
+            std::vector<uint8_t> bytes(size_t(dim) * nb);
+            if (nb > 0) in.read(bytes.data(), bytes.size());
+            for (index_t i = 0; i < dim * nb && in.ok(); ++i) a[i] = (bytes[i] != 0);
+        }
+
+        bool read_attributes(MappedReader& in, AttributesManager& manager, index_t nb) {
+            uint64_t nb_attributes = in.value<uint64_t>();
+            for (uint64_t i = 0; i < nb_attributes && in.ok(); ++i) {
+                uint32_t kind = in.value<uint32_t>();
+                std::string name = in.string();
+                index_t dim = index_t(in.value<uint32_t>());
+                if (!in.ok() || dim == 0) return false;
+                switch (kind) {
+                case ATTRIBUTE_DOUBLE: read_attribute<double>(in, manager, name, dim, nb); break;
+                case ATTRIBUTE_INT: read_attribute<int>(in, manager, name, dim, nb); break;
+                case ATTRIBUTE_INDEX: read_attribute<index_t>(in, manager, name, dim, nb); break;
+                case ATTRIBUTE_CHAR: read_attribute<char>(in, manager, name, dim, nb); break;
+                case ATTRIBUTE_BOOL: read_bool_attribute(in, manager, name, dim, nb); break;
+                default: return false;
+                }
+            }
+            return in.ok();
+        }
+
+        /* The messages of the worker, written to their own memfd */
+        bool write_log(int fd, const std::vector<MmgLogMessage>& messages) {
+            FdWriter out(fd);
+            out.value(uint64_t(messages.size()));
+            for (const MmgLogMessage& message : messages) {
+                out.value(uint32_t(message.level));
+                out.string(message.tag);
+                out.string(message.text);
+            }
+            return out.ok();
+        }
+
+        /* Logs the messages of the worker in the caller, through its
+         * MmgLogScope if any */
+        void replay_log(int fd) {
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0) return;
+            void* data = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) return;
+            MappedReader in(static_cast<const char*>(data), size_t(st.st_size));
+            uint64_t nb_messages = in.value<uint64_t>();
+            for (uint64_t i = 0; i < nb_messages && in.ok(); ++i) {
+                uint32_t level = in.value<uint32_t>();
+                std::string tag = in.string();
+                std::string text = in.string();
+                if (!in.ok()) break;
+                if (level == uint32_t(MmgLogMessage::OUT)) {
+                    mmg_log_out(tag) << text << std::endl;
+                } else if (level == uint32_t(MmgLogMessage::WARN)) {
+                    mmg_log_warn(tag) << text << std::endl;
+                } else {
+                    mmg_log_err(tag) << text << std::endl;
+                }
+            }
+            munmap(data, size_t(st.st_size));
+        }
+
+        bool write_mesh(int fd, const Mesh& M) {
+            FdWriter out(fd);
+            out.value(WORKER_MAGIC);
+            index_t nv = M.vertices.nb();
+            out.value(uint64_t(nv));
+            for (index_t v = 0; v < nv; ++v) {
+                out.write(M.vertices.point_ptr(v), 3 * sizeof(double));
+            }
+            out.value(uint64_t(M.edges.nb()));
+            for (index_t e = 0; e < M.edges.nb(); ++e) {
+                index_t edge[2] = { M.edges.vertex(e, 0), M.edges.vertex(e, 1) };
+                out.write(edge, sizeof(edge));
+            }
+            out.value(uint64_t(M.facets.nb()));
+            out.value(uint64_t(M.facet_corners.nb()));
+            for (index_t f = 0; f < M.facets.nb(); ++f) {
+                out.value(uint32_t(M.facets.nb_vertices(f)));
+            }
+            if (M.facet_corners.nb() > 0) {
+                out.write(M.facet_corners.vertex_index_ptr(0), sizeof(index_t) * M.facet_corners.nb());
+            }
+            out.value(uint64_t(M.cells.nb()));
+            out.value(uint64_t(M.cell_corners.nb()));
+            for (index_t c = 0; c < M.cells.nb(); ++c) {
+                out.value(uint32_t(M.cells.type(c)));
+            }
+            if (M.cell_corners.nb() > 0) {
+                out.write(M.cell_corners.vertex_index_ptr(0), sizeof(index_t) * M.cell_corners.nb());
+            }
+            write_attributes(out, M.vertices.attributes(), nv);
+            write_attributes(out, M.edges.attributes(), M.edges.nb());
+            write_attributes(out, M.facets.attributes(), M.facets.nb());
+            write_attributes(out, M.cells.attributes(), M.cells.nb());
+            return out.ok();
+        }
+
+        bool read_mesh(const char* data, size_t size, Mesh& M) {
+            MappedReader in(data, size);
+            M.clear();
+            if (in.value<uint64_t>() != WORKER_MAGIC) return false;
+            index_t nv = index_t(in.value<uint64_t>());
+            if (!in.ok()) return false;
+            M.vertices.create_vertices(nv);
+            if (nv > 0) in.read(M.vertices.point_ptr(0), 3 * sizeof(double) * nv);
+
+            index_t ne = index_t(in.value<uint64_t>());
+            if (!in.ok()) return false;
+            M.edges.create_edges(ne);
+            for (index_t e = 0; e < ne && in.ok(); ++e) {
+                index_t edge[2];
+                in.read(edge, sizeof(edge));
+                M.edges.set_vertex(e, 0, edge[0]);
+                M.edges.set_vertex(e, 1, edge[1]);
+            }
+
+            index_t nf = index_t(in.value<uint64_t>());
+            index_t nb_facet_corners = index_t(in.value<uint64_t>());
+            std::vector<uint32_t> facet_sizes(in.ok() ? nf : 0);
+            if (nf > 0) in.read(facet_sizes.data(), sizeof(uint32_t) * nf);
+            std::vector<index_t> facet_corners(in.ok() ? nb_facet_corners : 0);
+            if (nb_facet_corners > 0) in.read(facet_corners.data(), sizeof(index_t) * nb_facet_corners);
+            if (!in.ok()) return false;
+            index_t corner = 0;
+            for (index_t f = 0; f < nf; ++f) {
+                index_t n = index_t(facet_sizes[f]);
+                if (corner + n > nb_facet_corners) return false;
+                index_t new_f = M.facets.create_polygon(n);
+                for (index_t lv = 0; lv < n; ++lv) {
+                    M.facets.set_vertex(new_f, lv, facet_corners[corner++]);
+                }
+            }
+
+            index_t nc = index_t(in.value<uint64_t>());
+            index_t nb_cell_corners = index_t(in.value<uint64_t>());
+            std::vector<uint32_t> cell_types(in.ok() ? nc : 0);
+            if (nc > 0) in.read(cell_types.data(), sizeof(uint32_t) * nc);
+            if (!in.ok()) return false;
+            bool all_tets = (nb_cell_corners == 4 * nc);
+            for (index_t c = 0; c < nc && all_tets; ++c) {
+                all_tets = (cell_types[c] == uint32_t(MESH_TET));
+            }
+            if (all_tets) {
+                /* the usual case, read in place */
+                M.cells.create_tets(nc);
+                if (nc > 0) in.read(M.cell_corners.vertex_index_ptr(0), sizeof(index_t) * nb_cell_corners);
+            } else {
+                std::vector<index_t> cell_corners(nb_cell_corners);
+                if (nb_cell_corners > 0) in.read(cell_corners.data(), sizeof(index_t) * nb_cell_corners);
+                corner = 0;
+                for (index_t c = 0; c < nc && in.ok(); ++c) {
+                    if (cell_types[c] >= uint32_t(MESH_NB_CELL_TYPES)) return false;
+                    index_t new_c = M.cells.create_cells(1, MeshCellType(cell_types[c]));
+                    index_t n = M.cells.nb_vertices(new_c);
+                    if (corner + n > nb_cell_corners) return false;
+                    for (index_t lv = 0; lv < n; ++lv) {
+                        M.cells.set_vertex(new_c, lv, cell_corners[corner++]);
+                    }
+                }
+            }
+            return in.ok()
+                && read_attributes(in, M.vertices.attributes(), nv)
+                && read_attributes(in, M.edges.attributes(), ne)
+                && read_attributes(in, M.facets.attributes(), nf)
+                && read_attributes(in, M.cells.attributes(), nc);
+        }
+
+        /* Address space of this process, the memory limit of the worker is
+         * added to it since the fork starts with the mappings of the caller */
+        size_t current_address_space() {
+            std::ifstream statm("/proc/self/statm");
+            size_t pages = 0;
+            statm >> pages;
+            return pages * size_t(sysconf(_SC_PAGESIZE));
+        }
+
+        void run_worker(const Mesh& M, const MmgOptions& opt, MmgWrapper wrapper,
+                        WorkerShared* shared, int fd, int log_fd) {
+            /* The threads of the caller are gone, the calls they were
+             * running never release the guard in this process. The log
+             * buffer of the caller, if any, is a copy nobody reads */
+            reset_mmg_call_guard();
+            MmgLogBuffer log;
+            std::unique_ptr<MmgLogScope> log_scope(new MmgLogScope(&log));
+            int code = WORKER_FAILED;
+            try {
+                if (opt.worker_memory_limit > 0.) {
+                    struct rlimit limit;
+                    limit.rlim_cur = rlim_t(current_address_space() + size_t(opt.worker_memory_limit * 1e9));
+                    limit.rlim_max = limit.rlim_cur;
+                    setrlimit(RLIMIT_AS, &limit);
+                }
+                MmgOptions worker_opt = opt;
+                worker_opt.isolate = false;
+                worker_opt.preflight = false;
+                worker_opt.monitor = &shared->monitor;
+                worker_opt.stats = &shared->stats;
+                Mesh M_out;
+                if (wrapper(M, M_out, worker_opt) && write_mesh(fd, M_out)) {
+                    code = 0;
+                }
+            } catch (const std::bad_alloc&) {
+                code = WORKER_OUT_OF_MEMORY;
+            } catch (...) {
+                code = WORKER_FAILED;
+            }
+            log_scope.reset();
+            std::vector<MmgLogMessage> messages;
+            log.take(messages);
+            write_log(log_fd, messages);
+            /* no destructor nor atexit handler of the caller may run here */
+            _exit(code);
+        }
+    }
+
+    bool run_in_worker(const Mesh& M, Mesh& M_out, const MmgOptions& opt,
+                       MmgWrapper wrapper, const char* name) {
+        int fd = memfd_create("mmgig_worker", MFD_CLOEXEC);
+        int log_fd = (fd < 0) ? -1 : memfd_create("mmgig_worker_log", MFD_CLOEXEC);
+        if (log_fd < 0) {
+            mmg_log_err(name) << "memfd_create failed, cannot isolate the call" << std::endl;
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        void* mapping = mmap(NULL, sizeof(WorkerShared), PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            mmg_log_err(name) << "mmap failed, cannot isolate the call" << std::endl;
+            close(fd);
+            close(log_fd);
+            return false;
+        }
+        WorkerShared* shared = new (mapping) WorkerShared();
+        if (opt.monitor != NULL) shared->monitor.phase = int(opt.monitor->phase);
+
+        Stopwatch W("mmg_worker", false);
+        pid_t pid = fork();
+        if (pid == 0) {
+            run_worker(M, opt, wrapper, shared, fd, log_fd);
+        }
+        bool ok = (pid > 0);
+        if (!ok) {
+            mmg_log_err(name) << "fork failed, cannot isolate the call" << std::endl;
+        }
+        int status = 0;
+        bool killed = false;
+        while (ok) {
+            pid_t r = waitpid(pid, &status, WNOHANG);
+            if (r == pid) break;
+            if (r < 0) {
+                ok = false;
+                break;
+            }
+            if (opt.monitor != NULL) {
+                opt.monitor->phase = int(shared->monitor.phase);
+                if (opt.monitor->cancel_requested) {
+                    /* unlike an in-process call, mmg can be stopped */
+                    mmg_log_warn(name) << "cancelled, worker stopped" << std::endl;
+                    killed = true;
+                }
+            }
+            if (opt.worker_timeout > 0. && W.elapsed_time() > opt.worker_timeout) {
+                mmg_log_err(name) << "no result after " << opt.worker_timeout << " s, worker stopped" << std::endl;
+                killed = true;
+            }
+            if (killed) {
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                ok = false;
+                break;
+            }
+            Process::sleep(10000);
+        }
+
+        /* Empty if the worker was killed or crashed */
+        replay_log(log_fd);
+        if (ok && WIFSIGNALED(status)) {
+            mmg_log_err(name) << "worker killed by signal " << WTERMSIG(status)
+                << " (crash or memory limit)" << std::endl;
+            ok = false;
+        } else if (ok && WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+            mmg_log_err(name) << (WEXITSTATUS(status) == WORKER_OUT_OF_MEMORY
+                                  ? "worker out of memory" : "worker failed") << std::endl;
+            ok = false;
+        }
+        if (ok) {
+            struct stat st;
+            ok = (fstat(fd, &st) == 0 && st.st_size > 0);
+            void* data = ok ? mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+            ok = ok && data != MAP_FAILED;
+            if (ok) {
+                ok = read_mesh(static_cast<const char*>(data), size_t(st.st_size), M_out);
+                munmap(data, size_t(st.st_size));
+            }
+            if (!ok) {
+                mmg_log_err(name) << "cannot read the result of the worker" << std::endl;
+                M_out.clear();
+            } else if (opt.output_adjacency != "none") {
+                M_out.facets.connect();
+                M_out.cells.connect();
+            }
+        }
+        if (opt.stats != NULL) *opt.stats = shared->stats;
+        shared->~WorkerShared();
+        munmap(mapping, sizeof(WorkerShared));
+        close(fd);
+        close(log_fd);
+        monitor_phase(opt, MMG_PHASE_DONE);
+        return ok;
+    }
+
+#else
+
+    bool run_in_worker(const Mesh& M, Mesh& M_out, const MmgOptions& opt,
+                       MmgWrapper wrapper, const char* name) {
+        geo_argused(M);
+        geo_argused(M_out);
+        geo_argused(opt);
+        geo_argused(wrapper);
+        mmg_log_err(name) << "isolated workers need Linux (fork, memfd)" << std::endl;
+        return false;
+    }
+
+#endif
+}
@@ -40,24 +40,97 @@
  
 
 #include <OGF/mmgig/algo/mmg_wrapper.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+#include <OGF/mmgig/algo/mmg_sizemap.h>
+#include <OGF/mmgig/algo/mmg_transfer.h>
+#include <OGF/mmgig/algo/mmg_quality.h>
+#include <OGF/mmgig/algo/mmg_preflight.h>
 
 #include <geogram/basic/logger.h>
 #include <geogram/basic/attributes.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
 #include <geogram/mesh/mesh.h>
+#include <geogram/mesh/mesh_reorder.h>
 
-extern "C" {
-#include "mmg/libmmg.h"
-}
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <new>
 
 namespace OGF {
     using namespace GEO;
 
+    void for_each_slice(index_t n, bool parallel,
+                        std::function<void(index_t, index_t)> func) {
+        if (parallel && n >= PARALLEL_CONVERSION_MIN_SIZE) {
+            parallel_for_slice(0, n, func);
+        } else if (n > 0) {
+            func(0, n);
+        }
+    }
+
+    namespace {
+        std::mutex mmg_call_mutex;
+        std::condition_variable mmg_call_done;
+        int mmg_call_kind = -1; /* of the running calls */
+        index_t nb_mmg_calls = 0;
+
+        /* Without values (met->np == 0) mmg computes a scalar metric */
+        int call_kind(MmgCall call, const MMG5_pSol met) {
+            bool tensor = (met != NULL && met->np != 0 && met->size > 1);
+            return 2 * int(call) + (tensor ? 1 : 0);
+        }
+    }
+
+    MmgCallGuard::MmgCallGuard(MmgCall call, const MMG5_pSol met) {
+        int kind = call_kind(call, met);
+        std::unique_lock<std::mutex> lock(mmg_call_mutex);
+        mmg_call_done.wait(lock, [&]() { return nb_mmg_calls == 0 || mmg_call_kind == kind; });
+        mmg_call_kind = kind;
+        ++nb_mmg_calls;
+    }
+
+    MmgCallGuard::~MmgCallGuard() {
+        std::lock_guard<std::mutex> lock(mmg_call_mutex);
+        if (--nb_mmg_calls == 0) {
+            mmg_call_done.notify_all();
+        }
+    }
+
+    void reset_mmg_call_guard() {
+        /* the mutex may have been held by a thread that does not exist in
+         * this process, it is constructed again rather than unlocked */
+        new (&mmg_call_mutex) std::mutex();
+        new (&mmg_call_done) std::condition_variable();
+        mmg_call_kind = -1;
+        nb_mmg_calls = 0;
+    }
+
+    int run_mmg(MmgCall call, MMG5_pMesh mesh, MMG5_pSol met, MMG5_pSol disp) {
+        MmgCallGuard guard(call, met);
+        switch (call) {
+        case MMG_CALL_MMG3DLIB:
+            return MMG3D_mmg3dlib(mesh, met);
+        case MMG_CALL_MMG3DLS:
+            return MMG3D_mmg3dls(mesh, met);
+        case MMG_CALL_MMG3DMOV:
+            return MMG3D_mmg3dmov(mesh, met, disp);
+        case MMG_CALL_MMGSLIB:
+            return MMGS_mmgslib(mesh, met);
+        }
+        return MMG5_STRONGFAILURE;
+    }
+
     bool mmg_to_geo(const MMG5_pMesh mmg,
                      Mesh& M,
-                     const std::string & edge_attribute_name = "no_attribute",
-                     const std::string & facet_attribute_name = "no_attribute",
-                     const std::string & cell_attribute_name = "no_attribute") {
-        printf("converting MMG5_pMesh to GEO::Mesh .. \n");
+                     const std::string & edge_attribute_name,
+                     const std::string & facet_attribute_name,
+                     const std::string & cell_attribute_name,
+                     bool parallel,
+                     bool connect,
+                     bool bulk) {
+        Stopwatch W("mmg_to_geo", false);
         /* Notes:
          * - indexing seems to start at 1 in MMG */
 
@@ -67,79 +140,433 @@ namespace OGF {
         M.edges.create_edges((uint) mmg->na);
         M.facets.create_triangles((uint) mmg->nt);
         M.cells.create_tets((uint) mmg->ne);
+        /* the quads and prisms go after the triangles and tets, which keeps
+         * the corners of the latter contiguous for the bulk path */
+        if (mmg->nquad > 0) M.facets.create_quads((uint) mmg->nquad);
+        if (mmg->nprism > 0) M.cells.create_prisms((uint) mmg->nprism);
+        index_t nt = (index_t) mmg->nt;
+        index_t ne = (index_t) mmg->ne;
 
-        for (uint v = 0; v < M.vertices.nb(); ++v) {
-            for (uint d = 0; d < (uint) mmg->dim; ++d) {
-                M.vertices.point_ptr(v)[d] = mmg->point[v+1].c[d];
+        /* Attributes are bound before the loops, so that the threads only
+         * access their storage */
+        Attribute< int > edge_attribute;
+        Attribute< int > facet_attribute;
+        Attribute< int > cell_attribute;
+        if(edge_attribute_name != "no_attribute") {
+            edge_attribute.bind(M.edges.attributes(), edge_attribute_name);
+        }
+        if(facet_attribute_name != "no_attribute") {
+            facet_attribute.bind(M.facets.attributes(), facet_attribute_name);
+        }
+        if(cell_attribute_name != "no_attribute") {
+            cell_attribute.bind(M.cells.attributes(), cell_attribute_name);
+        }
+
+        if (bulk && !M.vertices.single_precision()) {
+            for_each_slice(M.vertices.nb(), parallel, [&](index_t from, index_t to) {
+                double* xyz = M.vertices.point_ptr(0);
+                const MMG5_Point* P = &mmg->point[1];
+                for (index_t v = from; v < to; ++v) {
+                    xyz[3*v]   = P[v].c[0];
+                    xyz[3*v+1] = P[v].c[1];
+                    xyz[3*v+2] = P[v].c[2];
+                }
+            });
+        } else {
+            for_each_slice(M.vertices.nb(), parallel, [&](index_t from, index_t to) {
+                for (uint v = from; v < to; ++v) {
+                    double* p = M.vertices.point_ptr(v);
+                    for (uint d = 0; d < (uint) mmg->dim; ++d) {
+                        p[d] = mmg->point[v+1].c[d];
+                    }
+                }
+            });
+        }
+        for_each_slice(M.edges.nb(), parallel, [&](index_t from, index_t to) {
+            for (uint e = from; e < to; ++e) {
+                M.edges.set_vertex(e,0,(uint) mmg->edge[e+1].a - 1);
+                M.edges.set_vertex(e,1,(uint) mmg->edge[e+1].b - 1);
+                if (edge_attribute.is_bound()) {
+                    edge_attribute[e] = mmg->edge[e+1].ref;
+                }
             }
+        });
+        if (bulk) {
+            /* triangles and tets were just created, their corners are
+             * contiguous: 3 per facet, 4 per cell */
+            for_each_slice(nt, parallel, [&](index_t from, index_t to) {
+                index_t* corners = M.facet_corners.vertex_index_ptr(0);
+                const MMG5_Tria* T = &mmg->tria[1];
+                for (index_t t = from; t < to; ++t) {
+                    corners[3*t]   = index_t(T[t].v[0] - 1);
+                    corners[3*t+1] = index_t(T[t].v[1] - 1);
+                    corners[3*t+2] = index_t(T[t].v[2] - 1);
+                }
+                if (facet_attribute.is_bound()) {
+                    for (index_t t = from; t < to; ++t) {
+                        facet_attribute[t] = T[t].ref;
+                    }
+                }
+            });
+            for_each_slice(ne, parallel, [&](index_t from, index_t to) {
+                index_t* corners = M.cell_corners.vertex_index_ptr(0);
+                const MMG5_Tetra* K = &mmg->tetra[1];
+                for (index_t c = from; c < to; ++c) {
+                    corners[4*c]   = index_t(K[c].v[0] - 1);
+                    corners[4*c+1] = index_t(K[c].v[1] - 1);
+                    corners[4*c+2] = index_t(K[c].v[2] - 1);
+                    corners[4*c+3] = index_t(K[c].v[3] - 1);
+                }
+                if (cell_attribute.is_bound()) {
+                    for (index_t c = from; c < to; ++c) {
+                        cell_attribute[c] = K[c].ref;
+                    }
+                }
+            });
+        } else {
+            for_each_slice(nt, parallel, [&](index_t from, index_t to) {
+                for (uint t = from; t < to; ++t) {
+                    M.facets.set_vertex(t,0,(uint) mmg->tria[t+1].v[0] - 1);
+                    M.facets.set_vertex(t,1,(uint) mmg->tria[t+1].v[1] - 1);
+                    M.facets.set_vertex(t,2,(uint) mmg->tria[t+1].v[2] - 1);
+                    if (facet_attribute.is_bound()) {
+                        facet_attribute[t] =  mmg->tria[t+1].ref;
+                    }
+                }
+            });
+            for_each_slice(ne, parallel, [&](index_t from, index_t to) {
+                for (uint c = from; c < to; ++c) {
+                    M.cells.set_vertex(c,0,(uint) mmg->tetra[c+1].v[0] - 1);
+                    M.cells.set_vertex(c,1,(uint) mmg->tetra[c+1].v[1] - 1);
+                    M.cells.set_vertex(c,2,(uint) mmg->tetra[c+1].v[2] - 1);
+                    M.cells.set_vertex(c,3,(uint) mmg->tetra[c+1].v[3] - 1);
+                    if (cell_attribute.is_bound()) {
+                        cell_attribute[c] = mmg->tetra[c+1].ref;
+                    }
+                }
+            });
         }
-        for (uint e = 0; e < M.edges.nb(); ++e) {
-            M.edges.set_vertex(e,0,(uint) mmg->edge[e+1].a - 1);
-            M.edges.set_vertex(e,1,(uint) mmg->edge[e+1].b - 1);
+        for_each_slice((index_t) mmg->nquad, parallel, [&](index_t from, index_t to) {
+            for (index_t q = from; q < to; ++q) {
+                for (index_t lv = 0; lv < 4; ++lv) {
+                    M.facets.set_vertex(nt+q, lv, (index_t) mmg->quadra[q+1].v[lv] - 1);
+                }
+                if (facet_attribute.is_bound()) {
+                    facet_attribute[nt+q] = mmg->quadra[q+1].ref;
+                }
+            }
+        });
+        for_each_slice((index_t) mmg->nprism, parallel, [&](index_t from, index_t to) {
+            for (index_t p = from; p < to; ++p) {
+                for (index_t lv = 0; lv < 6; ++lv) {
+                    M.cells.set_vertex(ne+p, lv, (index_t) mmg->prism[p+1].v[lv] - 1);
+                }
+                if (cell_attribute.is_bound()) {
+                    cell_attribute[ne+p] = mmg->prism[p+1].ref;
+                }
+            }
+        });
+        double t_copy = W.elapsed_time();
+        if (connect) {
+            M.facets.connect();
+            M.cells.connect();
         }
-        if(edge_attribute_name != "no_attribute") {
-            Attribute< int > edge_attribute( M.edges.attributes(), edge_attribute_name);
-            for (uint e = 0; e < M.edges.nb(); ++e) {
-                edge_attribute[e] = mmg->edge[e+1].ref;
+
+        mmg_log_out("mmg_to_geo") << "MMG5_pMesh -> GEO::Mesh: "
+            << M.vertices.nb() << " vertices, "
+            << nt << " triangles, "
+            << ne << " tets, ";
+        if (mmg->nprism > 0 || mmg->nquad > 0) {
+            mmg_log_out("mmg_to_geo") << mmg->nquad << " quads, "
+                << mmg->nprism << " prisms, ";
+        }
+        mmg_log_out("mmg_to_geo") << "copy: " << t_copy << " s";
+        if (connect) {
+            mmg_log_out("mmg_to_geo") << ", connect: " << W.elapsed_time() - t_copy << " s";
+        }
+        mmg_log_out("mmg_to_geo") << (parallel ? " (parallel)" : "") << std::endl;
+
+        return true;
+    }
+
+    bool copy_mmg_adjacency(const MMG5_pMesh mmg, Mesh& M, bool volume_mesh, bool parallel) {
+        if (mmg->adja == NULL) return false;
+        std::atomic<bool> valid(true);
+        if (volume_mesh) {
+            index_t ne = M.cells.nb();
+            if (index_t(mmg->ne) != ne || !M.cells.are_simplices()) return false;
+            for_each_slice(ne, parallel, [&](index_t from, index_t to) {
+                for (index_t c = from; c < to; ++c) {
+                    const int* adj = &mmg->adja[4*c+1];
+                    for (index_t lf = 0; lf < 4; ++lf) {
+                        index_t k = index_t(adj[lf] / 4);
+                        if (adj[lf] < 0 || k > ne) {
+                            valid = false;
+                            return;
+                        }
+                        M.cells.set_adjacent(c, lf, k == 0 ? NO_CELL : k - 1);
+                    }
+                }
+            });
+        } else {
+            index_t nt = M.facets.nb();
+            if (index_t(mmg->nt) != nt || !M.facets.are_simplices()) return false;
+            for_each_slice(nt, parallel, [&](index_t from, index_t to) {
+                for (index_t f = from; f < to; ++f) {
+                    const int* adj = &mmg->adja[3*f+1];
+                    for (index_t le = 0; le < 3; ++le) {
+                        int a = adj[(le + 2) % 3];
+                        index_t k = index_t(a / 3);
+                        if (a < 0 || k > nt) {
+                            valid = false;
+                            return;
+                        }
+                        M.facets.set_adjacent(f, le, k == 0 ? NO_FACET : k - 1);
+                    }
+                }
+            });
+        }
+        return valid;
+    }
+
+    void connect_output(const MMG5_pMesh mmg, Mesh& M, bool volume_mesh, const MmgOptions& opt) {
+        if (opt.output_adjacency == "none") return;
+        bool from_mmg = (opt.output_adjacency == "mmg");
+        if (!from_mmg && opt.output_adjacency != "connect") {
+            mmg_log_warn("mmg_to_geo") << "unknown output_adjacency " << opt.output_adjacency
+                << ", using connect" << std::endl;
+        }
+        if (volume_mesh) {
+            /* the boundary triangles are few, mmg3d does not keep their
+             * adjacency anyway */
+            M.facets.connect();
+            if (!from_mmg || !copy_mmg_adjacency(mmg, M, true, opt.parallel_conversion)) {
+                M.cells.connect();
+            }
+        } else if (!from_mmg || !copy_mmg_adjacency(mmg, M, false, opt.parallel_conversion)) {
+            M.facets.connect();
+        }
+    }
+
+    bool mmg_iso_to_geo(const MMG5_pMesh mmg, const MMG5_pSol ls, Mesh& M,
+                        const MmgOptions& opt) {
+        bool parallel = opt.parallel_conversion;
+        Attribute<double> ls_out;
+        if (opt.iso_output == "volume") {
+            if (!mmg_to_geo(mmg, M, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute,
+                            parallel, false, opt.bulk_conversion)) {
+                return false;
             }
+            if (opt.ls_attribute != "no_ls") {
+                ls_out.bind(M.vertices.attributes(), opt.ls_attribute);
+                for_each_slice(M.vertices.nb(), parallel, [&](index_t from, index_t to) {
+                    for (index_t v = from; v < to; ++v) {
+                        ls_out[v] = ls->m[v+1];
+                    }
+                });
+            }
+            connect_output(mmg, M, true, opt);
+            return true;
         }
-        for (uint t = 0; t < M.facets.nb(); ++t) {
-            M.facets.set_vertex(t,0,(uint) mmg->tria[t+1].v[0] - 1);
-            M.facets.set_vertex(t,1,(uint) mmg->tria[t+1].v[1] - 1);
-            M.facets.set_vertex(t,2,(uint) mmg->tria[t+1].v[2] - 1);
+        int tet_ref = 0; /* no tet */
+        if (opt.iso_output == "interior") {
+            tet_ref = MMG_MINUS_REF;
+        } else if (opt.iso_output == "exterior") {
+            tet_ref = MMG_PLUS_REF;
+        } else if (opt.iso_output != "surface") {
+            mmg_log_err("mmg_to_geo") << "unknown iso_output " << opt.iso_output << std::endl;
+            return false;
         }
-        if(facet_attribute_name != "no_attribute") {
-            Attribute< int > facet_attribute( M.facets.attributes(), facet_attribute_name);
-            for (uint t = 0; t < M.facets.nb(); ++t) {
-                facet_attribute[t] =  mmg->tria[t+1].ref;
+        Stopwatch W("mmg_to_geo", false);
+
+        /* Selection and renumbering (1-based mmg indices) */
+        std::vector<index_t> trias;
+        std::vector<index_t> tets;
+        std::vector<index_t> tet_map;
+        std::vector<index_t> vertex_map(index_t(mmg->np) + 1, NO_VERTEX);
+        for (index_t t = 1; t <= index_t(mmg->nt); ++t) {
+            if (mmg->tria[t].ref != MMG_ISO_REF) continue;
+            trias.push_back(t);
+            for (index_t lv = 0; lv < 3; ++lv) vertex_map[mmg->tria[t].v[lv]] = 0;
+        }
+        if (tet_ref != 0) {
+            tet_map.assign(index_t(mmg->ne) + 1, NO_CELL);
+            for (index_t k = 1; k <= index_t(mmg->ne); ++k) {
+                if (mmg->tetra[k].ref != tet_ref) continue;
+                tet_map[k] = index_t(tets.size());
+                tets.push_back(k);
+                for (index_t lv = 0; lv < 4; ++lv) vertex_map[mmg->tetra[k].v[lv]] = 0;
             }
         }
-        for (uint c = 0; c < M.cells.nb(); ++c) {
-            M.cells.set_vertex(c,0,(uint) mmg->tetra[c+1].v[0] - 1);
-            M.cells.set_vertex(c,1,(uint) mmg->tetra[c+1].v[1] - 1);
-            M.cells.set_vertex(c,2,(uint) mmg->tetra[c+1].v[2] - 1);
-            M.cells.set_vertex(c,3,(uint) mmg->tetra[c+1].v[3] - 1);
+        std::vector<index_t> vertices;
+        for (index_t v = 1; v <= index_t(mmg->np); ++v) {
+            if (vertex_map[v] == NO_VERTEX) continue;
+            vertex_map[v] = index_t(vertices.size());
+            vertices.push_back(v);
         }
-        if(cell_attribute_name != "no_attribute") {
-            Attribute< int > cell_attribute( M.cells.attributes(), cell_attribute_name);
-            for (uint c = 0; c < M.cells.nb(); ++c) {
-                cell_attribute[c] = mmg->tetra[c+1].ref;
+        std::vector<index_t> edges;
+        for (index_t e = 1; e <= index_t(mmg->na); ++e) {
+            if (vertex_map[mmg->edge[e].a] != NO_VERTEX && vertex_map[mmg->edge[e].b] != NO_VERTEX) {
+                edges.push_back(e);
             }
         }
-        M.facets.connect();
-        M.cells.connect();
 
+        M.clear();
+        M.vertices.create_vertices(index_t(vertices.size()));
+        M.edges.create_edges(index_t(edges.size()));
+        M.facets.create_triangles(index_t(trias.size()));
+        M.cells.create_tets(index_t(tets.size()));
+        Attribute<int> edge_attribute;
+        Attribute<int> facet_attribute;
+        Attribute<int> cell_attribute;
+        if (opt.edge_attribute != "no_attribute") {
+            edge_attribute.bind(M.edges.attributes(), opt.edge_attribute);
+        }
+        if (opt.facet_attribute != "no_attribute") {
+            facet_attribute.bind(M.facets.attributes(), opt.facet_attribute);
+        }
+        if (opt.cell_attribute != "no_attribute" && tet_ref != 0) {
+            cell_attribute.bind(M.cells.attributes(), opt.cell_attribute);
+        }
+        if (opt.ls_attribute != "no_ls") {
+            ls_out.bind(M.vertices.attributes(), opt.ls_attribute);
+        }
+
+        for_each_slice(M.vertices.nb(), parallel, [&](index_t from, index_t to) {
+            for (index_t v = from; v < to; ++v) {
+                double* p = M.vertices.point_ptr(v);
+                const MMG5_Point& P = mmg->point[vertices[v]];
+                p[0] = P.c[0];
+                p[1] = P.c[1];
+                p[2] = P.c[2];
+                if (ls_out.is_bound()) ls_out[v] = ls->m[vertices[v]];
+            }
+        });
+        for (index_t e = 0; e < M.edges.nb(); ++e) {
+            M.edges.set_vertex(e, 0, vertex_map[mmg->edge[edges[e]].a]);
+            M.edges.set_vertex(e, 1, vertex_map[mmg->edge[edges[e]].b]);
+            if (edge_attribute.is_bound()) edge_attribute[e] = mmg->edge[edges[e]].ref;
+        }
+        for_each_slice(M.facets.nb(), parallel, [&](index_t from, index_t to) {
+            for (index_t t = from; t < to; ++t) {
+                const MMG5_Tria& T = mmg->tria[trias[t]];
+                for (index_t lv = 0; lv < 3; ++lv) {
+                    M.facets.set_vertex(t, lv, vertex_map[T.v[lv]]);
+                }
+                if (facet_attribute.is_bound()) facet_attribute[t] = T.ref;
+            }
+        });
+        for_each_slice(M.cells.nb(), parallel, [&](index_t from, index_t to) {
+            for (index_t c = from; c < to; ++c) {
+                const MMG5_Tetra& K = mmg->tetra[tets[c]];
+                for (index_t lv = 0; lv < 4; ++lv) {
+                    M.cells.set_vertex(c, lv, vertex_map[K.v[lv]]);
+                }
+                if (cell_attribute.is_bound()) cell_attribute[c] = K.ref;
+            }
+        });
+        double t_copy = W.elapsed_time();
+
+        if (opt.output_adjacency != "none") {
+            M.facets.connect();
+            if (opt.output_adjacency == "mmg" && mmg->adja != NULL) {
+                /* mmg's adjacency, restricted to the kept tets */
+                for_each_slice(M.cells.nb(), parallel, [&](index_t from, index_t to) {
+                    for (index_t c = from; c < to; ++c) {
+                        const int* adja = &mmg->adja[4 * (tets[c] - 1) + 1];
+                        for (index_t lf = 0; lf < 4; ++lf) {
+                            index_t k = index_t(adja[lf] / 4);
+                            M.cells.set_adjacent(c, lf, (adja[lf] == 0) ? NO_CELL : tet_map[k]);
+                        }
+                    }
+                });
+            } else {
+                M.cells.connect();
+            }
+        }
+
+        mmg_log_out("mmg_to_geo") << "MMG5_pMesh -> GEO::Mesh (" << opt.iso_output << "): "
+            << M.vertices.nb() << "/" << mmg->np << " vertices, "
+            << M.facets.nb() << " triangles, "
+            << M.cells.nb() << "/" << mmg->ne << " tets, copy: " << t_copy
+            << " s, adjacency: " << W.elapsed_time() - t_copy << " s" << std::endl;
         return true;
     }
 
     bool geo_to_mmg(const Mesh& M, MMG5_pMesh& mmg,
                     MMG5_pSol& sol,
-                    bool volume_mesh = true,
-                    bool enable_anisotropy = false,
-                    const std::string & edge_attribute_name = "no_attribute",
-                    const std::string & facet_attribute_name = "no_attribute",
-                    const std::string & cell_attribute_name = "no_attribute") {
-        printf("converting GEO::M to MMG5_pMesh .. \n");
-        geo_assert(M.vertices.dimension() == 3);
-        // if (M.facets.nb() > 0) geo_assert(M.facets.are_simplices());
-        // if (M.cells.nb() > 0) geo_assert(M.cells.are_simplices());
-
-        if (volume_mesh) {
+                    bool volume_mesh,
+                    bool enable_anisotropy,
+                    const std::string & edge_attribute_name,
+                    const std::string & facet_attribute_name,
+                    const std::string & cell_attribute_name,
+                    bool parallel,
+                    bool bulk,
+                    MMG5_pSol* disp) {
+        Stopwatch W("geo_to_mmg", false);
+        if (volume_mesh && disp != NULL) {
+            MMG3D_Init_mesh(MMG5_ARG_start, MMG5_ARG_ppMesh,&mmg,MMG5_ARG_ppMet,&sol, MMG5_ARG_ppDisp,disp, MMG5_ARG_end);
+        } else if (volume_mesh) {
             MMG3D_Init_mesh(MMG5_ARG_start, MMG5_ARG_ppMesh,&mmg,MMG5_ARG_ppMet,&sol, MMG5_ARG_end);
         } else {
             MMGS_Init_mesh(MMG5_ARG_start, MMG5_ARG_ppMesh,&mmg,MMG5_ARG_ppMet,&sol, MMG5_ARG_end);
         }
+        /* the callers free mmg on failure, so it is initialized first. The
+         * other checks are in preflight_check() */
+        if (M.vertices.dimension() != 3) {
+            mmg_log_err("geo_to_mmg") << "vertices of dimension " << M.vertices.dimension()
+                << ", expected 3" << std::endl;
+            return false;
+        }
+
+        /* mmg3d takes prisms and quads next to the tets and triangles, in
+         * separate arrays. The rank of an element is its index in the array
+         * of its kind, it is only computed for mixed meshes */
+        index_t nb_tets = M.cells.nb();
+        index_t nb_prisms = 0;
+        index_t nb_triangles = M.facets.nb();
+        index_t nb_quads = 0;
+        std::vector<index_t> cell_rank;
+        std::vector<index_t> facet_rank;
+        if (volume_mesh && !M.cells.are_simplices()) {
+            nb_tets = 0;
+            cell_rank.resize(M.cells.nb());
+            for (index_t c = 0; c < M.cells.nb(); ++c) {
+                if (M.cells.type(c) == MESH_TET) {
+                    cell_rank[c] = nb_tets++;
+                } else if (M.cells.type(c) == MESH_PRISM) {
+                    cell_rank[c] = nb_prisms++;
+                } else {
+                    mmg_log_err("geo_to_mmg") << "cell " << c << " is neither a tet nor a prism" << std::endl;
+                    return false;
+                }
+            }
+        }
+        if (volume_mesh && !M.facets.are_simplices()) {
+            nb_triangles = 0;
+            facet_rank.resize(M.facets.nb());
+            for (index_t f = 0; f < M.facets.nb(); ++f) {
+                if (M.facets.nb_vertices(f) == 3) {
+                    facet_rank[f] = nb_triangles++;
+                } else if (M.facets.nb_vertices(f) == 4) {
+                    facet_rank[f] = nb_quads++;
+                } else {
+                    mmg_log_err("geo_to_mmg") << "facet " << f << " is neither a triangle nor a quad" << std::endl;
+                    return false;
+                }
+            }
+        }
 
         if (volume_mesh && MMG3D_Set_meshSize(
                     mmg,
                     (int) M.vertices.nb(),
-                    (int) M.cells.nb(),
-                    0, /* nb prisms */
-                    (int) M.facets.nb(),
-                    0, /* nb quad */
+                    (int) nb_tets,
+                    (int) nb_prisms,
+                    (int) nb_triangles,
+                    (int) nb_quads,
                     (int) M.edges.nb()  /* nb edges */
                     ) != 1 ) {
-            printf("failed to MMG3D_Set_meshSize\n");
+            mmg_log_err("geo_to_mmg") << "failed to MMG3D_Set_meshSize" << std::endl;
             return false;
         } else if (!volume_mesh && MMGS_Set_meshSize(
                     mmg,
@@ -147,61 +574,168 @@ namespace OGF {
                     (int) M.facets.nb(),
                     (int) M.edges.nb()  /* nb edges */
                     ) != 1 ) {
-            printf("failed to MMGS_Set_meshSize\n");
+            mmg_log_err("geo_to_mmg") << "failed to MMGS_Set_meshSize" << std::endl;
             return false;
         }
 
-        for (uint v = 0; v < (uint) mmg->np; ++v) {
-            for (uint d = 0; d < M.vertices.dimension(); ++d) {
-                mmg->point[v+1].c[d] = M.vertices.point_ptr(v)[d];
-            }
-        }
-        for (uint e = 0; e < (uint) mmg->na; ++e) {
-            mmg->edge[e+1].a = (int) M.edges.vertex(e,0) + 1;
-            mmg->edge[e+1].b = (int) M.edges.vertex(e,1) + 1;
-        }
+        /* Attributes are checked and bound before the loops, so that the
+         * threads only access their storage */
+        Attribute< int > edge_attribute;
+        Attribute< int > facet_attribute;
+        Attribute< int > cell_attribute;
         if(edge_attribute_name != "no_attribute") {
             if (!M.edges.attributes().is_defined( edge_attribute_name)) {
-              printf("failed to find attribute named %s on edges", edge_attribute_name.c_str());
+              mmg_log_err("geo_to_mmg") << "failed to find attribute named " << edge_attribute_name << " on edges" << std::endl;
               return false;
             }
-            Attribute< int > edge_attribute( M.edges.attributes(), edge_attribute_name );
-            for (uint e = 0; e < (uint) mmg->na; ++e) {
-                mmg->edge[e+1].ref = edge_attribute[e];
-            }
-        }
-        for (uint t = 0; t < (uint) mmg->nt; ++t) {
-            mmg->tria[t+1].v[0] = (int) M.facets.vertex(t,0) + 1;
-            mmg->tria[t+1].v[1] = (int) M.facets.vertex(t,1) + 1;
-            mmg->tria[t+1].v[2] = (int) M.facets.vertex(t,2) + 1;
+            edge_attribute.bind(M.edges.attributes(), edge_attribute_name);
         }
         if(facet_attribute_name != "no_attribute") {
             if (!M.facets.attributes().is_defined( facet_attribute_name)) {
-              printf("failed to find attribute named %s on facets", facet_attribute_name.c_str());
+              mmg_log_err("geo_to_mmg") << "failed to find attribute named " << facet_attribute_name << " on facets" << std::endl;
               return false;
             }
-            Attribute< int > facet_attribute( M.facets.attributes(), facet_attribute_name );
-            for (uint t = 0; t < (uint) mmg->nt; ++t) {
-                mmg->tria[t+1].ref = facet_attribute[t];
-            }
+            facet_attribute.bind(M.facets.attributes(), facet_attribute_name);
         }
-        if (volume_mesh) {
-            for (uint c = 0; c < (uint) mmg->ne; ++c) {
-                mmg->tetra[c+1].v[0] = (int) M.cells.vertex(c,0) + 1;
-                mmg->tetra[c+1].v[1] = (int) M.cells.vertex(c,1) + 1;
-                mmg->tetra[c+1].v[2] = (int) M.cells.vertex(c,2) + 1;
-                mmg->tetra[c+1].v[3] = (int) M.cells.vertex(c,3) + 1;
+        if(volume_mesh && cell_attribute_name != "no_attribute") {
+            if(!M.cells.attributes().is_defined( cell_attribute_name )) {
+                mmg_log_err("geo_to_mmg") << "failed to find attribute named " << cell_attribute_name << " on cells" << std::endl;
+                return false;
             }
-            if(cell_attribute_name != "no_attribute") {
-                if(!M.cells.attributes().is_defined( cell_attribute_name )) {
-                    printf("failed to find attribute named %s on cells", cell_attribute_name.c_str());
-                    return false;
+            cell_attribute.bind(M.cells.attributes(), cell_attribute_name);
+        }
+
+        /* Bulk path: geogram stores the points, and the corners of simplicial
+         * facets and cells, in contiguous arrays. Reading them directly skips
+         * the per-element accessors, what remains are tight loops doing the
+         * index shift */
+        if (bulk && !M.vertices.single_precision()) {
+            for_each_slice((index_t) mmg->np, parallel, [&](index_t from, index_t to) {
+                const double* xyz = M.vertices.point_ptr(0);
+                MMG5_Point* P = &mmg->point[1];
+                for (index_t v = from; v < to; ++v) {
+                    P[v].c[0] = xyz[3*v];
+                    P[v].c[1] = xyz[3*v+1];
+                    P[v].c[2] = xyz[3*v+2];
                 }
-                Attribute< int > cell_attribute(M.cells.attributes(), cell_attribute_name);
-                for (uint c = 0; c < (uint) mmg->ne; ++c) {
-                  mmg->tetra[c+1].ref = cell_attribute[c];
+            });
+        } else {
+            for_each_slice((index_t) mmg->np, parallel, [&](index_t from, index_t to) {
+                for (uint v = from; v < to; ++v) {
+                    const double* p = M.vertices.point_ptr(v);
+                    for (uint d = 0; d < M.vertices.dimension(); ++d) {
+                        mmg->point[v+1].c[d] = p[d];
+                    }
+                }
+            });
+        }
+        for_each_slice((index_t) mmg->na, parallel, [&](index_t from, index_t to) {
+            for (uint e = from; e < to; ++e) {
+                mmg->edge[e+1].a = (int) M.edges.vertex(e,0) + 1;
+                mmg->edge[e+1].b = (int) M.edges.vertex(e,1) + 1;
+                if (edge_attribute.is_bound()) {
+                    mmg->edge[e+1].ref = edge_attribute[e];
                 }
             }
+        });
+        if (bulk && M.facets.are_simplices()) {
+            for_each_slice((index_t) mmg->nt, parallel, [&](index_t from, index_t to) {
+                const index_t* corners = M.facet_corners.vertex_index_ptr(0);
+                MMG5_Tria* T = &mmg->tria[1];
+                for (index_t t = from; t < to; ++t) {
+                    T[t].v[0] = int(corners[3*t]) + 1;
+                    T[t].v[1] = int(corners[3*t+1]) + 1;
+                    T[t].v[2] = int(corners[3*t+2]) + 1;
+                }
+                if (facet_attribute.is_bound()) {
+                    for (index_t t = from; t < to; ++t) {
+                        T[t].ref = facet_attribute[t];
+                    }
+                }
+            });
+        } else if (nb_quads > 0) {
+            for_each_slice(M.facets.nb(), parallel, [&](index_t from, index_t to) {
+                for (index_t f = from; f < to; ++f) {
+                    int* v = NULL;
+                    int* ref = NULL;
+                    if (M.facets.nb_vertices(f) == 3) {
+                        v = mmg->tria[facet_rank[f]+1].v;
+                        ref = &mmg->tria[facet_rank[f]+1].ref;
+                    } else {
+                        v = mmg->quadra[facet_rank[f]+1].v;
+                        ref = &mmg->quadra[facet_rank[f]+1].ref;
+                    }
+                    for (index_t lv = 0; lv < M.facets.nb_vertices(f); ++lv) {
+                        v[lv] = (int) M.facets.vertex(f,lv) + 1;
+                    }
+                    if (facet_attribute.is_bound()) {
+                        *ref = facet_attribute[f];
+                    }
+                }
+            });
+        } else {
+            for_each_slice((index_t) mmg->nt, parallel, [&](index_t from, index_t to) {
+                for (uint t = from; t < to; ++t) {
+                    mmg->tria[t+1].v[0] = (int) M.facets.vertex(t,0) + 1;
+                    mmg->tria[t+1].v[1] = (int) M.facets.vertex(t,1) + 1;
+                    mmg->tria[t+1].v[2] = (int) M.facets.vertex(t,2) + 1;
+                    if (facet_attribute.is_bound()) {
+                        mmg->tria[t+1].ref = facet_attribute[t];
+                    }
+                }
+            });
+        }
+        if (volume_mesh && bulk && M.cells.are_simplices()) {
+            for_each_slice((index_t) mmg->ne, parallel, [&](index_t from, index_t to) {
+                const index_t* corners = M.cell_corners.vertex_index_ptr(0);
+                MMG5_Tetra* K = &mmg->tetra[1];
+                for (index_t c = from; c < to; ++c) {
+                    K[c].v[0] = int(corners[4*c]) + 1;
+                    K[c].v[1] = int(corners[4*c+1]) + 1;
+                    K[c].v[2] = int(corners[4*c+2]) + 1;
+                    K[c].v[3] = int(corners[4*c+3]) + 1;
+                }
+                if (cell_attribute.is_bound()) {
+                    for (index_t c = from; c < to; ++c) {
+                        K[c].ref = cell_attribute[c];
+                    }
+                }
+            });
+        } else if (volume_mesh && nb_prisms > 0) {
+            for_each_slice(M.cells.nb(), parallel, [&](index_t from, index_t to) {
+                for (index_t c = from; c < to; ++c) {
+                    int* v = NULL;
+                    int* ref = NULL;
+                    if (M.cells.type(c) == MESH_TET) {
+                        v = mmg->tetra[cell_rank[c]+1].v;
+                        ref = &mmg->tetra[cell_rank[c]+1].ref;
+                    } else {
+                        v = mmg->prism[cell_rank[c]+1].v;
+                        ref = &mmg->prism[cell_rank[c]+1].ref;
+                    }
+                    /* geogram and mmg both list the two triangles of a
+                     * prism, vertex i of the first one being linked to
+                     * vertex i of the second one */
+                    for (index_t lv = 0; lv < M.cells.nb_vertices(c); ++lv) {
+                        v[lv] = (int) M.cells.vertex(c,lv) + 1;
+                    }
+                    if (cell_attribute.is_bound()) {
+                        *ref = cell_attribute[c];
+                    }
+                }
+            });
+        } else if (volume_mesh) {
+            for_each_slice((index_t) mmg->ne, parallel, [&](index_t from, index_t to) {
+                for (uint c = from; c < to; ++c) {
+                    mmg->tetra[c+1].v[0] = (int) M.cells.vertex(c,0) + 1;
+                    mmg->tetra[c+1].v[1] = (int) M.cells.vertex(c,1) + 1;
+                    mmg->tetra[c+1].v[2] = (int) M.cells.vertex(c,2) + 1;
+                    mmg->tetra[c+1].v[3] = (int) M.cells.vertex(c,3) + 1;
+                    if (cell_attribute.is_bound()) {
+                        mmg->tetra[c+1].ref = cell_attribute[c];
+                    }
+                }
+            });
         }
 
         MMG5_type metric_type = MMG5_Scalar;
@@ -210,20 +744,23 @@ namespace OGF {
           metric_type = MMG5_Tensor;
         }
         if (volume_mesh && MMG3D_Set_solSize(mmg,sol,MMG5_Vertex,(int)M.vertices.nb(),metric_type) != 1 ) {
-            printf("failed to MMG3D_Set_solSize\n");
+            mmg_log_err("geo_to_mmg") << "failed to MMG3D_Set_solSize" << std::endl;
             return false;
         } else if (!volume_mesh && MMGS_Set_solSize(mmg,sol,MMG5_Vertex,(int)M.vertices.nb(),metric_type) != 1 ) {
-            printf("failed to MMGS_Set_solSize\n");
+            mmg_log_err("geo_to_mmg") << "failed to MMGS_Set_solSize" << std::endl;
             return false;
         }
-        for(uint v = 0; v < M.vertices.nb(); ++v) {
-            sol->m[v+1] = 1.;
-        }
+        for_each_slice(M.vertices.nb(), parallel, [&](index_t from, index_t to) {
+            for(uint v = from; v < to; ++v) {
+                sol->m[v+1] = 1.;
+            }
+        });
+        double t_copy = W.elapsed_time();
         if (volume_mesh && MMG3D_Chk_meshData(mmg,sol) != 1) {
-            printf("error in mmg: inconsistant mesh and sol\n");
+            mmg_log_err("geo_to_mmg") << "error in mmg: inconsistant mesh and sol" << std::endl;
             return false;
         } else if (!volume_mesh && MMGS_Chk_meshData(mmg,sol) != 1) {
-            printf("error in mmg: inconsistant mesh and sol\n");
+            mmg_log_err("geo_to_mmg") << "error in mmg: inconsistant mesh and sol" << std::endl;
             return false;
         }
 
@@ -231,6 +768,74 @@ namespace OGF {
             MMG3D_Set_handGivenMesh(mmg); /* because we don't use the API functions */
         } 
 
+        /* mmg3d only remeshes the tets. The vertices of the prisms and of
+         * the quads are required, so that the layers and their interface
+         * with the tets stay as they are */
+        if (nb_prisms > 0 || nb_quads > 0) {
+            std::vector<char> fixed(M.vertices.nb(), 0);
+            for (int p = 1; p <= mmg->nprism; ++p) {
+                for (index_t lv = 0; lv < 6; ++lv) fixed[mmg->prism[p].v[lv] - 1] = 1;
+            }
+            for (int q = 1; q <= mmg->nquad; ++q) {
+                for (index_t lv = 0; lv < 4; ++lv) fixed[mmg->quadra[q].v[lv] - 1] = 1;
+            }
+            for (index_t v = 0; v < M.vertices.nb(); ++v) {
+                if (fixed[v]) MMG3D_Set_requiredVertex(mmg, int(v) + 1);
+            }
+        }
+
+        mmg_log_out("geo_to_mmg") << "GEO::Mesh -> MMG5_pMesh: "
+            << M.vertices.nb() << " vertices, "
+            << nb_triangles << " triangles, "
+            << nb_tets << " tets, ";
+        if (nb_prisms > 0 || nb_quads > 0) {
+            mmg_log_out("geo_to_mmg") << nb_quads << " quads, "
+                << nb_prisms << " prisms (fixed), ";
+        }
+        mmg_log_out("geo_to_mmg") << "copy: " << t_copy << " s, checks: "
+            << W.elapsed_time() - t_copy << " s"
+            << (parallel ? " (parallel)" : "") << std::endl;
+
+        return true;
+    }
+
+    bool mmg3d_clone(const MMG5_pMesh mmg, const MMG5_pSol sol,
+                     MMG5_pMesh& mmg_copy, MMG5_pSol& sol_copy) {
+        MMG3D_Init_mesh(MMG5_ARG_start, MMG5_ARG_ppMesh,&mmg_copy,MMG5_ARG_ppMet,&sol_copy, MMG5_ARG_end);
+        if (MMG3D_Set_meshSize(mmg_copy, mmg->np, mmg->ne, mmg->nprism, mmg->nt, mmg->nquad, mmg->na) != 1) {
+            mmg_log_err("mmg3d_clone") << "failed to MMG3D_Set_meshSize" << std::endl;
+            return false;
+        }
+        /* the elements are plain structs, the 1-based arrays are copied as is */
+        std::copy(mmg->point + 1, mmg->point + 1 + mmg->np, mmg_copy->point + 1);
+        std::copy(mmg->tetra + 1, mmg->tetra + 1 + mmg->ne, mmg_copy->tetra + 1);
+        std::copy(mmg->tria + 1, mmg->tria + 1 + mmg->nt, mmg_copy->tria + 1);
+        std::copy(mmg->edge + 1, mmg->edge + 1 + mmg->na, mmg_copy->edge + 1);
+        if (mmg->nprism > 0) std::copy(mmg->prism + 1, mmg->prism + 1 + mmg->nprism, mmg_copy->prism + 1);
+        if (mmg->nquad > 0) std::copy(mmg->quadra + 1, mmg->quadra + 1 + mmg->nquad, mmg_copy->quadra + 1);
+        if (MMG3D_Set_solSize(mmg_copy, sol_copy, MMG5_Vertex, sol->np, sol->type) != 1) {
+            mmg_log_err("mmg3d_clone") << "failed to MMG3D_Set_solSize" << std::endl;
+            return false;
+        }
+        std::copy(sol->m + sol->size, sol->m + sol->size * (sol->np + 1), sol_copy->m + sol->size);
+        return true;
+    }
+
+    bool mmgs_clone(const MMG5_pMesh mmg, const MMG5_pSol sol,
+                    MMG5_pMesh& mmg_copy, MMG5_pSol& sol_copy) {
+        MMGS_Init_mesh(MMG5_ARG_start, MMG5_ARG_ppMesh,&mmg_copy,MMG5_ARG_ppMet,&sol_copy, MMG5_ARG_end);
+        if (MMGS_Set_meshSize(mmg_copy, mmg->np, mmg->nt, mmg->na) != 1) {
+            mmg_log_err("mmgs_clone") << "failed to MMGS_Set_meshSize" << std::endl;
+            return false;
+        }
+        std::copy(mmg->point + 1, mmg->point + 1 + mmg->np, mmg_copy->point + 1);
+        std::copy(mmg->tria + 1, mmg->tria + 1 + mmg->nt, mmg_copy->tria + 1);
+        std::copy(mmg->edge + 1, mmg->edge + 1 + mmg->na, mmg_copy->edge + 1);
+        if (MMGS_Set_solSize(mmg_copy, sol_copy, MMG5_Vertex, sol->np, sol->type) != 1) {
+            mmg_log_err("mmgs_clone") << "failed to MMGS_Set_solSize" << std::endl;
+            return false;
+        }
+        std::copy(sol->m + sol->size, sol->m + sol->size * (sol->np + 1), sol_copy->m + sol->size);
         return true;
     }
 
@@ -253,21 +858,90 @@ namespace OGF {
         return ok;
     }
 
-    bool mmgs_tri_remesh(const Mesh& M,
-                         Mesh& M_out,
-                         const MmgOptions& opt) {
-        MMG5_pMesh mesh = NULL;
-        MMG5_pSol met = NULL;
-        bool ok = geo_to_mmg(M, mesh, met, false, opt.enable_anisotropy, opt.edge_attribute, opt.facet_attribute);
-        if (!ok) {
-            Logger::err("mmgs_remesh") << "failed to convert mesh to MMG5_pMesh" << std::endl;
-            mmgs_free(mesh, met);
+    StatsRecorder::StatsRecorder(const MmgOptions& opt, const Mesh& M) :
+        stats_(opt.stats), W_("mmg_stats", false), last_(0.) {
+        if (stats_ == NULL) return;
+        *stats_ = MmgRemeshStats();
+        stats_->nb_vertices_in = M.vertices.nb();
+        stats_->nb_edges_in = M.edges.nb();
+        stats_->nb_triangles_in = M.facets.nb();
+        stats_->nb_tets_in = M.cells.nb();
+    }
+
+    StatsRecorder::~StatsRecorder() {
+        if (stats_ == NULL) return;
+        stats_->times.total = W_.elapsed_time();
+        stats_->peak_memory = Process::max_used_memory();
+    }
+
+    void StatsRecorder::mmg_done(int return_code, const MMG5_pMesh mesh) {
+        if (stats_ == NULL) return;
+        stats_->mmg_return_code = return_code;
+        if (mesh != NULL) {
+            stats_->mmg_memory = size_t(mesh->memCur);
+        }
+    }
+
+    void StatsRecorder::output(const Mesh& M_out) {
+        if (stats_ == NULL) return;
+        stats_->nb_vertices_out = M_out.vertices.nb();
+        stats_->nb_edges_out = M_out.edges.nb();
+        stats_->nb_triangles_out = M_out.facets.nb();
+        stats_->nb_tets_out = M_out.cells.nb();
+        stats_->success = true;
+    }
+
+    void StatsRecorder::output(const std::vector<Mesh*>& M_out) {
+        if (stats_ == NULL) return;
+        for (const Mesh* M : M_out) {
+            stats_->nb_vertices_out += M->vertices.nb();
+            stats_->nb_edges_out += M->edges.nb();
+            stats_->nb_triangles_out += M->facets.nb();
+            stats_->nb_tets_out += M->cells.nb();
+        }
+        stats_->success = true;
+    }
+
+    void StatsRecorder::nested(const MmgRemeshStats& inner) {
+        last_ = W_.elapsed_time();
+        if (stats_ == NULL) return;
+        stats_->times.geo_to_mmg += inner.times.geo_to_mmg;
+        stats_->times.setup += inner.times.setup;
+        stats_->times.mmg += inner.times.mmg;
+        stats_->times.mmg_to_geo += inner.times.mmg_to_geo;
+        stats_->times.connect += inner.times.connect;
+        stats_->times.transfer += inner.times.transfer;
+        stats_->times.reorder += inner.times.reorder;
+        stats_->mmg_return_code = inner.mmg_return_code;
+        stats_->mmg_memory = inner.mmg_memory;
+    }
+
+    bool monitor_phase(const MmgOptions& opt, MmgPhase phase) {
+        if (opt.monitor == NULL) return true;
+        if (opt.monitor->cancel_requested) {
+            mmg_log_warn("mmg_wrapper") << "cancelled before " << mmg_phase_name(phase) << std::endl;
             return false;
         }
+        opt.monitor->phase = int(phase);
+        return true;
+    }
+
+    const char* mmg_phase_name(MmgPhase phase) {
+        switch (phase) {
+            case MMG_PHASE_IDLE: return "idle";
+            case MMG_PHASE_CONVERSION: return "conversion";
+            case MMG_PHASE_ANALYSIS: return "analysis";
+            case MMG_PHASE_REMESHING: return "remeshing";
+            case MMG_PHASE_CONVERSION_BACK: return "conversion back";
+            case MMG_PHASE_DONE: return "done";
+        }
+        return "unknown";
+    }
 
-        /* Set remeshing options */
+    void mmgs_set_parameters(MMG5_pMesh mesh, MMG5_pSol met,
+                             const MmgOptions& opt, bool has_metric) {
         MMGS_Set_dparameter(mesh, met, MMGS_DPARAM_angleDetection, opt.angle_value);
-        if (opt.hsiz == 0. || opt.metric_attribute != "no_metric") {
+        if (opt.hsiz == 0. || has_metric) {
             MMGS_Set_dparameter(mesh, met, MMGS_DPARAM_hmin, opt.hmin);
             MMGS_Set_dparameter(mesh, met, MMGS_DPARAM_hmax, opt.hmax);
         } else {
@@ -280,42 +954,265 @@ namespace OGF {
         MMGS_Set_iparameter(mesh, met, MMGS_IPARAM_noswap, int(opt.noswap));
         MMGS_Set_iparameter(mesh, met, MMGS_IPARAM_noinsert, int(opt.noinsert));
         MMGS_Set_iparameter(mesh, met, MMGS_IPARAM_nomove, int(opt.nomove));
-        if (opt.metric_attribute != "no_metric") {
-            if (!M.vertices.attributes().is_defined(opt.metric_attribute)) {
-                Logger::err("mmgs_remesh") << opt.metric_attribute << " is not a vertex attribute, cancel" << std::endl;
+    }
+
+    void mmg3d_set_parameters(MMG5_pMesh mesh, MMG5_pSol met,
+                              const MmgOptions& opt, bool has_metric) {
+        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_angleDetection, opt.angle_value);
+        if (opt.hsiz == 0. || has_metric) {
+            MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hmin, opt.hmin);
+            MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hmax, opt.hmax);
+        } else {
+            met->np = 0;
+            MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hsiz, opt.hsiz);
+        }
+        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hausd, opt.hausd);
+        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hgrad, opt.hgrad);
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_angle, int(opt.angle_detection));
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_noswap, int(opt.noswap));
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_noinsert, int(opt.noinsert));
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_nomove, int(opt.nomove));
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_nosurf, int(opt.nosurf));
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_opnbdy, int(opt.opnbdy));
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_optim, int(opt.optim));
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_optimLES, int(opt.optimLES));
+    }
+
+    bool mmg3d_set_ls_parameters(MMG5_pMesh mesh, MMG5_pSol met,
+                                 const MmgOptions& opt) {
+        if (opt.hsiz != 0.) {
+            mmg_log_err("mmg3d_iso") << "should not use hsiz parameter for level set mode" << std::endl;
+            return false;
+        }
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_iso, 1);
+        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_ls, opt.ls_value);
+        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_angleDetection, opt.angle_value);
+        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hmin, opt.hmin);
+        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hmax, opt.hmax);
+        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hausd, opt.hausd);
+        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hgrad, opt.hgrad);
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_angle, int(opt.angle_detection));
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_noswap, int(opt.noswap));
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_noinsert, 1);
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_nomove, 1);
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_nosurf, 1);
+        return true;
+    }
+
+    bool set_metric_values(MMG5_pMesh mesh, MMG5_pSol met, bool volume_mesh,
+                           const double* values, index_t nb_vertices,
+                           index_t dimension, bool parallel) {
+        if (nb_vertices != (index_t) mesh->np) {
+            mmg_log_err("mmg_metric") << nb_vertices << " metric values for "
+                << mesh->np << " vertices, cancel" << std::endl;
+            return false;
+        }
+        if (dimension != 1 && dimension != 6) {
+            mmg_log_err("mmg_metric") << "metric dimension should be 1 (size) or 6 (upper "
+                << "triangular part of the anisotropic metric tensor), got " << dimension << std::endl;
+            return false;
+        }
+        int metric_type = (dimension == 6) ? MMG5_Tensor : MMG5_Scalar;
+        if (met->np != mesh->np || met->type != metric_type) {
+            if (volume_mesh && MMG3D_Set_solSize(mesh,met,MMG5_Vertex,mesh->np,metric_type) != 1) {
+                mmg_log_err("mmg_metric") << "failed to MMG3D_Set_solSize" << std::endl;
+                return false;
+            } else if (!volume_mesh && MMGS_Set_solSize(mesh,met,MMG5_Vertex,mesh->np,metric_type) != 1) {
+                mmg_log_err("mmg_metric") << "failed to MMGS_Set_solSize" << std::endl;
                 return false;
             }
-            GEO::Attribute<double> h_local(M.vertices.attributes(), opt.metric_attribute);
-            if( opt.enable_anisotropy ) {
-                if( h_local.dimension() != 6 )
-                {
-                  Logger::err("mmg_remesh") << opt.metric_attribute << " does not describes the upper "
-                    << " triangular part of the anisotropic metric tensor, cancel" << std::endl;
-                }
-                for(uint v = 0; v < M.vertices.nb(); ++v) {
-                      MMG3D_Set_tensorSol( met, h_local[6*v], h_local[6*v+1], h_local[6*v+2],
-                                                              h_local[6*v+3], h_local[6*v+4],
-                                                                              h_local[6*v+5],
-                                           int(v+1));
+        }
+        if (dimension == 6) {
+            for(uint v = 0; v < nb_vertices; ++v) {
+                const double* m = values + 6*v;
+                if (volume_mesh) {
+                    MMG3D_Set_tensorSol(met, m[0], m[1], m[2], m[3], m[4], m[5], int(v+1));
+                } else {
+                    MMGS_Set_tensorSol(met, m[0], m[1], m[2], m[3], m[4], m[5], int(v+1));
                 }
             }
-            else {
-                for(uint v = 0; v < M.vertices.nb(); ++v) {
-                    met->m[v+1] = h_local[v];
+        } else {
+            for_each_slice(nb_vertices, parallel, [&](index_t from, index_t to) {
+                for(uint v = from; v < to; ++v) {
+                    met->m[v+1] = values[v];
                 }
+            });
+        }
+        return true;
+    }
+
+    bool has_input_metric(const MmgOptions& opt) {
+        return opt.metric_attribute != "no_metric" || opt.curvature_size_map;
+    }
+
+    bool set_input_metric(const Mesh& M, MMG5_pMesh mesh, MMG5_pSol met,
+                          bool volume_mesh, const MmgOptions& opt) {
+        bool ok = false;
+        if (opt.metric_attribute != "no_metric") {
+            ok = set_metric_from_attribute(M, mesh, met, volume_mesh, opt);
+        } else {
+            std::vector<double> values;
+            ok = compute_curvature_size_map(M, opt, values)
+                && (M.vertices.nb() == 0
+                    || set_metric_values(mesh, met, volume_mesh, values.data(), M.vertices.nb(),
+                                         opt.enable_anisotropy ? 6 : 1, opt.parallel_conversion));
+        }
+        if (ok && opt.metric_scale != 1.) {
+            /* the sizes scale as metric_scale, the tensors as its inverse square */
+            double factor = (met->size == 6) ? 1. / (opt.metric_scale * opt.metric_scale) : opt.metric_scale;
+            index_t n = index_t(met->size) * index_t(met->np);
+            for_each_slice(n, opt.parallel_conversion, [&](index_t from, index_t to) {
+                double* m = met->m + met->size;
+                for (index_t i = from; i < to; ++i) {
+                    m[i] *= factor;
+                }
+            });
+        }
+        return ok;
+    }
+
+    bool set_metric_from_attribute(const Mesh& M, MMG5_pMesh mesh,
+                                   MMG5_pSol met, bool volume_mesh,
+                                   const MmgOptions& opt) {
+        if (!M.vertices.attributes().is_defined(opt.metric_attribute)) {
+            mmg_log_err("mmg_metric") << opt.metric_attribute << " is not a vertex attribute, cancel" << std::endl;
+            return false;
+        }
+        GEO::Attribute<double> h_local(M.vertices.attributes(), opt.metric_attribute);
+        if (opt.enable_anisotropy && h_local.dimension() != 6) {
+            mmg_log_err("mmg_metric") << opt.metric_attribute << " does not describes the upper "
+                << " triangular part of the anisotropic metric tensor, cancel" << std::endl;
+            return false;
+        }
+        if (M.vertices.nb() == 0) return true;
+        return set_metric_values(mesh, met, volume_mesh, &h_local[0], M.vertices.nb(),
+                                 opt.enable_anisotropy ? 6 : 1, opt.parallel_conversion);
+    }
+
+    bool reorder_mesh(Mesh& M, const std::string& order) {
+        if (order == "none") return true;
+        if (order != "hilbert" && order != "morton") {
+            mmg_log_err("mmg_reorder") << "unknown order " << order
+                << ", expected none, hilbert or morton" << std::endl;
+            return false;
+        }
+        mesh_reorder(M, order == "hilbert" ? MESH_ORDER_HILBERT : MESH_ORDER_MORTON);
+        return true;
+    }
+
+    const Mesh& reordered_input(const Mesh& M, Mesh& sorted, const MmgOptions& opt) {
+        if (opt.reorder == "none") return M;
+        sorted.copy(M);
+        if (!reorder_mesh(sorted, opt.reorder)) {
+            sorted.clear();
+            return M;
+        }
+        return sorted;
+    }
+
+    bool preflight_failed(const Mesh& M, bool volume_mesh, const MmgOptions& opt) {
+        if (!opt.preflight) return false;
+        MmgPreflightReport report;
+        if (preflight_check(M, volume_mesh, opt, report)) {
+            if (report.nb_inverted > 0 || report.nb_border_edges > 0) {
+                mmg_log_warn("mmg_preflight") << report.to_json() << std::endl;
             }
+            return false;
+        }
+        mmg_log_err("mmg_preflight") << "input rejected, mmg not called: " << report.to_json() << std::endl;
+        monitor_phase(opt, MMG_PHASE_DONE);
+        return true;
+    }
+
+    bool skip_if_good(const Mesh& M, Mesh& M_out, const MmgOptions& opt) {
+        if (opt.skip_min_quality <= 0.) return false;
+        MmgQualityStats quality;
+        if (!compute_mesh_quality(M, opt, quality) || !mesh_meets_target(quality, opt, opt.skip_min_quality)) {
+            return false;
+        }
+        StatsRecorder clock(opt, M);
+        M_out.copy(M);
+        clock.output(M_out);
+        if (opt.stats != NULL) opt.stats->skipped = true;
+        mmg_log_out("mmg_wrapper") << "input meets the target (min quality " << quality.min_quality
+            << "), mmg not called" << std::endl;
+        monitor_phase(opt, MMG_PHASE_DONE);
+        return true;
+    }
+
+    bool mmgs_tri_remesh(const Mesh& M,
+                         Mesh& M_out,
+                         const MmgOptions& opt) {
+        if (preflight_failed(M, false, opt)) return false;
+        if (opt.target_elements > 0 || opt.memory_budget > 0.) {
+            MmgOptions sized = opt;
+            if (!apply_element_budget(M, false, sized)) return false;
+            sized.target_elements = 0;
+            sized.memory_budget = 0.;
+            sized.preflight = false;
+            return mmgs_tri_remesh(M, M_out, sized);
+        }
+        if (opt.isolate) return run_in_worker(M, M_out, opt, mmgs_tri_remesh, "mmgs_remesh");
+        if (skip_if_good(M, M_out, opt)) return true;
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION)) return false;
+        StatsRecorder clock(opt, M);
+        Mesh M_sorted;
+        const Mesh& M_in = reordered_input(M, M_sorted, opt);
+        clock.lap(&MmgPhaseTimes::reorder);
+        MMG5_pMesh mesh = NULL;
+        MMG5_pSol met = NULL;
+        bool ok = geo_to_mmg(M_in, mesh, met, false, opt.enable_anisotropy, opt.edge_attribute, opt.facet_attribute, "no_attribute", opt.parallel_conversion, opt.bulk_conversion);
+        if (!ok) {
+            mmg_log_err("mmgs_remesh") << "failed to convert mesh to MMG5_pMesh" << std::endl;
+            mmgs_free(mesh, met);
+            return false;
         }
 
-        int ier = MMGS_mmgslib(mesh,met);
+        clock.lap(&MmgPhaseTimes::geo_to_mmg);
+
+        /* Set remeshing options */
+        if (!monitor_phase(opt, MMG_PHASE_ANALYSIS)) {
+            mmgs_free(mesh, met);
+            return false;
+        }
+        bool has_metric = has_input_metric(opt);
+        mmgs_set_parameters(mesh, met, opt, has_metric);
+        if (has_metric && !set_input_metric(M_in, mesh, met, false, opt)) {
+            mmgs_free(mesh, met);
+            return false;
+        }
+
+        clock.lap(&MmgPhaseTimes::setup);
+
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING)) {
+            mmgs_free(mesh, met);
+            return false;
+        }
+        int ier = run_mmg(MMG_CALL_MMGSLIB, mesh, met);
+        clock.lap(&MmgPhaseTimes::mmg);
+        clock.mmg_done(ier, mesh);
         if (ier != MMG5_SUCCESS) {
-            Logger::err("mmgs_remesh") << "failed to remesh" << std::endl;
+            mmg_log_err("mmgs_remesh") << "failed to remesh" << std::endl;
             mmgs_free(mesh, met);
             return false;
         }
 
-        ok = mmg_to_geo(mesh, M_out, opt.edge_attribute, opt.facet_attribute);
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION_BACK)) {
+            mmgs_free(mesh, met);
+            return false;
+        }
+        ok = mmg_to_geo(mesh, M_out, opt.edge_attribute, opt.facet_attribute, "no_attribute", opt.parallel_conversion, false, opt.bulk_conversion);
+        clock.lap(&MmgPhaseTimes::mmg_to_geo);
+        connect_output(mesh, M_out, false, opt);
+        clock.lap(&MmgPhaseTimes::connect);
+        ok = ok && transfer_vertex_attributes(M, M_out, opt.transfer_attributes, opt.parallel_conversion);
+        clock.lap(&MmgPhaseTimes::transfer);
+        ok = ok && reorder_mesh(M_out, opt.reorder);
+        clock.lap(&MmgPhaseTimes::reorder);
+        if (ok) clock.output(M_out);
 
         mmgs_free(mesh, met);
+        monitor_phase(opt, MMG_PHASE_DONE);
         return ok;
     }
 
@@ -323,162 +1220,269 @@ namespace OGF {
     bool mmg3d_tet_remesh(const Mesh& M,
                           Mesh& M_out,
                           const MmgOptions& opt) {
+        if (preflight_failed(M, true, opt)) return false;
+        if (opt.target_elements > 0 || opt.memory_budget > 0.) {
+            MmgOptions sized = opt;
+            if (!apply_element_budget(M, true, sized)) return false;
+            sized.target_elements = 0;
+            sized.memory_budget = 0.;
+            sized.preflight = false;
+            return mmg3d_tet_remesh(M, M_out, sized);
+        }
+        if (opt.isolate) return run_in_worker(M, M_out, opt, mmg3d_tet_remesh, "mmg3d_remesh");
+        if (!M.cells.are_simplices() && (opt.parmmg_nb_procs > 0 || opt.nb_subdomains > 1 || has_local_selection(opt))) {
+            mmg_log_err("mmg3d_remesh") << "prisms are only kept by the serial remeshing, "
+                << "set parmmg_nb_procs to 0 and nb_subdomains to 1" << std::endl;
+            return false;
+        }
+        if (skip_if_good(M, M_out, opt)) return true;
+        if (opt.parmmg_nb_procs > 0 || opt.nb_subdomains > 1 || has_local_selection(opt)) {
+            /* Same sequence as the serial path below: input order,
+             * remeshing, transfer, output order. The callee records its
+             * phases in its own stats, nested in these */
+            StatsRecorder clock(opt, M);
+            Mesh M_sorted;
+            const Mesh& M_in = reordered_input(M, M_sorted, opt);
+            clock.lap(&MmgPhaseTimes::reorder);
+            MmgRemeshStats inner_stats;
+            MmgOptions inner_opt = opt;
+            if (opt.stats != NULL) inner_opt.stats = &inner_stats;
+            bool ok = false;
+            if (opt.parmmg_nb_procs > 0) {
+                ok = parmmg_tet_remesh(M_in, M_out, inner_opt);
+            } else {
+                /* remeshing by parts */
+                bool (*remesh)(const Mesh&, Mesh&, const MmgOptions&) =
+                    has_local_selection(opt) ? mmg3d_tet_remesh_local : mmg3d_tet_remesh_parallel;
+                if (opt.curvature_size_map && opt.metric_attribute == "no_metric") {
+                    /* the parts read their sizes from an attribute */
+                    Mesh M_sized;
+                    M_sized.copy(M_in);
+                    MmgOptions opt_sized = inner_opt;
+                    opt_sized.metric_attribute = "mmgig_curvature_size";
+                    opt_sized.curvature_size_map = false;
+                    ok = store_curvature_size_map(M_sized, opt, opt_sized.metric_attribute);
+                    clock.lap(&MmgPhaseTimes::setup);
+                    ok = ok && remesh(M_sized, M_out, opt_sized);
+                    /* the parts wrote the sizes on the output, they are not
+                     * a result */
+                    if (ok && M_out.vertices.attributes().is_defined(opt_sized.metric_attribute)) {
+                        M_out.vertices.attributes().delete_attribute_store(opt_sized.metric_attribute);
+                    }
+                } else {
+                    ok = remesh(M_in, M_out, inner_opt);
+                }
+            }
+            clock.nested(inner_stats);
+            ok = ok && transfer_vertex_attributes(M, M_out, opt.transfer_attributes, opt.parallel_conversion);
+            clock.lap(&MmgPhaseTimes::transfer);
+            ok = ok && reorder_mesh(M_out, opt.reorder);
+            clock.lap(&MmgPhaseTimes::reorder);
+            if (ok) clock.output(M_out);
+            monitor_phase(opt, MMG_PHASE_DONE);
+            return ok;
+        }
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION)) return false;
+        StatsRecorder clock(opt, M);
+        Mesh M_sorted;
+        const Mesh& M_in = reordered_input(M, M_sorted, opt);
+        clock.lap(&MmgPhaseTimes::reorder);
         MMG5_pMesh mesh = NULL;
         MMG5_pSol met = NULL;
-        bool ok = geo_to_mmg(M, mesh, met, true, opt.enable_anisotropy, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute);
+        bool ok = geo_to_mmg(M_in, mesh, met, true, opt.enable_anisotropy, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute, opt.parallel_conversion, opt.bulk_conversion);
         if (!ok) {
-            Logger::err("mmg3d_remesh") << "failed to convert mesh to MMG5_pMesh" << std::endl;
+            mmg_log_err("mmg3d_remesh") << "failed to convert mesh to MMG5_pMesh" << std::endl;
             mmg3d_free(mesh, met);
             return false;
         }
 
+        clock.lap(&MmgPhaseTimes::geo_to_mmg);
+
         /* Set remeshing options */
-        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_angleDetection, opt.angle_value);
-        if (opt.hsiz == 0. || opt.metric_attribute != "no_metric") {
-            MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hmin, opt.hmin);
-            MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hmax, opt.hmax);
-        } else {
-            met->np = 0;
-            MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hsiz, opt.hsiz);
+        if (!monitor_phase(opt, MMG_PHASE_ANALYSIS)) {
+            mmg3d_free(mesh, met);
+            return false;
         }
-        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hausd, opt.hausd);
-        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hgrad, opt.hgrad);
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_angle, int(opt.angle_detection));
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_noswap, int(opt.noswap));
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_noinsert, int(opt.noinsert));
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_nomove, int(opt.nomove));
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_nosurf, int(opt.nosurf));
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_opnbdy, int(opt.opnbdy));
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_optim, int(opt.optim));
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_optimLES, int(opt.optimLES));
-        if (opt.metric_attribute != "no_metric") {
-            if (!M.vertices.attributes().is_defined(opt.metric_attribute)) {
-                Logger::err("mmg3D_remesh") << opt.metric_attribute << " is not a vertex attribute, cancel" << std::endl;
-                return false;
-            }
-            GEO::Attribute<double> h_local(M.vertices.attributes(), opt.metric_attribute);
-            if( opt.enable_anisotropy ) {
-                if( h_local.dimension() != 6 )
-                {
-                  Logger::err("mmg_remesh") << opt.metric_attribute << " does not describes the upper "
-                    << " triangular part of the anisotropic metric tensor, cancel" << std::endl;
-                }
-                for(uint v = 0; v < M.vertices.nb(); ++v) {
-                      MMG3D_Set_tensorSol( met, h_local[6*v], h_local[6*v+1], h_local[6*v+2],
-                                                              h_local[6*v+3], h_local[6*v+4],
-                                                                              h_local[6*v+5],
-                                           int(v+1));
-                }
-            }
-            else {
-                for(uint v = 0; v < M.vertices.nb(); ++v) {
-                    met->m[v+1] = h_local[v];
-                }
-            }
+        bool has_metric = has_input_metric(opt);
+        mmg3d_set_parameters(mesh, met, opt, has_metric);
+        if (has_metric && !set_input_metric(M_in, mesh, met, true, opt)) {
+            mmg3d_free(mesh, met);
+            return false;
         }
 
-        int ier = MMG3D_mmg3dlib(mesh,met);
+        clock.lap(&MmgPhaseTimes::setup);
+
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING)) {
+            mmg3d_free(mesh, met);
+            return false;
+        }
+        int ier = run_mmg(MMG_CALL_MMG3DLIB, mesh, met);
+        clock.lap(&MmgPhaseTimes::mmg);
+        clock.mmg_done(ier, mesh);
         if (ier != MMG5_SUCCESS) {
-            Logger::err("mmg3d_remesh") << "failed to remesh" << std::endl;
+            mmg_log_err("mmg3d_remesh") << "failed to remesh" << std::endl;
             mmg3d_free(mesh, met);
             return false;
         }
 
-        ok = mmg_to_geo(mesh, M_out, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute);
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION_BACK)) {
+            mmg3d_free(mesh, met);
+            return false;
+        }
+        ok = mmg_to_geo(mesh, M_out, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute, opt.parallel_conversion, false, opt.bulk_conversion);
+        clock.lap(&MmgPhaseTimes::mmg_to_geo);
+        connect_output(mesh, M_out, true, opt);
+        clock.lap(&MmgPhaseTimes::connect);
+        ok = ok && transfer_vertex_attributes(M, M_out, opt.transfer_attributes, opt.parallel_conversion);
+        clock.lap(&MmgPhaseTimes::transfer);
+        ok = ok && reorder_mesh(M_out, opt.reorder);
+        clock.lap(&MmgPhaseTimes::reorder);
+        if (ok) clock.output(M_out);
 
         mmg3d_free(mesh, met);
+        monitor_phase(opt, MMG_PHASE_DONE);
         return ok;
     }
 
     bool mmg3d_extract_iso(const Mesh& M, Mesh& M_out, const MmgOptions& opt) {
         if (!opt.level_set || opt.ls_attribute == "no_ls" || !M.vertices.attributes().is_defined(opt.ls_attribute)) {
-            Logger::err("mmg3D_iso") << opt.ls_attribute << " is not a vertex attribute, cancel" << std::endl;
+            mmg_log_err("mmg3D_iso") << opt.ls_attribute << " is not a vertex attribute, cancel" << std::endl;
             return false;
         }
         if (opt.angle_detection) {
-            Logger::warn("mmg3D_iso") << "angle_detection shoud probably be disabled because level set functions are smooth" << std::endl;
+            mmg_log_warn("mmg3D_iso") << "angle_detection shoud probably be disabled because level set functions are smooth" << std::endl;
         }
+        if (preflight_failed(M, true, opt)) return false;
+        if (opt.isolate) return run_in_worker(M, M_out, opt, mmg3d_extract_iso, "mmg3d_iso");
 
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION)) return false;
+        StatsRecorder clock(opt, M);
         MMG5_pMesh mesh = NULL;
         MMG5_pSol met = NULL;
-        bool ok = geo_to_mmg(M, mesh, met, true, opt.enable_anisotropy, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute);
+        bool ok = geo_to_mmg(M, mesh, met, true, opt.enable_anisotropy, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute, opt.parallel_conversion, opt.bulk_conversion);
         if (!ok) {
-            Logger::err("mmg3d_remesh") << "failed to convert mesh to MMG5_pMesh" << std::endl;
+            mmg_log_err("mmg3d_remesh") << "failed to convert mesh to MMG5_pMesh" << std::endl;
             mmg3d_free(mesh, met);
             return false;
         }
         GEO::Attribute<double> ls(M.vertices.attributes(), opt.ls_attribute);
-        for(uint v = 0; v < M.vertices.nb(); ++v) {
-            met->m[v+1] = ls[v];
-        }
-
-        /* Flag border for future deletion */
-        // std::vector<bool> on_border(M.vertices.nb(), false);
-        // for (index_t t = 0; t < M.cells.nb(); ++t) {
-        //     for (index_t lf = 0; lf < M.cells.nb_facets(t); ++lf) {
-        //         if (M.cells.adjacent(t,lf) != GEO::NO_CELL) continue;
-        //         for (index_t lv = 0; lv < M.cells.facet_nb_vertices(t,lf); ++lv) {
-        //             on_border[M.cells.facet_vertex(t,lf,lv)] = true;
-        //         }
-        //     }
-        // }
+        for_each_slice(M.vertices.nb(), opt.parallel_conversion, [&](index_t from, index_t to) {
+            for(uint v = from; v < to; ++v) {
+                met->m[v+1] = ls[v];
+            }
+        });
+        clock.lap(&MmgPhaseTimes::geo_to_mmg);
 
         /* Set remeshing options */
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_iso, 1);
-        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_ls, opt.ls_value);
-        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_angleDetection, opt.angle_value);
-        if (opt.hsiz == 0.) {
-            MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hmin, opt.hmin);
-            MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hmax, opt.hmax);
-        } else {
-            Logger::err("mmg3d_iso") << "should not use hsiz parameter for level set mode" << std::endl;
+        if (!monitor_phase(opt, MMG_PHASE_ANALYSIS) || !mmg3d_set_ls_parameters(mesh, met, opt)) {
             mmg3d_free(mesh, met);
             return false;
         }
-        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hausd, opt.hausd);
-        MMG3D_Set_dparameter(mesh, met, MMG3D_DPARAM_hgrad, opt.hgrad);
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_angle, int(opt.angle_detection));
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_noswap, int(opt.noswap));
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_noinsert, 1);
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_nomove, 1);
-        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_nosurf, 1);
 
-        int ier = MMG3D_mmg3dls(mesh,met);
+        clock.lap(&MmgPhaseTimes::setup);
+
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING)) {
+            mmg3d_free(mesh, met);
+            return false;
+        }
+        int ier = run_mmg(MMG_CALL_MMG3DLS, mesh, met);
+        clock.lap(&MmgPhaseTimes::mmg);
+        clock.mmg_done(ier, mesh);
         if (ier != MMG5_SUCCESS) {
-            Logger::err("mmg3d_iso") << "failed to remesh isovalue" << std::endl;
+            mmg_log_err("mmg3d_iso") << "failed to remesh isovalue" << std::endl;
             mmg3d_free(mesh, met);
             return false;
         }
 
         /* Convert back */
-        ok = mmg_to_geo(mesh, M_out, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute);
-        GEO::Attribute<double> ls_out(M_out.vertices.attributes(), opt.ls_attribute);
-        for(uint v = 0; v < M_out.vertices.nb(); ++v) {
-            ls_out[v] = met->m[v+1];
-        }
-        /* Extract only the border */
-        // M_out.cells.clear(false,false);
-        // M_out.vertices.remove_isolated();
-        // GEO::vector<index_t> to_del(M_out.facets.nb(), 0);
-        // for (index_t f = 0; f < M_out.facets.nb(); ++f) {
-        //     double d = 0;
-        //     bool f_on_border = true;
-        //     for (index_t lv = 0; lv < M_out.facets.nb_vertices(f); ++lv) {
-        //         d = geo_max(d,std::abs(ls_out[M_out.facets.vertex(f,0)] - opt.ls_value));
-        //         if (M_out.facets.vertex(f,lv) < M.vertices.nb()) {
-        //             if (!on_border[M_out.facets.vertex(f,lv)]) f_on_border = false;
-        //         } else {
-        //             f_on_border = false;
-        //         }
-        //     }
-        //     // if (d > 1.1 * opt.hmin) {
-        //     //     to_del[f] = 1;
-        //     // }
-        //     if (f_on_border) to_del[f] = 1;
-        // }
-        // M_out.facets.delete_elements(to_del, true);
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION_BACK)) {
+            mmg3d_free(mesh, met);
+            return false;
+        }
+        /* the adjacency is set by the conversion */
+        ok = mmg_iso_to_geo(mesh, met, M_out, opt);
+        clock.lap(&MmgPhaseTimes::mmg_to_geo);
+        if (ok) clock.output(M_out);
 
         mmg3d_free(mesh, met);
+        monitor_phase(opt, MMG_PHASE_DONE);
+        return ok;
+    }
+
+    bool mmg3d_move(const Mesh& M, Mesh& M_out, const MmgOptions& opt) {
+        if (!Attribute<double>::is_defined(M.vertices.attributes(), opt.displacement_attribute, 3)) {
+            mmg_log_err("mmg3d_move") << opt.displacement_attribute
+                << " is not a double vertex attribute of dimension 3, cancel" << std::endl;
+            return false;
+        }
+        if (opt.lagrangian_mode > 2) {
+            mmg_log_err("mmg3d_move") << "lagrangian_mode should be 0, 1 or 2" << std::endl;
+            return false;
+        }
+        if (preflight_failed(M, true, opt)) return false;
+        if (opt.isolate) return run_in_worker(M, M_out, opt, mmg3d_move, "mmg3d_move");
+
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION)) return false;
+        StatsRecorder clock(opt, M);
+        MMG5_pMesh mesh = NULL;
+        MMG5_pSol met = NULL;
+        MMG5_pSol disp = NULL;
+        bool ok = geo_to_mmg(M, mesh, met, true, opt.enable_anisotropy, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute, opt.parallel_conversion, opt.bulk_conversion, &disp);
+        /* mmg allocated the displacement with the mesh, Set_solSize sizes it */
+        auto move_free = [&]() {
+            MMG3D_Free_all(MMG5_ARG_start, MMG5_ARG_ppMesh,&mesh, MMG5_ARG_ppMet,&met,
+                           MMG5_ARG_ppDisp,&disp, MMG5_ARG_end);
+        };
+        if (!ok || MMG3D_Set_solSize(mesh, disp, MMG5_Vertex, mesh->np, MMG5_Vector) != 1) {
+            mmg_log_err("mmg3d_move") << "failed to convert mesh to MMG5_pMesh" << std::endl;
+            move_free();
+            return false;
+        }
+        Attribute<double> displacement(M.vertices.attributes(), opt.displacement_attribute);
+        const double* d = (M.vertices.nb() > 0) ? &displacement[0] : NULL;
+        for_each_slice(M.vertices.nb(), opt.parallel_conversion, [&](index_t from, index_t to) {
+            std::copy(d + 3 * from, d + 3 * to, disp->m + 3 * (from + 1));
+        });
+        clock.lap(&MmgPhaseTimes::geo_to_mmg);
+
+        if (!monitor_phase(opt, MMG_PHASE_ANALYSIS)) {
+            move_free();
+            return false;
+        }
+        bool has_metric = has_input_metric(opt);
+        mmg3d_set_parameters(mesh, met, opt, has_metric);
+        MMG3D_Set_iparameter(mesh, met, MMG3D_IPARAM_lag, int(opt.lagrangian_mode));
+        if (has_metric && !set_input_metric(M, mesh, met, true, opt)) {
+            move_free();
+            return false;
+        }
+        clock.lap(&MmgPhaseTimes::setup);
+
+        if (!monitor_phase(opt, MMG_PHASE_REMESHING)) {
+            move_free();
+            return false;
+        }
+        int ier = run_mmg(MMG_CALL_MMG3DMOV, mesh, met, disp);
+        clock.lap(&MmgPhaseTimes::mmg);
+        clock.mmg_done(ier, mesh);
+        if (ier != MMG5_SUCCESS) {
+            mmg_log_err("mmg3d_move") << "failed to move the mesh (is mmg built with USE_ELAS?)" << std::endl;
+            move_free();
+            return false;
+        }
+
+        if (!monitor_phase(opt, MMG_PHASE_CONVERSION_BACK)) {
+            move_free();
+            return false;
+        }
+        ok = mmg_to_geo(mesh, M_out, opt.edge_attribute, opt.facet_attribute, opt.cell_attribute, opt.parallel_conversion, false, opt.bulk_conversion);
+        clock.lap(&MmgPhaseTimes::mmg_to_geo);
+        connect_output(mesh, M_out, true, opt);
+        clock.lap(&MmgPhaseTimes::connect);
+        if (ok) clock.output(M_out);
+
+        move_free();
+        monitor_phase(opt, MMG_PHASE_DONE);
         return ok;
     }
 }
@@ -44,6 +44,12 @@
 
 #include <OGF/mmgig/common/common.h>
 
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
 namespace GEO {
     class Mesh;
 }
@@ -52,6 +58,126 @@ namespace OGF {
 
     bool mmg_wrapper_test_geo2mmg2geo(const Mesh& M_in, Mesh& M_out);
 
+    /* Phases of a remeshing job. Analysis covers the parameters and metric
+     * setup, the mmg analysis itself runs inside the remeshing phase */
+    enum MmgPhase {
+        MMG_PHASE_IDLE,
+        MMG_PHASE_CONVERSION,
+        MMG_PHASE_ANALYSIS,
+        MMG_PHASE_REMESHING,
+        MMG_PHASE_CONVERSION_BACK,
+        MMG_PHASE_DONE
+    };
+
+    mmgig_API const char* mmg_phase_name(MmgPhase phase);
+
+    /* Shared between a remeshing job and the thread watching it. The mmg
+     * calls cannot be interrupted, a cancel request is honored at the next
+     * phase change */
+    struct MmgMonitor {
+        std::atomic<int> phase;
+        std::atomic<bool> cancel_requested;
+        MmgMonitor() : phase(MMG_PHASE_IDLE), cancel_requested(false) {
+        }
+    };
+
+    /* One line logged by the wrappers while an MmgLogScope is active */
+    struct MmgLogMessage {
+        enum Level {
+            OUT,
+            WARN,
+            ERR
+        };
+        Level level;
+        std::string tag;
+        std::string text; /* without the final newline */
+    };
+
+    /**
+     * \brief The messages of wrapper calls running on a worker thread.
+     * \details The Logger and its clients (the GUI console) are not meant
+     *   to be fed from other threads. The worker adds the messages here,
+     *   the thread that owns the Logger writes them with flush().
+     */
+    class mmgig_API MmgLogBuffer {
+    public:
+        void add(MmgLogMessage::Level level, const std::string& tag, const std::string& text);
+
+        /* Moves the pending messages to messages */
+        void take(std::vector<MmgLogMessage>& messages);
+
+        /* Writes the pending messages to the Logger and forgets them */
+        void flush();
+
+    private:
+        std::mutex mutex_;
+        std::vector<MmgLogMessage> messages_;
+    };
+
+    /* While alive, the mmg_log_* streams of the calling thread go to buffer
+     * (NULL for the Logger). Restores the previous buffer on destruction */
+    class mmgig_API MmgLogScope {
+    public:
+        explicit MmgLogScope(MmgLogBuffer* buffer);
+        ~MmgLogScope();
+
+        /* The buffer of the calling thread, NULL if none */
+        static MmgLogBuffer* current();
+
+    private:
+        MmgLogScope(const MmgLogScope&);
+        MmgLogScope& operator=(const MmgLogScope&);
+
+        MmgLogBuffer* previous_;
+    };
+
+    /* Logger::out(), warn() and err(), or the MmgLogBuffer of the calling
+     * thread. A message ends with std::endl */
+    mmgig_API std::ostream& mmg_log_out(const std::string& tag);
+    mmgig_API std::ostream& mmg_log_warn(const std::string& tag);
+    mmgig_API std::ostream& mmg_log_err(const std::string& tag);
+
+    /* Wall-clock time (s) of the phases of a wrapper call */
+    struct MmgPhaseTimes {
+        double geo_to_mmg = 0.;
+        double setup = 0.; /* mmg parameters and metric */
+        double mmg = 0.; /* the mmg library call */
+        double mmg_to_geo = 0.; /* without connect() */
+        double connect = 0.;
+        double transfer = 0.; /* see MmgOptions::transfer_attributes */
+        double reorder = 0.; /* see MmgOptions::reorder */
+        double total = 0.;
+    };
+
+    /* Statistics of a wrapper call, see MmgOptions::stats. mmg does not
+     * expose its operation counts (insertions, collapses, swaps are only
+     * printed by its adaptation loops at high verbosity), the element counts
+     * are reported instead */
+    struct MmgRemeshStats {
+        MmgPhaseTimes times;
+        index_t nb_vertices_in = 0;
+        index_t nb_edges_in = 0;
+        index_t nb_triangles_in = 0;
+        index_t nb_tets_in = 0;
+        index_t nb_vertices_out = 0;
+        index_t nb_edges_out = 0;
+        index_t nb_triangles_out = 0;
+        index_t nb_tets_out = 0;
+        int mmg_return_code = -1; /* MMG5_SUCCESS, MMG5_LOWFAILURE or MMG5_STRONGFAILURE, -1 if not called */
+        size_t mmg_memory = 0; /* bytes allocated by mmg for the mesh after the call */
+        size_t peak_memory = 0; /* peak memory of the process (bytes) */
+        bool skipped = false; /* input copied, see MmgOptions::skip_min_quality */
+        bool success = false;
+
+        /* nb_vertices_out / nb_vertices_in, to catch runaway refinement */
+        double vertex_ratio() const {
+            return nb_vertices_in == 0 ? 0. : double(nb_vertices_out) / double(nb_vertices_in);
+        }
+
+        /* One line JSON object, for the job logs */
+        std::string to_json() const;
+    };
+
     /* See MmgTools documentation for interpreation
      *  https://www.mmgtools.org/mmg-remesher-try-mmg/mmg-remesher-options
      */
@@ -73,21 +199,141 @@ namespace OGF {
         bool nomove = false;
         bool nosurf = false;
         std::string metric_attribute = "no_metric";
+        /* Without metric_attribute: sizes from the surface curvature and
+         * hausd, see compute_curvature_size_map() */
+        bool curvature_size_map = false;
+        /* Multiplies the sizes of metric_attribute or of the curvature size
+         * map (tensors are divided by its square) */
+        double metric_scale = 1.;
+        /* Element count mode: if > 0, mmgs_tri_remesh() and
+         * mmg3d_tet_remesh() scale the sizes (metric_scale, or hsiz without
+         * a metric) so that the output has about this many elements, see
+         * estimate_element_count() */
+        index_t target_elements = 0;
+        /* GB, 0 for no limit: the same wrappers refuse the call when the
+         * estimated memory of the remeshing is over it */
+        double memory_budget = 0.;
         /* Level set extraction */
         bool level_set = false;
         std::string ls_attribute = "no_ls";
         double ls_value = 0.;
+        /* Output of mmg3d_extract_iso(): "volume" (all the tets), "surface"
+         * (the isosurface triangles only), "interior" or "exterior" (the
+         * tets on one side, ls below or above ls_value, with the isosurface
+         * triangles). Only the kept elements are converted back. */
+        std::string iso_output = "volume";
+        /* Lagrangian motion (mmg3d_move) */
+        std::string displacement_attribute = "no_attribute"; /* double vertex attribute of dimension 3 */
+        index_t lagrangian_mode = 1; /* 0: move only, 1: and swap/move, 2: and collapse/split */
         /* Attribute support (type must be 'int') */
         std::string edge_attribute = "no_attribute";
         std::string facet_attribute = "no_attribute";
         std::string cell_attribute = "no_attribute";
+        /* Conversion GEO::Mesh <-> MMG5_pMesh */
+        bool parallel_conversion = true; /* split the copy loops across threads */
+        bool bulk_conversion = true; /* read/write geogram's contiguous arrays directly */
+        /* Check the input with preflight_check() first, the call fails
+         * with its report instead of giving a bad mesh to mmg */
+        bool preflight = true;
+        /* Adjacency of the output: "mmg" copies mmg's own adjacency (falls
+         * back to "connect" if unavailable), "connect" rebuilds it with
+         * geogram, "none" leaves it to the caller, e.g. for a mesh that is
+         * only saved to disk */
+        std::string output_adjacency = "mmg";
+        /* Order of the vertices and elements given to mmg and of the
+         * output, along a space-filling curve: "none", "hilbert" or
+         * "morton", see GEO::mesh_reorder(). The input is copied first */
+        std::string reorder = "none";
+        /* If > 0, mmgs_tri_remesh() and mmg3d_tet_remesh() copy the input
+         * instead of calling mmg when its elements all have at least this
+         * quality and its edges the target sizes, see mesh_meets_target() */
+        double skip_min_quality = 0.;
+        /* Vertex attributes (double, any dimension) of the input interpolated
+         * at the output vertices: comma separated names, or "all" */
+        std::string transfer_attributes = "no_attribute";
+        /* Domain decomposition (mmg3d only) */
+        index_t nb_subdomains = 0; /* parts remeshed concurrently, 0 or 1 for a single mmg3d call */
+        index_t nb_interface_passes = 1; /* passes around the moved interfaces */
+        index_t interface_layers = 3; /* number of cell layers the interfaces are moved by */
+        /* Local remeshing (mmg3d only): with a selection, only the selected
+         * cells and local_buffer_layers layers of cells around them are
+         * remeshed, the other cells are kept as is. The selection is the
+         * union of the criteria that are set */
+        std::string local_cell_attribute = "no_attribute"; /* int cell attribute, cells != 0 */
+        std::string local_box = ""; /* "xmin ymin zmin xmax ymax zmax", cells with a vertex inside */
+        double local_min_quality = 0.; /* cells of lower quality, see compute_mesh_quality() */
+        index_t local_buffer_layers = 2;
+        /* ParMmg backend (mmg3d only), run with a local MPI job */
+        index_t parmmg_nb_procs = 0; /* MPI processes, 0 to use mmg3d in this process */
+        std::string parmmg_executable = ""; /* default: found by CMake, or parmmg_O3 */
+        std::string mpiexec_executable = ""; /* default: found by CMake, or mpirun */
+        /* Crash isolation (Linux): the wrappers run in a forked worker
+         * process that reads the input copy-on-write and returns the
+         * result through shared memory. A crash, an allocation failure or
+         * the limits below make the call fail instead of the process, and
+         * a cancel request stops mmg. Only the double, int, index_t, char
+         * and bool attributes of the result come back */
+        bool isolate = false;
+        double worker_timeout = 0.; /* seconds, 0 for no limit */
+        double worker_memory_limit = 0.; /* GB the worker may allocate, 0 for no limit */
+        /* Progress reporting and cancellation, may be NULL */
+        MmgMonitor* monitor = NULL;
+        /* Filled with the statistics of the call, may be NULL */
+        MmgRemeshStats* stats = NULL;
     };
 
+    /* Sets the field of opt named key (e.g. "hausd", "noinsert") from its
+     * text value. Returns false and logs if the key is unknown or the value
+     * cannot be parsed. The monitor cannot be set this way */
+    bool mmgig_API mmg_options_set(MmgOptions& opt, const std::string& key, const std::string& value);
+
+    /* Reads "key = value" lines, '#' starts a comment */
+    bool mmgig_API mmg_options_load(MmgOptions& opt, const std::string& filename);
+
     bool mmgig_API mmgs_tri_remesh(const Mesh& M, Mesh& M_out, const MmgOptions& opt);
 
     bool mmgig_API mmg3d_tet_remesh(const Mesh& M, Mesh& M_out, const MmgOptions& opt);
 
+    /* Remeshes opt.nb_subdomains parts of the tet mesh concurrently, with the
+     * faces between parts frozen, then moves the interfaces and remeshes the
+     * cells around them again. Called by mmg3d_tet_remesh() when
+     * opt.nb_subdomains > 1 */
+    bool mmgig_API mmg3d_tet_remesh_parallel(const Mesh& M, Mesh& M_out, const MmgOptions& opt);
+
+    /* Remeshes the cells selected by opt.local_* and a buffer around them,
+     * the connected components of the region running concurrently, and
+     * splices them back with the other cells unchanged. Called by
+     * mmg3d_tet_remesh() when a local selection is set */
+    bool mmgig_API mmg3d_tet_remesh_local(const Mesh& M, Mesh& M_out, const MmgOptions& opt);
+
+    /* Runs ParMmg with opt.parmmg_nb_procs MPI processes on this machine and
+     * gathers the result. The meshes are exchanged through Medit files in a
+     * temporary directory. Called by mmg3d_tet_remesh() when
+     * opt.parmmg_nb_procs > 0 */
+    bool mmgig_API parmmg_tet_remesh(const Mesh& M, Mesh& M_out, const MmgOptions& opt);
+
     bool mmgig_API mmg3d_extract_iso(const Mesh& M, Mesh& M_out, const MmgOptions& opt);
+
+    /* Moves the tet mesh by the displacement of opt.displacement_attribute
+     * with MMG3D_mmg3dmov, which only swaps, collapses or splits where the
+     * motion degrades the elements (opt.lagrangian_mode). The displacement
+     * of the interior vertices is extended from the boundary one by linear
+     * elasticity, mmg must be built with USE_ELAS. M_out is the moved mesh,
+     * opt.transfer_attributes, opt.reorder and opt.skip_min_quality are not
+     * applied */
+    bool mmgig_API mmg3d_move(const Mesh& M, Mesh& M_out, const MmgOptions& opt);
+
+    /* mmg3d_extract_iso() for each of ls_values (opt.ls_value is ignored),
+     * M_out[i] receiving the result of ls_values[i]. M is converted once,
+     * the levels run concurrently on copies of the mmg mesh, at most one per
+     * core. Usually called with opt.iso_output = "surface" */
+    bool mmgig_API mmg3d_extract_iso_levels(const Mesh& M, const std::vector<double>& ls_values,
+                                            const std::vector<Mesh*>& M_out, const MmgOptions& opt);
+
+    /* Concatenates the levels in M_out, with the index of the level of each
+     * facet (and cell) in the int attribute level_attribute */
+    void mmgig_API merge_iso_levels(const std::vector<Mesh*>& levels, Mesh& M_out,
+                                    const std::string& level_attribute = "iso_level");
         
 }
 
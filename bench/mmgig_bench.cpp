@@ -0,0 +1,507 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+/*
+ * Benchmark of the wrappers on synthetic inputs of increasing size. Each run
+ * reports its MmgRemeshStats (phase times, counts) and the peak RSS as JSON.
+ *
+ *   mmgig_bench [sizes=8,16,32] [cases=all] [repeat=1] [output=file.json]
+ *               [any MmgOptions field, e.g. parallel_conversion=0]
+ */
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+#include <OGF/mmgig/algo/mmg_conversion.h>
+
+#include <geogram/basic/common.h>
+#include <geogram/basic/command_line.h>
+#include <geogram/basic/command_line_args.h>
+#include <geogram/basic/logger.h>
+#include <geogram/basic/attributes.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace {
+    using namespace OGF;
+
+    /* Regular grid of n^3 cubes in [0,1]^3, each split in 6 tets around the
+     * main diagonal (conforming across cubes), with the boundary triangles */
+    void make_tet_cube(Mesh& M, index_t n) {
+        M.clear();
+        index_t nv = n + 1;
+        M.vertices.create_vertices(nv * nv * nv);
+        for (index_t k = 0; k < nv; ++k) {
+            for (index_t j = 0; j < nv; ++j) {
+                for (index_t i = 0; i < nv; ++i) {
+                    double* p = M.vertices.point_ptr((k * nv + j) * nv + i);
+                    p[0] = double(i) / double(n);
+                    p[1] = double(j) / double(n);
+                    p[2] = double(k) / double(n);
+                }
+            }
+        }
+        const index_t axis_order[6][3] = {
+            {0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0}
+        };
+        M.cells.create_tets(6 * n * n * n);
+        index_t t = 0;
+        for (index_t k = 0; k < n; ++k) {
+            for (index_t j = 0; j < n; ++j) {
+                for (index_t i = 0; i < n; ++i) {
+                    for (index_t o = 0; o < 6; ++o) {
+                        index_t c[3] = {i, j, k};
+                        index_t tet[4];
+                        tet[0] = (c[2] * nv + c[1]) * nv + c[0];
+                        for (index_t s = 0; s < 3; ++s) {
+                            ++c[axis_order[o][s]];
+                            tet[s+1] = (c[2] * nv + c[1]) * nv + c[0];
+                        }
+                        vec3 p0(M.vertices.point_ptr(tet[0]));
+                        vec3 p1(M.vertices.point_ptr(tet[1]));
+                        vec3 p2(M.vertices.point_ptr(tet[2]));
+                        vec3 p3(M.vertices.point_ptr(tet[3]));
+                        if (Geom::tetra_signed_volume(p0, p1, p2, p3) < 0.) {
+                            std::swap(tet[2], tet[3]);
+                        }
+                        for (index_t lv = 0; lv < 4; ++lv) {
+                            M.cells.set_vertex(t, lv, tet[lv]);
+                        }
+                        ++t;
+                    }
+                }
+            }
+        }
+        M.cells.connect();
+        M.cells.compute_borders();
+    }
+
+    /* The cube grid mapped radially onto the unit ball */
+    void make_tet_sphere(Mesh& M, index_t n) {
+        make_tet_cube(M, n);
+        for (index_t v = 0; v < M.vertices.nb(); ++v) {
+            double* p = M.vertices.point_ptr(v);
+            double x = 2. * p[0] - 1.;
+            double y = 2. * p[1] - 1.;
+            double z = 2. * p[2] - 1.;
+            double r = std::sqrt(x * x + y * y + z * z);
+            double s = (r > 0.) ? geo_max(std::fabs(x), geo_max(std::fabs(y), std::fabs(z))) / r : 0.;
+            p[0] = s * x;
+            p[1] = s * y;
+            p[2] = s * z;
+        }
+    }
+
+    /* Boundary of the tet cube: 12 sharp edges and 8 corners */
+    void make_cube_surface(Mesh& M, index_t n) {
+        make_tet_cube(M, n);
+        M.cells.clear();
+        M.vertices.remove_isolated();
+        M.facets.connect();
+    }
+
+    /* Signed distance to a sphere of radius 0.3 and a gyroid, on the tet cube */
+    void make_level_set(Mesh& M, index_t n, bool gyroid) {
+        make_tet_cube(M, n);
+        Attribute<double> ls(M.vertices.attributes(), "ls");
+        for (index_t v = 0; v < M.vertices.nb(); ++v) {
+            const double* p = M.vertices.point_ptr(v);
+            if (gyroid) {
+                double x = 4. * M_PI * p[0];
+                double y = 4. * M_PI * p[1];
+                double z = 4. * M_PI * p[2];
+                ls[v] = std::sin(x) * std::cos(y) + std::sin(y) * std::cos(z) + std::sin(z) * std::cos(x);
+            } else {
+                double dx = p[0] - 0.5;
+                double dy = p[1] - 0.5;
+                double dz = p[2] - 0.5;
+                ls[v] = std::sqrt(dx * dx + dy * dy + dz * dz) - 0.3;
+            }
+        }
+    }
+
+    /* Peak resident set size since the last reset. On Linux the high water
+     * mark is reset before each run, elsewhere it is the process peak */
+    void reset_peak_rss() {
+#ifdef GEO_OS_LINUX
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        if (clear_refs) clear_refs << "5";
+#endif
+    }
+
+    size_t peak_rss() {
+#ifdef GEO_OS_LINUX
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmHWM:") == 0) {
+                return size_t(atol(line.c_str() + 6)) * 1024;
+            }
+        }
+#endif
+        return Process::max_used_memory();
+    }
+
+    struct BenchCase {
+        const char* name;
+        const char* wrapper;
+    };
+
+    const BenchCase bench_cases[] = {
+        { "tet_cube", "mmg3d_tet_remesh" },
+        { "tet_sphere", "mmg3d_tet_remesh" },
+        { "cube_surface", "mmgs_tri_remesh" },
+        { "ls_sphere", "mmg3d_extract_iso" },
+        { "ls_gyroid", "mmg3d_extract_iso" },
+        { "move_cube", "mmg3d_move" },
+        { "displaced_cube", "mmg3d_tet_remesh" },
+        { "conversion", "geo_to_mmg/mmg_to_geo" },
+        { "reorder", "mmg3d_tet_remesh" },
+        { "local_cube", "mmg3d_tet_remesh_local" }
+    };
+
+    /* A smooth shear of the tet cube as a displacement attribute, moved by
+     * mmg3d_move (move_cube) or applied before a full remesh (displaced_cube)
+     * to compare the per-step cost of both */
+    void make_displacement(Mesh& M, index_t n, bool apply) {
+        make_tet_cube(M, n);
+        Attribute<double> displacement;
+        displacement.create_vector_attribute(M.vertices.attributes(), "displacement", 3);
+        for (index_t v = 0; v < M.vertices.nb(); ++v) {
+            double* p = M.vertices.point_ptr(v);
+            displacement[3 * v] = 0.1 * std::sin(M_PI * p[1]) * std::sin(M_PI * p[2]);
+            displacement[3 * v + 1] = 0.;
+            displacement[3 * v + 2] = 0.;
+            if (apply) {
+                p[0] += displacement[3 * v];
+            }
+        }
+    }
+
+    void make_input(const std::string& name, index_t n, Mesh& M) {
+        if (name == "tet_cube") make_tet_cube(M, n);
+        else if (name == "tet_sphere") make_tet_sphere(M, n);
+        else if (name == "cube_surface") make_cube_surface(M, n);
+        else if (name == "ls_sphere") make_level_set(M, n, false);
+        else if (name == "ls_gyroid") make_level_set(M, n, true);
+        else if (name == "move_cube") make_displacement(M, n, false);
+        else if (name == "displaced_cube") make_displacement(M, n, true);
+    }
+
+    void write_run(std::ostream& out, const BenchCase& bc, index_t n, index_t run,
+            bool ok, const MmgRemeshStats& stats, size_t rss) {
+        out << "    {\"case\": \"" << bc.name << "\", \"wrapper\": \"" << bc.wrapper << "\""
+            << ", \"n\": " << n << ", \"run\": " << run
+            << ", \"ok\": " << (ok ? "true" : "false")
+            << ", \"peak_rss_bytes\": " << rss
+            << ",\n     \"stats\": " << stats.to_json() << "}";
+    }
+
+    /* Conversion round trip of the tet cube, without mmg, with the bulk
+     * path and with the per-element accessors. sizes=216 gives 10M vertices
+     * and 60M tets (about 10 GB) */
+    void bench_conversion(std::ostream& out, bool& first, index_t n, index_t run, const MmgOptions& opt) {
+        Mesh M;
+        make_tet_cube(M, n);
+        for (index_t b = 0; b < 2; ++b) {
+            bool bulk = (b == 1);
+            reset_peak_rss();
+            Stopwatch W("conversion", false);
+            MMG5_pMesh mesh = NULL;
+            MMG5_pSol met = NULL;
+            bool ok = geo_to_mmg(M, mesh, met, true, false, "no_attribute", "no_attribute",
+                                 "no_attribute", opt.parallel_conversion, bulk);
+            double t_to_mmg = W.elapsed_time();
+            Mesh M_out;
+            ok = ok && mmg_to_geo(mesh, M_out, "no_attribute", "no_attribute", "no_attribute",
+                                  opt.parallel_conversion, false, bulk);
+            double t_to_geo = W.elapsed_time() - t_to_mmg;
+            mmg3d_free(mesh, met);
+            size_t rss = peak_rss();
+            out << (first ? "" : ",\n");
+            out << "    {\"case\": \"conversion\", \"bulk\": " << (bulk ? "true" : "false")
+                << ", \"n\": " << n << ", \"run\": " << run
+                << ", \"ok\": " << (ok ? "true" : "false")
+                << ", \"vertices\": " << M.vertices.nb() << ", \"tets\": " << M.cells.nb()
+                << ", \"times\": {\"geo_to_mmg\": " << t_to_mmg << ", \"mmg_to_geo\": " << t_to_geo << "}"
+                << ", \"peak_rss_bytes\": " << rss << "}";
+            first = false;
+            Logger::out("mmgig_bench") << "conversion n=" << n << (bulk ? " bulk" : " per element")
+                << ": geo_to_mmg " << t_to_mmg << " s, mmg_to_geo " << t_to_geo << " s" << std::endl;
+        }
+    }
+
+    /* The tet cube with its vertices and cells in random order, as a mesh
+     * that went through unrelated edits */
+    void make_shuffled_cube(Mesh& M, index_t n) {
+        make_tet_cube(M, n);
+        std::mt19937 random(12345);
+        GEO::vector<index_t> permutation(M.vertices.nb());
+        for (index_t v = 0; v < permutation.size(); ++v) permutation[v] = v;
+        std::shuffle(permutation.begin(), permutation.end(), random);
+        M.vertices.permute_elements(permutation);
+        permutation.resize(M.cells.nb());
+        for (index_t c = 0; c < permutation.size(); ++c) permutation[c] = c;
+        std::shuffle(permutation.begin(), permutation.end(), random);
+        M.cells.permute_elements(permutation);
+    }
+
+    /* Traversals of a result by its consumers: a solver-like gather/scatter
+     * over the cells (assembly, smoothing) and a renderer-like pass over
+     * the boundary triangles accumulating vertex normals */
+    double time_solver_traversal(const Mesh& M, index_t nb_sweeps) {
+        Stopwatch W("solver", false);
+        std::vector<double> value(M.vertices.nb(), 1.);
+        std::vector<double> next(M.vertices.nb());
+        for (index_t s = 0; s < nb_sweeps; ++s) {
+            std::fill(next.begin(), next.end(), 0.);
+            for (index_t c = 0; c < M.cells.nb(); ++c) {
+                double sum = 0.;
+                for (index_t lv = 0; lv < 4; ++lv) sum += value[M.cells.vertex(c, lv)];
+                for (index_t lv = 0; lv < 4; ++lv) next[M.cells.vertex(c, lv)] += 0.25 * sum;
+            }
+            value.swap(next);
+        }
+        return W.elapsed_time();
+    }
+
+    double time_render_traversal(const Mesh& M, index_t nb_frames) {
+        Stopwatch W("render", false);
+        std::vector<vec3> normals(M.vertices.nb());
+        for (index_t frame = 0; frame < nb_frames; ++frame) {
+            std::fill(normals.begin(), normals.end(), vec3(0., 0., 0.));
+            for (index_t f = 0; f < M.facets.nb(); ++f) {
+                index_t v0 = M.facets.vertex(f, 0);
+                index_t v1 = M.facets.vertex(f, 1);
+                index_t v2 = M.facets.vertex(f, 2);
+                vec3 p0(M.vertices.point_ptr(v0));
+                vec3 n = cross(vec3(M.vertices.point_ptr(v1)) - p0, vec3(M.vertices.point_ptr(v2)) - p0);
+                normals[v0] += n;
+                normals[v1] += n;
+                normals[v2] += n;
+            }
+        }
+        return W.elapsed_time();
+    }
+
+    /* mmg3d_tet_remesh() of the shuffled cube without and with the
+     * space-filling curve reordering of MmgOptions::reorder, then the
+     * traversals of each result */
+    void bench_reorder(std::ostream& out, bool& first, index_t n, index_t run, const MmgOptions& opt) {
+        const char* orders[3] = { "none", "hilbert", "morton" };
+        for (const char* order : orders) {
+            Mesh M;
+            make_shuffled_cube(M, n);
+            MmgOptions run_opt = opt;
+            MmgRemeshStats stats;
+            run_opt.stats = &stats;
+            run_opt.hsiz = 1. / double(n);
+            run_opt.reorder = order;
+            Mesh M_out;
+            bool ok = mmg3d_tet_remesh(M, M_out, run_opt);
+            double t_solver = ok ? time_solver_traversal(M_out, 10) : 0.;
+            double t_render = ok ? time_render_traversal(M_out, 10) : 0.;
+            out << (first ? "" : ",\n");
+            first = false;
+            out << "    {\"case\": \"reorder\", \"order\": \"" << order << "\""
+                << ", \"n\": " << n << ", \"run\": " << run
+                << ", \"ok\": " << (ok ? "true" : "false")
+                << ", \"traversal\": {\"solver\": " << t_solver << ", \"render\": " << t_render << "}"
+                << ",\n     \"stats\": " << stats.to_json() << "}";
+            Logger::out("mmgig_bench") << "reorder=" << order << " n=" << n << ": mmg " << stats.times.mmg
+                << " s, reorder " << stats.times.reorder << " s, solver " << t_solver
+                << " s, render " << t_render << " s" << std::endl;
+        }
+    }
+
+    /* Local remeshing of a centered box of 2% of the volume of the tet
+     * cube, against a plain copy of the cube: the cost beyond the copy is
+     * what the selection, the parts and the splicing add. sizes=172 gives
+     * 5M vertices and 30M tets */
+    void bench_local(std::ostream& out, bool& first, index_t n, index_t run, const MmgOptions& opt) {
+        Mesh M;
+        make_tet_cube(M, n);
+        Stopwatch W_copy("copy", false);
+        Mesh M_copy;
+        M_copy.copy(M);
+        double t_copy = W_copy.elapsed_time();
+        M_copy.clear();
+
+        MmgOptions run_opt = opt;
+        MmgRemeshStats stats;
+        run_opt.stats = &stats;
+        run_opt.hsiz = 1. / double(n);
+        run_opt.local_box = "0.365 0.365 0.365 0.635 0.635 0.635";
+        Mesh M_out;
+        reset_peak_rss();
+        Stopwatch W("local", false);
+        bool ok = mmg3d_tet_remesh(M, M_out, run_opt);
+        double t_local = W.elapsed_time();
+        size_t rss = peak_rss();
+        out << (first ? "" : ",\n");
+        first = false;
+        out << "    {\"case\": \"local_cube\", \"n\": " << n << ", \"run\": " << run
+            << ", \"ok\": " << (ok ? "true" : "false")
+            << ", \"tets\": " << M.cells.nb()
+            << ", \"times\": {\"local\": " << t_local << ", \"copy\": " << t_copy << "}"
+            << ", \"peak_rss_bytes\": " << rss
+            << ",\n     \"stats\": " << stats.to_json() << "}";
+        Logger::out("mmgig_bench") << "local_cube n=" << n << " (" << M.cells.nb() << " tets): "
+            << t_local << " s, copy " << t_copy << " s" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    GEO::initialize();
+    GEO::CmdLine::import_arg_group("standard");
+
+    std::vector<index_t> sizes;
+    std::string cases = "all";
+    index_t repeat = 1;
+    std::string output = "mmgig_bench.json";
+    MmgOptions opt;
+    opt.hausd = 0.01;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            Logger::err("mmgig_bench") << "expected key=value, got " << arg << std::endl;
+            return 1;
+        }
+        std::string key = arg.substr(0, eq);
+        std::string value = arg.substr(eq + 1);
+        if (key == "sizes") {
+            std::istringstream in(value);
+            std::string item;
+            while (std::getline(in, item, ',')) {
+                sizes.push_back(index_t(atoi(item.c_str())));
+            }
+        } else if (key == "cases") {
+            cases = value;
+        } else if (key == "repeat") {
+            repeat = geo_max(index_t(atoi(value.c_str())), index_t(1));
+        } else if (key == "output") {
+            output = value;
+        } else if (!mmg_options_set(opt, key, value)) {
+            return 1;
+        }
+    }
+    if (sizes.empty()) {
+        sizes.push_back(8);
+        sizes.push_back(16);
+        sizes.push_back(32);
+    }
+
+    std::ofstream out(output.c_str());
+    if (!out) {
+        Logger::err("mmgig_bench") << "cannot write " << output << std::endl;
+        return 1;
+    }
+    out << "{\n  \"nb_cores\": " << Process::number_of_cores()
+        << ",\n  \"parallel_conversion\": " << (opt.parallel_conversion ? "true" : "false")
+        << ",\n  \"runs\": [\n";
+    bool first = true;
+    for (const BenchCase& bc: bench_cases) {
+        if (cases != "all" && ("," + cases + ",").find("," + std::string(bc.name) + ",") == std::string::npos) {
+            continue;
+        }
+        for (index_t n: sizes) {
+            for (index_t run = 0; run < repeat; ++run) {
+                if (std::string(bc.name) == "conversion") {
+                    bench_conversion(out, first, n, run, opt);
+                    continue;
+                }
+                if (std::string(bc.name) == "reorder") {
+                    bench_reorder(out, first, n, run, opt);
+                    continue;
+                }
+                if (std::string(bc.name) == "local_cube") {
+                    bench_local(out, first, n, run, opt);
+                    continue;
+                }
+                Mesh M;
+                make_input(bc.name, n, M);
+                MmgOptions run_opt = opt;
+                MmgRemeshStats stats;
+                run_opt.stats = &stats;
+                /* the target size follows the input resolution, so that
+                 * the work grows with n */
+                run_opt.hsiz = 1. / double(n);
+                Mesh M_out;
+                reset_peak_rss();
+                bool ok = false;
+                if (std::string(bc.wrapper) == "mmgs_tri_remesh") {
+                    ok = mmgs_tri_remesh(M, M_out, run_opt);
+                } else if (std::string(bc.wrapper) == "mmg3d_tet_remesh") {
+                    ok = mmg3d_tet_remesh(M, M_out, run_opt);
+                } else if (std::string(bc.wrapper) == "mmg3d_move") {
+                    run_opt.displacement_attribute = "displacement";
+                    ok = mmg3d_move(M, M_out, run_opt);
+                } else {
+                    run_opt.hsiz = 0.;
+                    run_opt.hmin = 0.2 / double(n);
+                    run_opt.hmax = 2. / double(n);
+                    run_opt.angle_detection = false;
+                    run_opt.level_set = true;
+                    run_opt.ls_attribute = "ls";
+                    ok = mmg3d_extract_iso(M, M_out, run_opt);
+                }
+                size_t rss = peak_rss();
+                out << (first ? "" : ",\n");
+                write_run(out, bc, n, run, ok, stats, rss);
+                first = false;
+                Logger::out("mmgig_bench") << bc.name << " n=" << n << ": " << stats.times.total
+                    << " s (mmg " << stats.times.mmg << " s)" << std::endl;
+            }
+        }
+    }
+    out << "\n  ]\n}\n";
+    Logger::out("mmgig_bench") << "results written to " << output << std::endl;
+    return 0;
+}
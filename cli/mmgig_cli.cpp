@@ -0,0 +1,360 @@
+
+/*
+ *  OGF/Graphite: Geometry and Graphics Programming Library + Utilities
+ *  Copyright (C) 2000-2015 INRIA - Project ALICE
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  If you modify this software, you should include a notice giving the
+ *  name of the person performing the modification, the date of modification,
+ *  and the reason for such modification.
+ *
+ *  Contact for Graphite: Bruno Levy - Bruno.Levy@inria.fr
+ *  Contact for this Plugin: Maxence Reberol
+ *
+ *     Project ALICE
+ *     LORIA, INRIA Lorraine, 
+ *     Campus Scientifique, BP 239
+ *     54506 VANDOEUVRE LES NANCY CEDEX 
+ *     FRANCE
+ *
+ *  Note that the GNU General Public License does not permit incorporating
+ *  the Software into proprietary programs. 
+ *
+ * As an exception to the GPL, Graphite can be linked with the following
+ * (non-GPL) libraries:
+ *     Qt, tetgen, SuperLU, WildMagic and CGAL
+ */
+ 
+
+/*
+ * Headless front-end to the wrappers of algo/mmg_wrapper.h, for batch
+ * pipelines. Built with MMGIG_STANDALONE, it only needs geogram and mmg.
+ *
+ *   mmgig_cli [key=value ...] input output
+ *   mmgig_cli [key=value ...] input_dir output_dir
+ */
+
+#include <OGF/mmgig/common/common.h>
+#include <OGF/mmgig/algo/mmg_wrapper.h>
+#include <OGF/mmgig/algo/mmg_sweep.h>
+
+#include <geogram/basic/common.h>
+#include <geogram/basic/command_line.h>
+#include <geogram/basic/command_line_args.h>
+#include <geogram/basic/file_system.h>
+#include <geogram/basic/logger.h>
+#include <geogram/basic/stopwatch.h>
+#include <geogram/mesh/mesh.h>
+#include <geogram/mesh/mesh_io.h>
+#include <geogram/mesh/mesh_geometry.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace {
+    using namespace OGF;
+
+    struct CliSettings {
+        std::string mode = "auto"; /* auto, mmg3d, mmgs, iso or move */
+        index_t nb_jobs = 1;
+        std::string extension = ""; /* output extension in directory mode */
+        std::string stats_file = ""; /* MmgRemeshStats appended as JSON lines */
+        std::string sweep = ""; /* ranges of mmg_parameter_sweep(), in model units */
+        MmgOptions opt;
+        /* Sizes relative to the smallest side of the bounding box, as in the
+         * Graphite commands. Applied per mesh, negative if not given */
+        double hausd_bbox = -1.;
+        double hsiz_bbox = -1.;
+        double hmin_bbox = -1.;
+        double hmax_bbox = -1.;
+    };
+
+    void print_usage() {
+        Logger::out("mmgig_cli") << "usage: mmgig_cli [key=value ...] input output" << std::endl;
+        Logger::out("mmgig_cli") << "       mmgig_cli [key=value ...] input_dir output_dir" << std::endl;
+        Logger::out("mmgig_cli") << "  mode=auto|mmg3d|mmgs|iso  (auto: mmg3d if the mesh has cells)" << std::endl;
+        Logger::out("mmgig_cli") << "  mode=move                 move by displacement_attribute (geogram input)" << std::endl;
+        Logger::out("mmgig_cli") << "  config=file               MmgOptions as key = value lines" << std::endl;
+        Logger::out("mmgig_cli") << "  jobs=N                    meshes processed concurrently (directory mode)" << std::endl;
+        Logger::out("mmgig_cli") << "  extension=ext             output format (directory mode, default: input's)" << std::endl;
+        Logger::out("mmgig_cli") << "  stats=file                append the statistics of each run as JSON lines" << std::endl;
+        Logger::out("mmgig_cli") << "  sweep=\"hausd=a,b;hgrad=from:to:count\"  parameter sweep, the Pareto-best" << std::endl;
+        Logger::out("mmgig_cli") << "                            results are saved as output_0, output_1, .." << std::endl;
+        Logger::out("mmgig_cli") << "  hausd_bbox=, hsiz_bbox=, hmin_bbox=, hmax_bbox=  sizes relative to the bbox" << std::endl;
+        Logger::out("mmgig_cli") << "  any MmgOptions field, e.g. hausd=0.001 noinsert=1 nb_subdomains=8" << std::endl;
+    }
+
+    bool parse_bbox_size(const std::string& value, double& result) {
+        char* end = NULL;
+        result = strtod(value.c_str(), &end);
+        return !value.empty() && *end == '\0' && result >= 0.;
+    }
+
+    /* Config files are applied first, so that the other arguments override them */
+    bool parse_arguments(int argc, char** argv, CliSettings& S, std::vector<std::string>& files) {
+        std::vector<std::pair<std::string, std::string> > args;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            std::size_t eq = arg.find('=');
+            if (eq == std::string::npos) {
+                files.push_back(arg);
+                continue;
+            }
+            std::string key = arg.substr(0, eq);
+            std::string value = arg.substr(eq + 1);
+            if (key == "config") {
+                if (!mmg_options_load(S.opt, value)) return false;
+            } else {
+                args.push_back(std::make_pair(key, value));
+            }
+        }
+        for (index_t i = 0; i < args.size(); ++i) {
+            const std::string& key = args[i].first;
+            const std::string& value = args[i].second;
+            bool ok = true;
+            if (key == "mode") {
+                S.mode = value;
+                ok = (value == "auto" || value == "mmg3d" || value == "mmgs" || value == "iso" || value == "move");
+            } else if (key == "jobs") {
+                S.nb_jobs = index_t(atoi(value.c_str()));
+                ok = (S.nb_jobs > 0);
+            } else if (key == "extension") {
+                S.extension = value;
+            } else if (key == "stats") {
+                S.stats_file = value;
+            } else if (key == "sweep") {
+                S.sweep = value;
+            } else if (key == "hausd_bbox") {
+                ok = parse_bbox_size(value, S.hausd_bbox);
+            } else if (key == "hsiz_bbox") {
+                ok = parse_bbox_size(value, S.hsiz_bbox);
+            } else if (key == "hmin_bbox") {
+                ok = parse_bbox_size(value, S.hmin_bbox);
+            } else if (key == "hmax_bbox") {
+                ok = parse_bbox_size(value, S.hmax_bbox);
+            } else {
+                if (!mmg_options_set(S.opt, key, value)) return false;
+            }
+            if (!ok) {
+                Logger::err("mmgig_cli") << "invalid value '" << value << "' for " << key << std::endl;
+                return false;
+            }
+        }
+        if (files.size() != 2) {
+            print_usage();
+            return false;
+        }
+        return true;
+    }
+
+    void append_stats(const CliSettings& S, const std::string& input,
+            const std::string& mode, const MmgRemeshStats& stats) {
+        if (S.stats_file.empty()) return;
+        static std::mutex lock;
+        std::lock_guard<std::mutex> guard(lock);
+        std::ofstream out(S.stats_file.c_str(), std::ios::app);
+        if (!out) {
+            Logger::err("mmgig_cli") << "cannot write " << S.stats_file << std::endl;
+            return;
+        }
+        out << "{\"input\": \"" << input << "\", \"mode\": \"" << mode
+            << "\", \"stats\": " << stats.to_json() << "}" << std::endl;
+    }
+
+    bool process_sweep(const CliSettings& S, MmgOptions& opt, const Mesh& M, const std::string& input,
+            const std::string& output, const MeshIOFlags& flags) {
+        MmgRemeshStats stats;
+        opt.stats = &stats;
+        std::vector<MmgSweepResult> results;
+        bool ok = mmg_parameter_sweep(M, S.sweep, opt, results);
+        append_stats(S, input, "sweep", stats);
+        if (!ok) {
+            Logger::err("mmgig_cli") << input << ": sweep failed" << std::endl;
+            return false;
+        }
+        std::string base = FileSystem::dir_name(output) + "/" + FileSystem::base_name(output);
+        std::string ext = FileSystem::extension(output);
+        index_t nb_kept = 0;
+        for (const MmgSweepResult& result : results) {
+            Logger::out("mmgig_cli") << result.to_json() << std::endl;
+            if (!result.pareto) continue;
+            std::string path = base + "_" + std::to_string(nb_kept++) + "." + ext;
+            if (!mesh_save(*result.mesh, path, flags)) {
+                Logger::err("mmgig_cli") << "failed to save " << path << std::endl;
+                return false;
+            }
+            Logger::out("mmgig_cli") << path << ": " << result.settings << std::endl;
+        }
+        return true;
+    }
+
+    bool process_mesh(const CliSettings& S, const std::string& input, const std::string& output) {
+        Stopwatch W("mmgig_cli", false);
+        MeshIOFlags flags;
+        flags.set_attributes(MESH_ALL_ATTRIBUTES);
+        Mesh M;
+        if (!mesh_load(input, M, flags)) {
+            Logger::err("mmgig_cli") << "failed to load " << input << std::endl;
+            return false;
+        }
+
+        MmgOptions opt = S.opt;
+        double xyzmin[3];
+        double xyzmax[3];
+        get_bbox(M, xyzmin, xyzmax);
+        double min_axis = DBL_MAX;
+        for (index_t d = 0; d < 3; ++d) {
+            if (xyzmax[d] - xyzmin[d] > 0 && xyzmax[d] - xyzmin[d] < min_axis) {
+                min_axis = xyzmax[d] - xyzmin[d];
+            }
+        }
+        if (min_axis == DBL_MAX) {
+            Logger::err("mmgig_cli") << input << ": empty bounding box" << std::endl;
+            return false;
+        }
+        if (S.hausd_bbox >= 0.) opt.hausd = S.hausd_bbox * min_axis;
+        if (S.hsiz_bbox >= 0.) opt.hsiz = S.hsiz_bbox * min_axis;
+        if (S.hmin_bbox >= 0.) opt.hmin = S.hmin_bbox * min_axis;
+        if (S.hmax_bbox >= 0.) opt.hmax = S.hmax_bbox * min_axis;
+
+        if (!S.sweep.empty()) {
+            return process_sweep(S, opt, M, input, output, flags);
+        }
+
+        std::string mode = S.mode;
+        if (mode == "auto") {
+            mode = opt.level_set ? "iso" : (M.cells.nb() > 0 ? "mmg3d" : "mmgs");
+        }
+        MmgRemeshStats stats;
+        opt.stats = &stats;
+        bool ok = false;
+        Mesh M_out;
+        if (mode == "mmgs") {
+            if (M.cells.nb() > 0 || M.facets.nb() == 0 || !M.facets.are_simplices()) {
+                Logger::err("mmgig_cli") << input << ": mmgs needs a triangulated surface mesh" << std::endl;
+                return false;
+            }
+            ok = mmgs_tri_remesh(M, M_out, opt);
+        } else {
+            if (M.cells.nb() == 0 || (mode != "mmg3d" && !M.cells.are_simplices())) {
+                Logger::err("mmgig_cli") << input << ": " << mode << " needs a tetrahedral mesh" << std::endl;
+                return false;
+            }
+            if (mode == "iso") {
+                opt.level_set = true;
+                ok = mmg3d_extract_iso(M, M_out, opt);
+            } else if (mode == "move") {
+                ok = mmg3d_move(M, M_out, opt);
+            } else {
+                ok = mmg3d_tet_remesh(M, M_out, opt);
+            }
+        }
+        append_stats(S, input, mode, stats);
+        if (!ok) {
+            Logger::err("mmgig_cli") << input << ": " << mode << " failed" << std::endl;
+            return false;
+        }
+        if (!mesh_save(M_out, output, flags)) {
+            Logger::err("mmgig_cli") << "failed to save " << output << std::endl;
+            return false;
+        }
+        Logger::out("mmgig_cli") << input << " -> " << output << " (" << M_out.vertices.nb()
+            << " vertices) in " << W.elapsed_time() << " s" << std::endl;
+        return true;
+    }
+
+    bool is_mesh_file(const std::string& path) {
+        static const char* extensions[] = {
+            "mesh", "meshb", "geogram", "geogram_ascii", "obj", "off", "ply", "stl", "tet", "tet6", "ovm"
+        };
+        std::string ext = FileSystem::extension(path);
+        for (const char* e: extensions) {
+            if (ext == e) return true;
+        }
+        return false;
+    }
+
+    /* Meshes are dispatched to S.nb_jobs threads. Each mmg call works on its
+     * own structures, so the jobs do not share mutable state */
+    index_t process_directory(const CliSettings& S, const std::string& input_dir, const std::string& output_dir) {
+        std::vector<std::string> entries;
+        FileSystem::get_directory_entries(input_dir, entries);
+        std::vector<std::string> inputs;
+        for (const std::string& path: entries) {
+            if (FileSystem::is_file(path) && is_mesh_file(path)) {
+                inputs.push_back(path);
+            }
+        }
+        std::sort(inputs.begin(), inputs.end());
+        if (!FileSystem::is_directory(output_dir) && !FileSystem::create_directory(output_dir)) {
+            Logger::err("mmgig_cli") << "cannot create " << output_dir << std::endl;
+            return index_t(inputs.size());
+        }
+        Logger::out("mmgig_cli") << inputs.size() << " meshes in " << input_dir
+            << ", " << S.nb_jobs << " concurrent jobs" << std::endl;
+
+        std::atomic<index_t> next(0);
+        std::atomic<index_t> nb_failed(0);
+        auto worker = [&]() {
+            for (index_t i = next++; i < inputs.size(); i = next++) {
+                std::string ext = S.extension.empty() ? FileSystem::extension(inputs[i]) : S.extension;
+                std::string output = output_dir + "/" + FileSystem::base_name(inputs[i]) + "." + ext;
+                if (!process_mesh(S, inputs[i], output)) {
+                    ++nb_failed;
+                }
+            }
+        };
+        index_t nb_threads = std::min(S.nb_jobs, index_t(inputs.size()));
+        std::vector<std::thread> threads;
+        for (index_t t = 1; t < nb_threads; ++t) {
+            threads.push_back(std::thread(worker));
+        }
+        worker();
+        for (std::thread& t: threads) {
+            t.join();
+        }
+        return nb_failed;
+    }
+}
+
+int main(int argc, char** argv) {
+    GEO::initialize();
+    GEO::CmdLine::import_arg_group("standard");
+
+    CliSettings S;
+    std::vector<std::string> files;
+    if (!parse_arguments(argc, argv, S, files)) {
+        return 1;
+    }
+    Stopwatch W("mmgig_cli", false);
+    int status = 0;
+    if (FileSystem::is_directory(files[0])) {
+        index_t nb_failed = process_directory(S, files[0], files[1]);
+        if (nb_failed > 0) {
+            Logger::err("mmgig_cli") << nb_failed << " meshes failed" << std::endl;
+            status = 1;
+        }
+    } else {
+        status = process_mesh(S, files[0], files[1]) ? 0 : 1;
+    }
+    Logger::out("mmgig_cli") << "total " << W.elapsed_time() << " s" << std::endl;
+    return status;
+}
@@ -43,8 +43,23 @@
 #include <OGF/mmgig/commands/mesh_grobmmgcalls_commands.h>
 
 #include <OGF/mmgig/algo/mmg_wrapper.h>
+#include <OGF/mmgig/algo/mmg_job.h>
+#include <OGF/mmgig/algo/mmg_sizemap.h>
+#include <OGF/mmgig/algo/mmg_transfer.h>
+#include <OGF/mmgig/algo/mmg_implicit.h>
+#include <OGF/mmgig/algo/mmg_quality.h>
+#include <OGF/mmgig/algo/mmg_preflight.h>
+#include <OGF/mmgig/algo/mmg_sweep.h>
+#include <OGF/mmgig/algo/mmg_lod.h>
 
 #include <geogram/mesh/mesh_geometry.h>
+#include <geogram/basic/progress.h>
+#include <geogram/basic/process.h>
+#include <geogram/basic/stopwatch.h>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
 
 namespace OGF {
 
@@ -71,6 +86,103 @@ namespace OGF {
         return min_axis * value;
     }
 
+    /* Jobs running in background. Only accessed from the GUI thread */
+    std::vector<std::shared_ptr<MmgJob> >& background_jobs() {
+        static std::vector<std::shared_ptr<MmgJob> > jobs;
+        return jobs;
+    }
+
+    /* Cancelled jobs whose mmg call is still running, kept alive until it
+     * returns since it cannot be interrupted. Only accessed from the GUI
+     * thread */
+    std::vector<std::shared_ptr<MmgJob> >& cancelled_jobs() {
+        static std::vector<std::shared_ptr<MmgJob> > jobs;
+        return jobs;
+    }
+
+    void publish_job_result(SceneGraph* scene_graph, MmgJob& job) {
+        MeshGrob* Mo = MeshGrob::find_or_create(scene_graph, job.output_name());
+        if (job.succeeded()) {
+            Mo->copy(job.result());
+            Mo->update();
+        } else {
+            Mo->clear();
+        }
+    }
+
+    /* Writes the messages of the jobs, publishes the background jobs that
+     * are done and forgets the finished cancelled ones. Called on the GUI
+     * thread at the start of the commands of this class, and while a
+     * blocking job is waited for. Returns the number of published jobs */
+    index_t publish_finished_jobs(SceneGraph* scene_graph) {
+        index_t nb_published = 0;
+        std::vector<std::shared_ptr<MmgJob> >& jobs = background_jobs();
+        std::vector<std::shared_ptr<MmgJob> > running;
+        for (const std::shared_ptr<MmgJob>& job : jobs) {
+            job->flush_log();
+            if (!job->is_finished()) {
+                running.push_back(job);
+                continue;
+            }
+            job->wait();
+            job->flush_log();
+            publish_job_result(scene_graph, *job);
+            ++nb_published;
+        }
+        jobs.swap(running);
+
+        std::vector<std::shared_ptr<MmgJob> >& cancelled = cancelled_jobs();
+        running.clear();
+        for (const std::shared_ptr<MmgJob>& job : cancelled) {
+            job->flush_log();
+            if (!job->is_finished()) {
+                running.push_back(job);
+                continue;
+            }
+            job->wait();
+            job->flush_log();
+        }
+        cancelled.swap(running);
+        return nb_published;
+    }
+
+    /* The remeshing runs on a worker thread. In blocking mode, the GUI stays
+     * responsive through the progress bar and its cancel button. A job
+     * cancelled during the mmg call finishes in background, its result is
+     * discarded. A background job is published by the next command run
+     * once it is done. */
+    void run_job(SceneGraph* scene_graph, MmgJob::Kind kind, const Mesh& M,
+            const MmgOptions& opt, const std::string& output_name, bool run_in_background) {
+        std::shared_ptr<MmgJob> job(new MmgJob(kind, M, opt, output_name));
+        job->start();
+        if (run_in_background) {
+            background_jobs().push_back(job);
+            Logger::out(MmgJob::kind_name(kind)) << "running in background, " << output_name
+                << " is published by the next MmgTools command once done" << std::endl;
+            return;
+        }
+        try {
+            ProgressTask task(MmgJob::kind_name(kind), 100);
+            while (!job->is_finished()) {
+                task.progress(job->progress());
+                job->flush_log();
+                publish_finished_jobs(scene_graph);
+                Process::sleep(20000);
+            }
+        } catch (const TaskCanceled&) {
+            job->cancel();
+            job->flush_log();
+            if (!job->is_finished()) {
+                cancelled_jobs().push_back(job);
+            }
+            Logger::warn(MmgJob::kind_name(kind)) << "cancelled, " << output_name << " left unchanged" << std::endl;
+            return;
+        }
+        job->wait();
+        job->flush_log();
+        publish_job_result(scene_graph, *job);
+    }
+
     void MeshGrobmmgcallsCommands::mmgs_remesh(
             const std::string& output_name,
             bool angle_detection,
@@ -86,8 +198,19 @@ namespace OGF {
             bool nomove,
             const std::string& metric_attribute,
             const std::string& edge_attribute,
-            const std::string& facet_attribute
+            const std::string& facet_attribute,
+            bool run_in_background,
+            bool curvature_size_map,
+            const std::string& transfer_attributes,
+            double skip_min_quality,
+            const std::string& reorder,
+            bool isolate,
+            double worker_timeout,
+            double worker_memory_limit,
+            index_t target_elements,
+            double memory_budget
             ) {
+        publish_finished_jobs(scene_graph());
         if (mesh_grob()->cells.nb() > 0 || mesh_grob()->facets.nb() == 0 || !mesh_grob()->facets.are_simplices()) {
             Logger::err("mmgs_remesh") << "input mesh should be a closed triangulated mesh, cancel" << std::endl;
             return;
@@ -114,12 +237,16 @@ namespace OGF {
         opt.metric_attribute  = metric_attribute;
         opt.edge_attribute = edge_attribute;
         opt.facet_attribute = facet_attribute;
-        MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name);
-        if (mmgs_tri_remesh(*mesh_grob(), *Mo, opt)) {
-            Mo->update();
-        } else {
-            Mo->clear();
-        }
+        opt.curvature_size_map = curvature_size_map;
+        opt.transfer_attributes = transfer_attributes;
+        opt.skip_min_quality = skip_min_quality;
+        opt.reorder = reorder;
+        opt.isolate = isolate;
+        opt.worker_timeout = worker_timeout;
+        opt.worker_memory_limit = worker_memory_limit;
+        opt.target_elements = target_elements;
+        opt.memory_budget = memory_budget;
+        run_job(scene_graph(), MmgJob::MMGS_REMESH, *mesh_grob(), opt, name, run_in_background);
         return;
     }
 
@@ -143,8 +270,21 @@ namespace OGF {
             const std::string& metric_attribute,
             const std::string& edge_attribute,
             const std::string& facet_attribute,
-            const std::string& cell_attribute) {
-        if (mesh_grob()->cells.nb() == 0 || !mesh_grob()->cells.are_simplices()) {
+            const std::string& cell_attribute,
+            index_t nb_subdomains,
+            index_t parmmg_nb_procs,
+            bool run_in_background,
+            bool curvature_size_map,
+            const std::string& transfer_attributes,
+            double skip_min_quality,
+            const std::string& reorder,
+            bool isolate,
+            double worker_timeout,
+            double worker_memory_limit,
+            index_t target_elements,
+            double memory_budget) {
+        publish_finished_jobs(scene_graph());
+        if (mesh_grob()->cells.nb() == 0) {
             Logger::err("mmg3d_remesh") << "input mesh should be a tetrahedral mesh, cancel" << std::endl;
             return;
         }
@@ -175,15 +315,235 @@ namespace OGF {
         opt.edge_attribute = edge_attribute;
         opt.facet_attribute = facet_attribute;
         opt.cell_attribute = cell_attribute;
-        MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name);
-        if (mmg3d_tet_remesh(*mesh_grob(), *Mo, opt)) {
+        opt.nb_subdomains = nb_subdomains;
+        opt.parmmg_nb_procs = parmmg_nb_procs;
+        opt.curvature_size_map = curvature_size_map;
+        opt.transfer_attributes = transfer_attributes;
+        opt.skip_min_quality = skip_min_quality;
+        opt.reorder = reorder;
+        opt.isolate = isolate;
+        opt.worker_timeout = worker_timeout;
+        opt.worker_memory_limit = worker_memory_limit;
+        opt.target_elements = target_elements;
+        opt.memory_budget = memory_budget;
+        run_job(scene_graph(), MmgJob::MMG3D_REMESH, *mesh_grob(), opt, name, run_in_background);
+        return;
+    }
+ 
+    void MeshGrobmmgcallsCommands::mmg_parameter_sweep(
+            const std::string& output_name,
+            const std::string& ranges,
+            bool sizes_relative_to_bbox,
+            double hausd,
+            double hsiz,
+            double hmin,
+            double hmax,
+            double hgrad,
+            const std::string& metric_attribute) {
+        publish_finished_jobs(scene_graph());
+        std::string name = output_name;
+        if (output_name == "default_sweep") {
+            name = mesh_grob()->name() + "_sweep";
+        }
+        double xyzmin[3];
+        double xyzmax[3];
+        GEO::get_bbox(*mesh_grob(), xyzmin, xyzmax);
+        double scale = sizes_relative_to_bbox ? scale_to_bbox(1., xyzmin, xyzmax) : 1.;
+        MmgOptions opt;
+        opt.hausd             = scale * hausd;
+        opt.hsiz              = scale * hsiz;
+        opt.hmin              = scale * hmin;
+        opt.hmax              = scale * hmax;
+        opt.hgrad             = hgrad;
+        opt.metric_attribute  = metric_attribute;
+        std::vector<MmgSweepResult> results;
+        Stopwatch W("mmg_sweep", false);
+        if (!OGF::mmg_parameter_sweep(*mesh_grob(), ranges, opt, results, scale)) {
+            Logger::err("mmg_sweep") << "no result" << std::endl;
+            return;
+        }
+        index_t nb_kept = 0;
+        for (const MmgSweepResult& result : results) {
+            Logger::out("mmg_sweep") << result.to_json() << std::endl;
+            if (!result.pareto) continue;
+            MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name + "_" + std::to_string(nb_kept));
+            Mo->copy(*result.mesh);
+            Mo->update();
+            Logger::out("mmg_sweep") << name << "_" << nb_kept << ": " << result.settings << std::endl;
+            ++nb_kept;
+        }
+        Logger::out("mmg_sweep") << nb_kept << " Pareto-best of " << results.size()
+            << " combinations in " << W.elapsed_time() << " s" << std::endl;
+    }
+
+    void MeshGrobmmgcallsCommands::mmg_lod(
+            const std::string& output_name,
+            const std::string& hsiz_bbox,
+            double hausd_bbox,
+            double hgrad,
+            index_t nb_lanes,
+            const std::string& correspondence_attribute) {
+        publish_finished_jobs(scene_graph());
+        if (mesh_grob()->cells.nb() == 0 && (mesh_grob()->facets.nb() == 0 || !mesh_grob()->facets.are_simplices())) {
+            Logger::err("mmg_lod") << "input mesh should be a tetrahedral or triangle mesh, cancel" << std::endl;
+            return;
+        }
+        std::vector<double> sizes;
+        std::string list = hsiz_bbox;
+        std::replace(list.begin(), list.end(), ',', ' ');
+        std::istringstream in(list);
+        double value;
+        while (in >> value) {
+            sizes.push_back(value);
+        }
+        if (sizes.empty() || !in.eof()) {
+            Logger::err("mmg_lod") << "cannot parse the sizes " << hsiz_bbox << ", cancel" << std::endl;
+            return;
+        }
+        std::string name = output_name;
+        if (output_name == "default_lod") {
+            name = mesh_grob()->name() + "_lod";
+        }
+        double xyzmin[3];
+        double xyzmax[3];
+        GEO::get_bbox(*mesh_grob(), xyzmin, xyzmax);
+        for (double& size : sizes) {
+            size = scale_to_bbox(size, xyzmin, xyzmax);
+        }
+        MmgOptions opt;
+        opt.hausd             = scale_to_bbox(hausd_bbox, xyzmin, xyzmax);
+        opt.hgrad             = hgrad;
+        std::vector<MmgLodLevel> levels;
+        Stopwatch W("mmg_lod", false);
+        if (!OGF::mmg_lod(*mesh_grob(), sizes, opt, levels, nb_lanes, correspondence_attribute)) {
+            Logger::err("mmg_lod") << "failed to build the levels" << std::endl;
+            return;
+        }
+        for (index_t i = 0; i < levels.size(); ++i) {
+            MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name + "_" + std::to_string(i));
+            Mo->copy(*levels[i].mesh);
             Mo->update();
+        }
+        Logger::out("mmg_lod") << levels.size() << " levels in " << W.elapsed_time() << " s" << std::endl;
+    }
+
+    void MeshGrobmmgcallsCommands::mmg3d_local_remesh(
+            const std::string& output_name,
+            const std::string& selection_cell_attribute,
+            const std::string& selection_box,
+            double selection_min_quality,
+            index_t buffer_layers,
+            double hausd_bbox,
+            double hsiz_bbox,
+            double hmin_bbox,
+            double hmax_bbox,
+            double hgrad,
+            const std::string& metric_attribute,
+            bool run_in_background) {
+        publish_finished_jobs(scene_graph());
+        if (mesh_grob()->cells.nb() == 0 || !mesh_grob()->cells.are_simplices()) {
+            Logger::err("mmg3d_local") << "input mesh should be a tetrahedral mesh, cancel" << std::endl;
+            return;
+        }
+        if (selection_cell_attribute == "no_attribute" && selection_box.empty() && selection_min_quality <= 0.) {
+            Logger::err("mmg3d_local") << "no selection given, use mmg3d_remesh to remesh everything" << std::endl;
+            return;
+        }
+        std::string name = output_name;
+        if (output_name == "default_mmg3d") {
+            name = mesh_grob()->name() + "_mmg3d";
+        }
+        double xyzmin[3];
+        double xyzmax[3];
+        GEO::get_bbox(*mesh_grob(), xyzmin, xyzmax);
+        MmgOptions opt;
+        opt.hausd             = scale_to_bbox(hausd_bbox, xyzmin, xyzmax);
+        opt.hsiz              = scale_to_bbox(hsiz_bbox , xyzmin, xyzmax);
+        opt.hmin              = scale_to_bbox(hmin_bbox , xyzmin, xyzmax);
+        opt.hmax              = scale_to_bbox(hmax_bbox , xyzmin, xyzmax);
+        opt.hgrad             = hgrad;
+        opt.metric_attribute  = metric_attribute;
+        opt.local_cell_attribute = selection_cell_attribute;
+        opt.local_box         = selection_box;
+        opt.local_min_quality = selection_min_quality;
+        opt.local_buffer_layers = buffer_layers;
+        run_job(scene_graph(), MmgJob::MMG3D_REMESH, *mesh_grob(), opt, name, run_in_background);
+    }
+
+    void MeshGrobmmgcallsCommands::mmg3d_move(
+            const std::string& output_name,
+            const std::string& displacement_attribute,
+            index_t lagrangian_mode,
+            double hausd_bbox,
+            double hmin_bbox,
+            double hmax_bbox,
+            double hgrad,
+            bool compare_with_remesh,
+            bool run_in_background) {
+        publish_finished_jobs(scene_graph());
+        if (mesh_grob()->cells.nb() == 0 || !mesh_grob()->cells.are_simplices()) {
+            Logger::err("mmg3d_move") << "input mesh should be a tetrahedral mesh, cancel" << std::endl;
+            return;
+        }
+        std::string name = output_name;
+        if (output_name == "default_move") {
+            name = mesh_grob()->name() + "_moved";
+        }
+        double xyzmin[3];
+        double xyzmax[3];
+        GEO::get_bbox(*mesh_grob(), xyzmin, xyzmax);
+        MmgOptions opt;
+        opt.hausd             = scale_to_bbox(hausd_bbox, xyzmin, xyzmax);
+        opt.hmin              = scale_to_bbox(hmin_bbox , xyzmin, xyzmax);
+        opt.hmax              = scale_to_bbox(hmax_bbox , xyzmin, xyzmax);
+        opt.hgrad             = hgrad;
+        opt.displacement_attribute = displacement_attribute;
+        opt.lagrangian_mode   = lagrangian_mode;
+        if (!compare_with_remesh) {
+            run_job(scene_graph(), MmgJob::MMG3D_MOVE, *mesh_grob(), opt, name, run_in_background);
+            return;
+        }
+
+        /* Per-step cost of the motion against a full remesh of the
+         * displaced mesh, both run here in blocking mode */
+        MmgRemeshStats move_stats;
+        MmgRemeshStats remesh_stats;
+        Mesh M_moved;
+        opt.stats = &move_stats;
+        if (!OGF::mmg3d_move(*mesh_grob(), M_moved, opt)) return;
+
+        Mesh M_displaced;
+        M_displaced.copy(*mesh_grob());
+        Attribute<double> displacement(M_displaced.vertices.attributes(), displacement_attribute);
+        for (index_t v = 0; v < M_displaced.vertices.nb(); ++v) {
+            double* p = M_displaced.vertices.point_ptr(v);
+            for (index_t d = 0; d < 3; ++d) {
+                p[d] += displacement[3 * v + d];
+            }
+        }
+        displacement.unbind();
+        Mesh M_remeshed;
+        opt.stats = &remesh_stats;
+        bool remeshed = mmg3d_tet_remesh(M_displaced, M_remeshed, opt);
+
+        std::ostringstream remesh_cost;
+        if (remeshed) {
+            remesh_cost << remesh_stats.times.total << " s (" << remesh_stats.nb_tets_out << " tets)";
         } else {
-            Mo->clear();
+            remesh_cost << "failed";
+        }
+        Logger::out("mmg3d_move") << "move: " << move_stats.times.total << " s ("
+            << move_stats.nb_tets_out << " tets), full remesh: " << remesh_cost.str() << std::endl;
+        MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name);
+        Mo->copy(M_moved);
+        Mo->update();
+        if (remeshed) {
+            MeshGrob* Mr = MeshGrob::find_or_create(scene_graph(), name + "_remesh");
+            Mr->copy(M_remeshed);
+            Mr->update();
         }
-        return;
     }
- 
+
     void MeshGrobmmgcallsCommands::mmg3d_iso_extraction(
             const std::string& output_name,
             const std::string& ls_attribute,
@@ -193,7 +553,10 @@ namespace OGF {
             double hausd_bbox,
             double hmin_bbox,
             double hmax_bbox,
-            double hgrad) {
+            double hgrad,
+            bool run_in_background,
+            const std::string& iso_output) {
+        publish_finished_jobs(scene_graph());
         if (mesh_grob()->cells.nb() == 0 || !mesh_grob()->cells.are_simplices()) {
             Logger::err("mmg3d_remesh") << "input mesh should be a tetrahedral mesh, cancel" << std::endl;
             return;
@@ -215,12 +578,301 @@ namespace OGF {
         opt.level_set         = true;
         opt.ls_value          = ls_value;
         opt.ls_attribute      = ls_attribute;
-        MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name);
-        if (mmg3d_extract_iso(*mesh_grob(), *Mo, opt)) {
+        opt.iso_output        = iso_output;
+        run_job(scene_graph(), MmgJob::MMG3D_ISO, *mesh_grob(), opt, name, run_in_background);
+        return;
+    } 
+
+    void MeshGrobmmgcallsCommands::mmg3d_iso_levels(
+            const std::string& output_name,
+            const std::string& ls_attribute,
+            const std::string& ls_values,
+            bool angle_detection,
+            double angle_value,
+            double hausd_bbox,
+            double hmin_bbox,
+            double hmax_bbox,
+            double hgrad,
+            const std::string& iso_output,
+            bool separate_grobs) {
+        publish_finished_jobs(scene_graph());
+        if (mesh_grob()->cells.nb() == 0 || !mesh_grob()->cells.are_simplices()) {
+            Logger::err("mmg3d_iso") << "input mesh should be a tetrahedral mesh, cancel" << std::endl;
+            return;
+        }
+        std::vector<double> values;
+        std::string list = ls_values;
+        std::replace(list.begin(), list.end(), ',', ' ');
+        std::istringstream in(list);
+        double value;
+        while (in >> value) {
+            values.push_back(value);
+        }
+        if (values.empty() || !in.eof()) {
+            Logger::err("mmg3d_iso") << "cannot parse the isovalues " << ls_values << ", cancel" << std::endl;
+            return;
+        }
+        std::string name = output_name;
+        if (output_name == "default_iso_levels") {
+            name = mesh_grob()->name() + "_iso";
+        }
+        double xyzmin[3];
+        double xyzmax[3];
+        GEO::get_bbox(*mesh_grob(), xyzmin, xyzmax);
+        MmgOptions opt;
+        opt.angle_detection   = angle_detection;
+        opt.angle_value       = angle_value;
+        opt.hausd             = scale_to_bbox(hausd_bbox, xyzmin, xyzmax);
+        opt.hmin              = scale_to_bbox(hmin_bbox , xyzmin, xyzmax);
+        opt.hmax              = scale_to_bbox(hmax_bbox , xyzmin, xyzmax);
+        opt.hgrad             = hgrad;
+        opt.level_set         = true;
+        opt.ls_attribute      = ls_attribute;
+        opt.iso_output        = iso_output;
+        std::vector<std::unique_ptr<Mesh> > levels(values.size());
+        std::vector<Mesh*> outputs(values.size());
+        for (index_t i = 0; i < values.size(); ++i) {
+            levels[i].reset(new Mesh);
+            outputs[i] = levels[i].get();
+        }
+        if (!mmg3d_extract_iso_levels(*mesh_grob(), values, outputs, opt)) {
+            return;
+        }
+        if (!separate_grobs) {
+            MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name);
+            merge_iso_levels(outputs, *Mo);
             Mo->update();
+            return;
+        }
+        for (index_t i = 0; i < values.size(); ++i) {
+            MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name + "_" + std::to_string(i));
+            Mo->copy(*outputs[i]);
+            Mo->update();
+        }
+    }
+
+    void MeshGrobmmgcallsCommands::mmg3d_implicit_iso(
+            const std::string& output_name,
+            const std::string& expression,
+            const std::string& reference_surface,
+            double ls_value,
+            index_t nb_band_passes,
+            double band_width_bbox,
+            double hausd_bbox,
+            double hmin_bbox,
+            double hmax_bbox,
+            double hgrad,
+            const std::string& iso_output) {
+        publish_finished_jobs(scene_graph());
+        if (mesh_grob()->cells.nb() == 0 || !mesh_grob()->cells.are_simplices()) {
+            Logger::err("mmg_implicit") << "input mesh should be a tetrahedral background mesh, cancel" << std::endl;
+            return;
+        }
+        ImplicitFunction f;
+        if (reference_surface != "") {
+            MeshGrob* surface = MeshGrob::find(scene_graph(), reference_surface);
+            if (surface == NULL || surface->facets.nb() == 0 || !surface->facets.are_simplices()) {
+                Logger::err("mmg_implicit") << reference_surface << " is not a triangulated surface, cancel" << std::endl;
+                return;
+            }
+            f = signed_distance_function(*surface);
+            if (!f) return;
+        } else if (!parse_implicit_expression(expression, f)) {
+            return;
+        }
+        std::string name = output_name;
+        if (output_name == "default_implicit") {
+            name = mesh_grob()->name() + "_implicit";
+        }
+        double xyzmin[3];
+        double xyzmax[3];
+        GEO::get_bbox(*mesh_grob(), xyzmin, xyzmax);
+        MmgOptions opt;
+        opt.angle_detection   = false;
+        opt.hausd             = scale_to_bbox(hausd_bbox, xyzmin, xyzmax);
+        opt.hmin              = scale_to_bbox(hmin_bbox , xyzmin, xyzmax);
+        opt.hmax              = scale_to_bbox(hmax_bbox , xyzmin, xyzmax);
+        opt.hgrad             = hgrad;
+        opt.level_set         = true;
+        opt.ls_attribute      = "ls";
+        opt.ls_value          = ls_value;
+        opt.iso_output        = iso_output;
+        Mesh M_out;
+        if (!OGF::mmg3d_implicit_iso(*mesh_grob(), f, M_out, opt, nb_band_passes,
+                                     scale_to_bbox(band_width_bbox, xyzmin, xyzmax))) {
+            return;
+        }
+        MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name);
+        Mo->copy(M_out);
+        Mo->update();
+    }
+
+    void MeshGrobmmgcallsCommands::compute_curvature_size_map(
+            const std::string& attribute_name,
+            double hausd_bbox,
+            double hmin_bbox,
+            double hmax_bbox,
+            bool anisotropic,
+            bool angle_detection,
+            double angle_value) {
+        publish_finished_jobs(scene_graph());
+        if (mesh_grob()->facets.nb() == 0 && mesh_grob()->cells.nb() == 0) {
+            Logger::err("mmg_sizemap") << "input mesh has no surface, cancel" << std::endl;
+            return;
+        }
+        double xyzmin[3];
+        double xyzmax[3];
+        GEO::get_bbox(*mesh_grob(), xyzmin, xyzmax);
+        MmgOptions opt;
+        opt.hausd             = scale_to_bbox(hausd_bbox, xyzmin, xyzmax);
+        opt.hmin              = scale_to_bbox(hmin_bbox , xyzmin, xyzmax);
+        opt.hmax              = scale_to_bbox(hmax_bbox , xyzmin, xyzmax);
+        opt.enable_anisotropy = anisotropic;
+        opt.angle_detection   = angle_detection;
+        opt.angle_value       = angle_value;
+        if (store_curvature_size_map(*mesh_grob(), opt, attribute_name)) {
+            mesh_grob()->update();
+        }
+    }
+
+    void MeshGrobmmgcallsCommands::adapt_to_field(
+            const std::string& output_name,
+            const std::string& field_attribute,
+            index_t nb_iterations,
+            double relative_error,
+            double hmin_bbox,
+            double hmax_bbox,
+            double hgrad,
+            bool anisotropic,
+            const std::string& transfer_attributes) {
+        publish_finished_jobs(scene_graph());
+        bool tets = mesh_grob()->cells.nb() > 0 && mesh_grob()->cells.are_simplices();
+        bool triangles = mesh_grob()->cells.nb() == 0 && mesh_grob()->facets.nb() > 0 && mesh_grob()->facets.are_simplices();
+        if (!tets && !triangles) {
+            Logger::err("mmg_adapt") << "input mesh should be a tetrahedral or a triangulated mesh, cancel" << std::endl;
+            return;
+        }
+        if (!Attribute<double>::is_defined(mesh_grob()->vertices.attributes(), field_attribute, 1)) {
+            Logger::err("mmg_adapt") << field_attribute << " is not a scalar double vertex attribute, cancel" << std::endl;
+            return;
+        }
+        std::string name = output_name;
+        if (output_name == "default_adapt") {
+            name = mesh_grob()->name() + "_adapt";
+        }
+        Attribute<double> field(mesh_grob()->vertices.attributes(), field_attribute);
+        double fmin = field[0];
+        double fmax = field[0];
+        for (index_t v = 1; v < mesh_grob()->vertices.nb(); ++v) {
+            fmin = std::min(fmin, field[v]);
+            fmax = std::max(fmax, field[v]);
+        }
+        if (!(fmax > fmin)) {
+            Logger::err("mmg_adapt") << field_attribute << " is constant, nothing to adapt to" << std::endl;
+            return;
+        }
+        double xyzmin[3];
+        double xyzmax[3];
+        GEO::get_bbox(*mesh_grob(), xyzmin, xyzmax);
+        MmgOptions opt;
+        opt.hmin              = scale_to_bbox(hmin_bbox, xyzmin, xyzmax);
+        opt.hmax              = scale_to_bbox(hmax_bbox, xyzmin, xyzmax);
+        opt.hgrad             = hgrad;
+        opt.enable_anisotropy = anisotropic;
+        opt.transfer_attributes = transfer_attributes;
+        Mesh M_out;
+        if (!OGF::adapt_to_field(*mesh_grob(), M_out, field_attribute,
+                                 relative_error * (fmax - fmin), nb_iterations, opt)) {
+            return;
+        }
+        MeshGrob* Mo = MeshGrob::find_or_create(scene_graph(), name);
+        Mo->copy(M_out);
+        Mo->update();
+    }
+
+    void MeshGrobmmgcallsCommands::mesh_quality(
+            const std::string& attribute_prefix,
+            index_t nb_bins,
+            const std::string& metric_attribute,
+            double hsiz_bbox) {
+        publish_finished_jobs(scene_graph());
+        double xyzmin[3];
+        double xyzmax[3];
+        GEO::get_bbox(*mesh_grob(), xyzmin, xyzmax);
+        MmgOptions opt;
+        opt.metric_attribute = metric_attribute;
+        opt.hsiz = scale_to_bbox(hsiz_bbox, xyzmin, xyzmax);
+        MmgQualityStats stats;
+        if (!compute_mesh_quality(*mesh_grob(), opt, stats, nb_bins, attribute_prefix)) {
+            return;
+        }
+        Logger::out("mmg_quality") << stats.to_json() << std::endl;
+        double bin_width = 1. / double(stats.histogram.size());
+        for (index_t b = 0; b < stats.histogram.size(); ++b) {
+            Logger::out("mmg_quality") << "  [" << b * bin_width << ", "
+                << (b + 1) * bin_width << "): " << stats.histogram[b] << std::endl;
+        }
+        if (!attribute_prefix.empty()) {
+            mesh_grob()->update();
+        }
+    }
+
+    void MeshGrobmmgcallsCommands::mesh_preflight(
+            bool for_mmgs,
+            double duplicate_tolerance,
+            const std::string& metric_attribute,
+            const std::string& edge_attribute,
+            const std::string& facet_attribute,
+            const std::string& cell_attribute) {
+        publish_finished_jobs(scene_graph());
+        MmgOptions opt;
+        opt.metric_attribute = metric_attribute;
+        opt.edge_attribute = edge_attribute;
+        opt.facet_attribute = facet_attribute;
+        opt.cell_attribute = cell_attribute;
+        MmgPreflightReport report;
+        bool ok = preflight_check(*mesh_grob(), !for_mmgs, opt, report, duplicate_tolerance);
+        Logger::out("mmg_preflight") << report.to_json() << std::endl;
+        for (const std::string& error : report.attribute_errors) {
+            Logger::err("mmg_preflight") << error << std::endl;
+        }
+        if (ok) {
+            Logger::out("mmg_preflight") << "ready for " << (for_mmgs ? "mmgs" : "mmg3d")
+                << " (" << report.time << " s)" << std::endl;
         } else {
-            Mo->clear();
+            Logger::err("mmg_preflight") << "not ready for " << (for_mmgs ? "mmgs" : "mmg3d") << std::endl;
         }
-        return;
-    } 
+    }
+
+    void MeshGrobmmgcallsCommands::list_jobs() {
+        publish_finished_jobs(scene_graph());
+        std::vector<std::shared_ptr<MmgJob> >& jobs = background_jobs();
+        if (jobs.empty()) {
+            Logger::out("mmg_jobs") << "no job" << std::endl;
+        }
+        for (index_t i = 0; i < jobs.size(); ++i) {
+            const MmgJob& job = *jobs[i];
+            Logger::out("mmg_jobs") << i << ": " << MmgJob::kind_name(job.kind())
+                << " -> " << job.output_name()
+                << ", " << mmg_phase_name(job.phase())
+                << ", running" << std::endl;
+        }
+    }
+
+    void MeshGrobmmgcallsCommands::collect_finished_jobs() {
+        index_t nb_published = publish_finished_jobs(scene_graph());
+        Logger::out("mmg_jobs") << nb_published << " job(s) collected, "
+            << background_jobs().size() << " still running" << std::endl;
+    }
+
+    void MeshGrobmmgcallsCommands::cancel_jobs() {
+        publish_finished_jobs(scene_graph());
+        std::vector<std::shared_ptr<MmgJob> >& jobs = background_jobs();
+        for (const std::shared_ptr<MmgJob>& job : jobs) {
+            job->cancel();
+            cancelled_jobs().push_back(job);
+        }
+        Logger::out("mmg_jobs") << jobs.size() << " job(s) cancelled" << std::endl;
+        jobs.clear();
+    }
 }
@@ -78,7 +78,17 @@ gom_slots:
                     bool nomove = false,
                     const std::string& metric_attribute = "no_metric",
                     const std::string & edge_attribute = "no_attribute",
-                    const std::string & facet_attribute = "no_attribute");
+                    const std::string & facet_attribute = "no_attribute",
+                    bool run_in_background = false,
+                    bool curvature_size_map = false /* sizes from the curvature if no metric_attribute */,
+                    const std::string& transfer_attributes = "no_attribute" /* vertex attributes interpolated on the output, comma separated or "all" */,
+                    double skip_min_quality = 0. /* copy the input if its quality and sizes are already met, 0 to always remesh */,
+                    const std::string& reorder = "none" /* none, hilbert or morton: input and output order */,
+                    bool isolate = false /* run mmg in a separate process, a crash does not stop Graphite */,
+                    double worker_timeout = 0. /* isolated: seconds, 0 for no limit */,
+                    double worker_memory_limit = 0. /* isolated: GB, 0 for no limit */,
+                    index_t target_elements = 0 /* scale the sizes to get about this many elements, 0 to use them as given */,
+                    double memory_budget = 0. /* GB, refuse the remeshing if its estimated memory is over it, 0 for no limit */);
 
             /**
              * \menu /MmgTools
@@ -103,7 +113,86 @@ gom_slots:
                     const std::string& metric_attribute = "no_metric",
                     const std::string & edge_attribute = "no_attribute",
                     const std::string & facet_attribute = "no_attribute",
-                    const std::string & cell_attribute = "no_attribute");
+                    const std::string & cell_attribute = "no_attribute",
+                    index_t nb_subdomains = 0 /* remesh parts concurrently if > 1 */,
+                    index_t parmmg_nb_procs = 0 /* run ParMmg with mpirun if > 0 */,
+                    bool run_in_background = false,
+                    bool curvature_size_map = false /* sizes from the curvature if no metric_attribute */,
+                    const std::string& transfer_attributes = "no_attribute" /* vertex attributes interpolated on the output, comma separated or "all" */,
+                    double skip_min_quality = 0. /* copy the input if its quality and sizes are already met, 0 to always remesh */,
+                    const std::string& reorder = "none" /* none, hilbert or morton: input and output order */,
+                    bool isolate = false /* run mmg in a separate process, a crash does not stop Graphite */,
+                    double worker_timeout = 0. /* isolated: seconds, 0 for no limit */,
+                    double worker_memory_limit = 0. /* isolated: GB, 0 for no limit */,
+                    index_t target_elements = 0 /* scale the sizes to get about this many elements, 0 to use them as given */,
+                    double memory_budget = 0. /* GB, refuse the remeshing if its estimated memory is over it, 0 for no limit */);
+            /**
+             * \brief Remeshes with every combination of the given ranges
+             *   concurrently and keeps the Pareto-best results (element
+             *   count, minimum quality, time) as <output_name>_<i>
+             * \menu /MmgTools
+             */
+            void mmg_parameter_sweep(
+                    const std::string& output_name = "default_sweep",
+                    const std::string& ranges = "hausd=0.0005,0.001,0.002; hgrad=1.1,1.3; optim=0,1" /* field=a,b,c or field=from:to:count, separated by ';' */,
+                    bool sizes_relative_to_bbox = true /* for hausd, hsiz, hmin, hmax, in ranges and below */,
+                    double hausd = 0.001,
+                    double hsiz = 0.0,
+                    double hmin = 0.01,
+                    double hmax = 0.2,
+                    double hgrad = 1.105171,
+                    const std::string& metric_attribute = "no_metric");
+
+            /**
+             * \brief Builds levels of detail as <output_name>_<i>, from
+             *   the finest to the coarsest, each level being remeshed from
+             *   a finer one instead of the input
+             * \menu /MmgTools
+             */
+            void mmg_lod(
+                    const std::string& output_name = "default_lod",
+                    const std::string& hsiz_bbox = "0.01, 0.02, 0.04, 0.08" /* one size per level, comma separated */,
+                    double hausd_bbox = 0.001 /* of the finest level, grows with hsiz for the others */,
+                    double hgrad = 1.105171,
+                    index_t nb_lanes = 0 /* chains of levels remeshed in parallel, 0 for two levels per chain */,
+                    const std::string& correspondence_attribute = "no_attribute" /* e.g. lod_parent: nearest vertex of the next coarser level */);
+
+            /**
+             * \brief Remeshes only the selected cells and a buffer around
+             *   them, the rest of the mesh is kept as is
+             * \menu /MmgTools
+             */
+            void mmg3d_local_remesh(
+                    const std::string& output_name = "default_mmg3d",
+                    const std::string& selection_cell_attribute = "no_attribute" /* int, cells != 0 */,
+                    const std::string& selection_box = "" /* xmin ymin zmin xmax ymax zmax */,
+                    double selection_min_quality = 0. /* cells of lower quality */,
+                    index_t buffer_layers = 2,
+                    double hausd_bbox = 0.001,
+                    double hsiz_bbox = 0.0,
+                    double hmin_bbox = 0.01,
+                    double hmax_bbox = 0.2,
+                    double hgrad = 1.105171,
+                    const std::string& metric_attribute = "no_metric",
+                    bool run_in_background = false);
+
+            /**
+             * \brief Moves the mesh by a vertex displacement, swapping,
+             *   collapsing or splitting only where the motion requires it
+             *   (mmg3d Lagrangian mode, mmg built with USE_ELAS)
+             * \menu /MmgTools
+             */
+            void mmg3d_move(
+                    const std::string& output_name = "default_move",
+                    const std::string& displacement_attribute = "displacement" /* double, dimension 3 */,
+                    index_t lagrangian_mode = 1 /* 0: move only, 1: and swap/move, 2: and collapse/split */,
+                    double hausd_bbox = 0.001,
+                    double hmin_bbox = 0.01,
+                    double hmax_bbox = 0.2,
+                    double hgrad = 1.105171,
+                    bool compare_with_remesh = false /* also remesh the displaced mesh and log both costs */,
+                    bool run_in_background = false);
+
             /**
              * \menu /MmgTools
              */
@@ -116,7 +205,118 @@ gom_slots:
                     double hausd_bbox = 0.001,
                     double hmin_bbox = 0.01,
                     double hmax_bbox = 0.2,
-                    double hgrad = 1.4);
+                    double hgrad = 1.4,
+                    bool run_in_background = false,
+                    const std::string& iso_output = "volume" /* volume, surface, interior or exterior */);
+
+            /**
+             * \brief Extracts several isovalues, converting the mesh once
+             *   and running the levels concurrently
+             * \menu /MmgTools
+             */
+            void mmg3d_iso_levels(
+                    const std::string& output_name = "default_iso_levels",
+                    const std::string& level_set_attribute = "no_ls",
+                    const std::string& level_set_values = "0" /* separated by spaces or commas */,
+                    bool angle_detection = false,
+                    double angle_value = 45.,
+                    double hausd_bbox = 0.001,
+                    double hmin_bbox = 0.01,
+                    double hmax_bbox = 0.2,
+                    double hgrad = 1.4,
+                    const std::string& iso_output = "surface" /* volume, surface, interior or exterior */,
+                    bool separate_grobs = false /* one grob per level, else a facet attribute iso_level */);
+
+            /**
+             * \brief Isosurface of an expression of x, y, z, or of the signed
+             *   distance to reference_surface, in this tet mesh refined
+             *   around the isovalue
+             * \menu /MmgTools
+             */
+            void mmg3d_implicit_iso(
+                    const std::string& output_name = "default_implicit",
+                    const std::string& expression = "sqrt(x^2 + y^2 + z^2) - 0.5",
+                    const std::string& reference_surface = "" /* grob name, replaces the expression */,
+                    double level_set_value = 0.,
+                    index_t nb_band_passes = 3,
+                    double band_width_bbox = 0. /* 0 for twice hmin */,
+                    double hausd_bbox = 0.001,
+                    double hmin_bbox = 0.005,
+                    double hmax_bbox = 0.2,
+                    double hgrad = 1.4,
+                    const std::string& iso_output = "surface" /* volume, surface, interior or exterior */);
+
+            /**
+             * \brief Sizes from the surface curvature, in a vertex attribute
+             *   that can be given as metric_attribute
+             * \menu /MmgTools
+             */
+            void compute_curvature_size_map(
+                    const std::string& attribute_name = "curvature_size",
+                    double hausd_bbox = 0.01,
+                    double hmin_bbox = 0.01,
+                    double hmax_bbox = 0.2,
+                    bool anisotropic = false,
+                    bool angle_detection = true,
+                    double angle_value = 45.);
+
+            /**
+             * \brief Remeshes nb_iterations times with a metric from the
+             *   Hessian of field_attribute, interpolating it on each new mesh
+             * \menu /MmgTools
+             */
+            void adapt_to_field(
+                    const std::string& output_name = "default_adapt",
+                    const std::string& field_attribute = "no_attribute",
+                    index_t nb_iterations = 3,
+                    double relative_error = 0.01 /* relative to the range of the field */,
+                    double hmin_bbox = 0.005,
+                    double hmax_bbox = 0.2,
+                    double hgrad = 1.3,
+                    bool anisotropic = false,
+                    const std::string& transfer_attributes = "no_attribute" /* also interpolated, comma separated or "all" */);
+
+            /**
+             * \brief Quality, angles and edge lengths of the tets (or
+             *   triangles), as a histogram in the log and as element attributes
+             * \menu /MmgTools
+             */
+            void mesh_quality(
+                    const std::string& attribute_prefix = "quality" /* empty for no attribute */,
+                    index_t nb_bins = 10,
+                    const std::string& metric_attribute = "no_metric",
+                    double hsiz_bbox = 0. /* edge lengths relative to this size if > 0 */);
+
+            /**
+             * \brief Checks the mesh before remeshing: element types,
+             *   degenerate and inverted elements, duplicate vertices,
+             *   non-manifold or open parts, and the given attributes
+             * \menu /MmgTools
+             */
+            void mesh_preflight(
+                    bool for_mmgs = false /* check the triangles, else the tets */,
+                    double duplicate_tolerance = 1e-10 /* relative to the bbox diagonal */,
+                    const std::string& metric_attribute = "no_metric",
+                    const std::string& edge_attribute = "no_attribute",
+                    const std::string& facet_attribute = "no_attribute",
+                    const std::string& cell_attribute = "no_attribute");
+
+            /**
+             * \menu /MmgTools/Jobs
+             */
+            void list_jobs();
+
+            /**
+             * \brief Publish the results of the background jobs that are done
+             * \details Every MmgTools command also does it before running
+             * \menu /MmgTools/Jobs
+             */
+            void collect_finished_jobs();
+
+            /**
+             * \menu /MmgTools/Jobs
+             */
+            void cancel_jobs();
     } ;
 }
 
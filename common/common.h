@@ -42,6 +42,18 @@
 #ifndef OGF_mmgig_COMMON_COMMON
 #define OGF_mmgig_COMMON_COMMON
 
+#ifdef MMGIG_STANDALONE
+
+/* Built without Graphite (e.g. mmgig_cli): the algorithms only need geogram */
+#include <geogram/basic/common.h>
+#define mmgig_API
+
+namespace OGF {
+    using namespace GEO;
+}
+
+#else
+
 #include <OGF/basic/common/common.h>
 #ifdef mmgig_EXPORTS
 #   define mmgig_API OGF_EXPORT
@@ -66,3 +78,5 @@ namespace OGF {
 }
 
 #endif
+
+#endif